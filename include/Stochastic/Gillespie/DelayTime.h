@@ -15,9 +15,27 @@
 //  Compound delays use NumberProcess classes
 //  NumberProcess classes must implement a std::size_t operator() (double time)
 //  which returns the number of i.i.d. delay events given a time window
-
+//  Classes drawing random numbers take the engine type Engine_t as a template parameter
+//  and can be reseeded through seed(value), e.g. for common random numbers
+//  For importance sampling, delays may implement
+//  std::pair<double, double> tilted(double time, double factor), drawing under a tilted law
+//  and returning the delay and the log likelihood ratio of the original to the tilted law
+//  The factor multiplies the rate of the number process for compound delays,
+//  and the scale of the delay otherwise; NumberProcess classes implement
+//  std::pair<std::size_t, double> tilted(double time, double factor) in the same way
+//  For mean-field limits, delays whose total over a time window is a subordinator
+//  may implement std::complex<double> laplace_exponent(std::complex<double> ss),
+//  the exponent phi with E[exp(-ss * delay(time))] = exp(-time * phi(ss)),
+//  and NumberProcess classes std::complex<double> generating_exponent(std::complex<double> zz),
+//  the exponent psi with E[zz^number(time)] = exp(-time * psi(zz))
+
+#include <cstdint>
+#include <cmath>
+#include <complex>
 #include <random>
+#include <utility>
 #include <vector>
+#include "general/Constants.h"
 #include "Stochastic/Random.h"
 
 namespace stochastic
@@ -27,8 +45,15 @@ namespace stochastic
   public:
     double operator() (double) const
     { return 0.; }
+
+    std::pair<double, double> tilted(double, double) const
+    { return { 0., 0. }; }
+
+    std::complex<double> laplace_exponent(std::complex<double>) const
+    { return 0.; }
   };
 
+  template <typename Engine_t = std::mt19937>
   class DelayTime_Exponential
   {
   public:
@@ -42,11 +67,21 @@ namespace stochastic
     double operator() (double time = 0.)
     { return exp_distribution(rng); }
 
+    std::pair<double, double> tilted(double, double factor)
+    {
+      double delay = factor * exp_distribution(rng);
+      return { delay, std::log(factor) - delay / mean + delay / (mean * factor) };
+    }
+
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
-    std::exponential_distribution< double > exp_distribution;
+    Engine_t rng{ std::random_device{}() };
+    stochastic::exponential_ziggurat_distribution<double> exp_distribution;
   };
 
+  template <typename Engine_t = std::mt19937>
   class DelayTime_SkewedLevyStable
   {
   public:
@@ -63,10 +98,14 @@ namespace stochastic
     double operator() (double time = 0.)
     { return stochastic::skewedlevystable_distribution<double>{ alpha, sigma, mu }(rng); }
     
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
   };
 
+  template <typename Engine_t = std::mt19937>
   class DelayTime_Gamma
   {
   public:
@@ -81,11 +120,21 @@ namespace stochastic
     double operator() (double time = 0.)
     { return std::gamma_distribution< double >{ gamma, mu }(rng); }
 
+    std::pair<double, double> tilted(double, double factor)
+    {
+      double delay = std::gamma_distribution< double >{ gamma, mu * factor }(rng);
+      return { delay, gamma * std::log(factor) - delay / mu + delay / (mu * factor) };
+    }
+
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
   };
 
   // Poisson process
+  template <typename Engine_t = std::mt19937>
   class NumberProcess_Poisson
   {
   public:
@@ -100,8 +149,20 @@ namespace stochastic
       return std::poisson_distribution<std::size_t>{ rate*time }(rng);
     }
 
+    std::pair<std::size_t, double> tilted(double time, double factor)
+    {
+      std::size_t number = std::poisson_distribution<std::size_t>{ factor*rate*time }(rng);
+      return { number, -double(number)*std::log(factor) + (factor - 1.)*rate*time };
+    }
+
+    std::complex<double> generating_exponent(std::complex<double> zz) const
+    { return rate*(1. - zz); }
+
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
   };
 
   //  Generic compound waiting time
@@ -125,13 +186,28 @@ namespace stochastic
       return delay;
     }
 
+    std::pair<double, double> tilted(double time, double factor)
+    {
+      auto number = number_process.tilted(time, factor);
+      double delay = 0.;
+      for (std::size_t ii = 0; ii < number.first; ++ii)
+        delay += waiting_process();
+      return { delay, number.second };
+    }
+
+    void seed(std::uint64_t value)
+    {
+      stochastic::seed_generator(number_process, seed_realization(value, 0));
+      stochastic::seed_generator(waiting_process, seed_realization(value, 1));
+    }
+
   private:
     Number_process number_process;
     Waiting_process waiting_process;
   };
 
   //  Compound (Number-Process)-Exponential
-  template <typename Number_process>
+  template <typename Number_process, typename Engine_t = std::mt19937>
   class DelayTime_CompoundExponential
   {
   public:
@@ -140,8 +216,8 @@ namespace stochastic
 
     DelayTime_CompoundExponential
     (Number_process number_process, double gamma, double mu = 1.)
-    : mu(mu)
-    , gamma(gamma)
+    : gamma(gamma)
+    , mu(mu)
     , number_process(number_process)
     {}
 
@@ -149,17 +225,35 @@ namespace stochastic
     {
       std::size_t number = number_process(time);
       return (number != 0
-          ? std::gamma_distribution< double >{ number, mu }(rng)
+          ? std::gamma_distribution< double >{ double(number), mu }(rng)
           : 0.);
     }
 
+    std::pair<double, double> tilted(double time, double factor)
+    {
+      auto number = number_process.tilted(time, factor);
+      return { number.first != 0
+        ? std::gamma_distribution< double >{ double(number.first), mu }(rng)
+        : 0., number.second };
+    }
+
+    //  Exponential delay events with mean mu
+    std::complex<double> laplace_exponent(std::complex<double> ss) const
+    { return number_process.generating_exponent(1. / (1. + mu*ss)); }
+
+    void seed(std::uint64_t value)
+    {
+      stochastic::seed_generator(number_process, seed_realization(value, 0));
+      rng.seed(typename Engine_t::result_type(seed_realization(value, 1)));
+    }
+
   private:
-    Number_process number_process;
-    mutable std::mt19937 rng{ std::random_device{}() };
+    mutable Number_process number_process;
+    mutable Engine_t rng{ std::random_device{}() };
   };
 
   // Compound (Number-Process)-SkewedLevyStable
-  template <typename Number_process>
+  template <typename Number_process, typename Engine_t = std::mt19937>
   class DelayTime_CompoundSkewedLevyStable
   {
   public:
@@ -185,12 +279,36 @@ namespace stochastic
        : 0.);
     }
 
+    std::pair<double, double> tilted(double time, double factor)
+    {
+      auto number = number_process.tilted(time, factor);
+      double nr = double(number.first);
+      return { number.first != 0
+        ? stochastic::skewedlevystable_distribution<double>{
+          alpha, std::pow(nr, 1./alpha)*sigma, nr*mu }(rng)
+        : 0., number.second };
+    }
+
+    //  One-sided stable delay events, 0 < alpha < 1
+    std::complex<double> laplace_exponent(std::complex<double> ss) const
+    {
+      return number_process.generating_exponent(std::exp(
+        -std::pow(sigma*ss, alpha)/std::cos(constants::pi*alpha/2.) - mu*ss));
+    }
+
+    void seed(std::uint64_t value)
+    {
+      stochastic::seed_generator(number_process, seed_realization(value, 0));
+      rng.seed(typename Engine_t::result_type(seed_realization(value, 1)));
+    }
+
   private:
     Number_process number_process;
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
   };
 
   // Subordinator formulation of skewed-levy-stable delay
+  template <typename Engine_t = std::mt19937>
   class DelayTime_Subordinator_SkewedLevyStable
   {
   public:
@@ -212,13 +330,17 @@ namespace stochastic
       return std::pow(gamma * delta_time, 1./alpha)*stable_dist(rng) + mu;
     }
 
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
     stochastic::skewedlevystable_distribution<double> stable_dist{ alpha, sigma, 0. };
   };
 
   // Subordinator formulation of skewed-levy-stable delay
   // Remove the contribution of regular reaction time and keep just delay
+  template <typename Engine_t = std::mt19937>
   class DelayTime_Subordinator_SkewedLevyStable_JustDelay
   {
   public:
@@ -240,8 +362,11 @@ namespace stochastic
       return -delta_time + std::pow(gamma*delta_time, 1./alpha)*stable_dist(rng) + mu;
     }
 
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
   private:
-    std::mt19937 rng{ std::random_device{}() };
+    Engine_t rng{ std::random_device{}() };
     stochastic::skewedlevystable_distribution<double> stable_dist{ alpha, sigma, 0. };
   };
 }
@@ -0,0 +1,552 @@
+//
+//  EventLog.h
+//  Stochastic
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Compact binary logs of every reaction in selected Gillespie trajectories,
+//  from which particle numbers at any time are recovered by replay
+//  Layout (varints are unsigned LEB128, raw fields in native byte order):
+//    char[8]   magic "GSEVLOG2"
+//    varint    nr_types
+//    varint    nr_reactions
+//    byte      flags, bit 0 set if delays are recorded
+//    for each reaction: varint nr_changes, then nr_changes pairs
+//              of varint type and zigzag varint net change in its particle number
+//    records until the end of the file, each starting with a varint tag:
+//      0       trajectory start: varint trajectory id, raw double start time,
+//              varint particle number of each type
+//      2r + 1  reaction r without delay, or with delays not recorded,
+//      2r + 2  reaction r with a nonzero delay:
+//              varint of the bits of its time XOR those of the previous time in the trajectory,
+//              then for 2r + 2 varint of the bits of the delay XOR those of the previous
+//              nonzero delay in the trajectory, or of zero for the first
+//  Successive times share sign, exponent and leading mantissa bits, as do delays of
+//  similar size, so most events take a few bytes, and times and delays are recovered exactly
+//  Events are batched raw and encoded and written to the file by a background thread,
+//  so the simulation only pays for copying them
+
+#ifndef EventLog_h
+#define EventLog_h
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <iterator>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+#include "general/MappedFile.h"
+#include "general/useful.h"
+#include "Gillespie.h"
+
+namespace gillespie
+{
+  namespace event_log
+  {
+    constexpr char magic[8] = { 'G', 'S', 'E', 'V', 'L', 'O', 'G', '2' };
+
+    //  Net changes in particle numbers of a reaction, as (type, change) pairs
+    using Changes = std::vector<std::pair<std::size_t, std::int64_t>>;
+
+    //  Net changes of each reaction of a Gillespie_Engine
+    template <typename Gillespie>
+    std::vector<Changes> reaction_changes(Gillespie const& gillespie)
+    {
+      std::vector<Changes> changes;
+      for (std::size_t reaction = 0; reaction < gillespie.nr_reactions(); ++reaction)
+      {
+        std::map<std::size_t, std::int64_t> net;
+        for (auto const& reactant : gillespie.reactants(reaction))
+          net[reactant.first] -= std::int64_t(reactant.second);
+        for (auto const& product : gillespie.products(reaction))
+          net[product.first] += std::int64_t(product.second);
+        changes.emplace_back();
+        for (auto const& change : net)
+          if (change.second != 0)
+            changes.back().push_back(change);
+      }
+      return changes;
+    }
+
+    std::uint64_t bits(double value)
+    {
+      std::uint64_t output;
+      std::memcpy(&output, &value, sizeof output);
+      return output;
+    }
+
+    double from_bits(std::uint64_t value)
+    {
+      double output;
+      std::memcpy(&output, &value, sizeof output);
+      return output;
+    }
+  }
+
+  //  Event sink for Gillespie_Engine::advance or observe: call begin at the start
+  //  of each trajectory to record, then pass the writer as the sink
+  //  Changing the state of the engine other than by its dynamics, e.g. through set,
+  //  requires a new begin for the log to replay correctly
+  //  Write errors in the background thread are rethrown by the next begin or close
+  class EventLog_Writer
+  {
+  public:
+    //  changes holds the net changes of each reaction
+    //  Events are batched batch_size at a time, and at most max_batches batches
+    //  wait for encoding and writing, after which recording waits for the disk
+    EventLog_Writer
+    (std::string const& filename, std::size_t nr_types, std::vector<event_log::Changes> const& changes,
+     bool delays = 1, std::size_t batch_size = std::size_t(1) << 14, std::size_t max_batches = 8)
+    : nr_types{ nr_types }
+    , delays{ delays }
+    , batch_size{ std::max(batch_size, std::size_t(1)) }
+    , max_batches{ std::max(max_batches, std::size_t(1)) }
+    , filename{ filename }
+    , output{ filename, std::ios::binary | std::ios::trunc }
+    {
+      if (!output.is_open())
+        throw useful::open_write_error(filename);
+      batch.events.resize(this->batch_size);
+      put_bytes(event_log::magic, sizeof event_log::magic);
+      put_varint(nr_types);
+      put_varint(changes.size());
+      std::uint8_t flags = delays ? 1 : 0;
+      put_bytes(&flags, 1);
+      for (auto const& reaction : changes)
+      {
+        put_varint(reaction.size());
+        for (auto const& change : reaction)
+        {
+          put_varint(change.first);
+          put_varint((std::uint64_t(change.second) << 1) ^ std::uint64_t(change.second >> 63));
+        }
+      }
+      writer = std::thread{ [this]() { write_loop(); } };
+    }
+
+    //  Reactions and types taken from gillespie
+    template <typename Gillespie>
+    EventLog_Writer(std::string const& filename, Gillespie const& gillespie, bool delays = 1,
+                    std::size_t batch_size = std::size_t(1) << 14, std::size_t max_batches = 8)
+    : EventLog_Writer{ filename, gillespie.nr_types(), event_log::reaction_changes(gillespie),
+                       delays, batch_size, max_batches }
+    {}
+
+    EventLog_Writer(EventLog_Writer const&) = delete;
+    EventLog_Writer& operator=(EventLog_Writer const&) = delete;
+
+    ~EventLog_Writer()
+    {
+      try
+      { close(); }
+      catch (...)
+      {}
+    }
+
+    //  Start a trajectory with the given particle numbers and time
+    void begin(std::uint64_t trajectory, std::vector<std::size_t> const& particles, double time)
+    {
+      if (particles.size() != nr_types)
+        throw useful::bad_parameters();
+      rethrow();
+      submit();
+      batch.restart = 1;
+      batch.time_start = time;
+      put_varint(0);
+      put_varint(trajectory);
+      put_bytes(&time, sizeof time);
+      for (auto particle : particles)
+        put_varint(particle);
+    }
+
+    //  Record an event, encoded later by the background thread
+    void event(double time, std::size_t reaction, double delay)
+    {
+      batch.events[batch.nr_events++] = { time, reaction, delays ? delay : 0. };
+      if (batch.nr_events == batch_size)
+        submit();
+    }
+
+    //  Write all records and stop the background thread
+    void close()
+    {
+      if (!writer.joinable())
+        return;
+      submit();
+      {
+        std::lock_guard<std::mutex> lock{ mutex };
+        closing = 1;
+      }
+      condition.notify_all();
+      writer.join();
+      output.close();
+      rethrow();
+    }
+
+  private:
+    struct Event
+    {
+      double time;
+      std::size_t reaction;
+      double delay;
+    };
+
+    //  Events, preceded by the bytes of any header or trajectory start record
+    struct Batch
+    {
+      std::vector<std::uint8_t> prefix;
+      bool restart{ 0 };          // The prefix starts a trajectory at time_start
+      double time_start{ 0. };
+      std::vector<Event> events;
+      std::size_t nr_events{ 0 };
+    };
+
+    const std::size_t nr_types;
+    const bool delays;
+    const std::size_t batch_size;
+    const std::size_t max_batches;
+    const std::string filename;
+    std::ofstream output;
+    Batch batch;                                    // Batch being filled
+
+    std::thread writer;
+    std::mutex mutex;
+    std::condition_variable condition;
+    std::deque<Batch> queue;                        // Batches waiting to be written
+    std::vector<Batch> spare;                       // Written batches, for reuse
+    bool closing{ 0 };
+    std::exception_ptr error;
+
+    //  State of the encoding, owned by the background thread
+    std::vector<std::uint8_t> encoded;
+    std::uint64_t time_previous{ 0 };
+    std::uint64_t delay_previous{ 0 };
+
+    static constexpr std::size_t record_max = 30;   // Bytes of the largest event record
+
+    static std::uint8_t* encode_varint(std::uint64_t value, std::uint8_t* first)
+    {
+      while (value >= 0x80)
+      {
+        *first++ = std::uint8_t(value) | 0x80;
+        value >>= 7;
+      }
+      *first++ = std::uint8_t(value);
+      return first;
+    }
+
+    void put_bytes(void const* data, std::size_t size)
+    {
+      auto first = static_cast<std::uint8_t const*>(data);
+      batch.prefix.insert(batch.prefix.end(), first, first + size);
+    }
+
+    void put_varint(std::uint64_t value)
+    {
+      std::uint8_t buffer[10];
+      put_bytes(buffer, std::size_t(encode_varint(value, buffer) - buffer));
+    }
+
+    //  Hand the current batch to the background thread and continue in a fresh one
+    void submit()
+    {
+      if (batch.prefix.empty() && batch.nr_events == 0)
+        return;
+      Batch next;
+      {
+        std::unique_lock<std::mutex> lock{ mutex };
+        condition.wait(lock, [this]() { return queue.size() < max_batches || error; });
+        queue.push_back(std::move(batch));
+        if (!spare.empty())
+        {
+          next = std::move(spare.back());
+          spare.pop_back();
+        }
+      }
+      condition.notify_all();
+      next.prefix.clear();
+      next.restart = 0;
+      next.events.resize(batch_size);
+      next.nr_events = 0;
+      batch = std::move(next);
+    }
+
+    //  Encode a batch: each event as its tag, 2 * reaction + 1, plus one if it has
+    //  a nonzero delay, then the varint of its time bits XOR those of the previous time,
+    //  and for a nonzero delay the varint of its bits XOR those of the previous nonzero delay
+    void encode(Batch const& current)
+    {
+      encoded.resize(current.prefix.size() + current.nr_events * record_max);
+      std::uint8_t* last = std::copy(current.prefix.begin(), current.prefix.end(), encoded.data());
+      if (current.restart)
+      {
+        time_previous = event_log::bits(current.time_start);
+        delay_previous = 0;
+      }
+      for (std::size_t ee = 0; ee < current.nr_events; ++ee)
+      {
+        Event const& event = current.events[ee];
+        bool delayed = event.delay != 0.;
+        last = encode_varint(2 * std::uint64_t(event.reaction) + 1 + delayed, last);
+        std::uint64_t time_bits = event_log::bits(event.time);
+        last = encode_varint(time_bits ^ time_previous, last);
+        time_previous = time_bits;
+        if (delayed)
+        {
+          std::uint64_t delay_bits = event_log::bits(event.delay);
+          last = encode_varint(delay_bits ^ delay_previous, last);
+          delay_previous = delay_bits;
+        }
+      }
+      encoded.resize(std::size_t(last - encoded.data()));
+    }
+
+    void write_loop()
+    {
+      std::unique_lock<std::mutex> lock{ mutex };
+      while (1)
+      {
+        condition.wait(lock, [this]() { return !queue.empty() || closing; });
+        if (queue.empty())
+          return;
+        Batch current = std::move(queue.front());
+        queue.pop_front();
+        lock.unlock();
+        bool failed = error != nullptr;
+        if (!failed)
+        {
+          encode(current);
+          failed = !output.write(reinterpret_cast<char const*>(encoded.data()),
+                                 std::streamsize(encoded.size()));
+        }
+        lock.lock();
+        if (failed && !error)
+          error = std::make_exception_ptr(useful::open_write_error(filename));
+        spare.push_back(std::move(current));
+        condition.notify_all();
+      }
+    }
+
+    void rethrow()
+    {
+      std::lock_guard<std::mutex> lock{ mutex };
+      if (error)
+        std::rethrow_exception(error);
+    }
+  };
+
+  //  Memory-mapped reader of event logs
+  //  A truncated last record, as left by an interrupted job, is ignored
+  class EventLog_Reader
+  {
+  public:
+    EventLog_Reader(std::string const& filename)
+    : file{ filename }
+    , filename{ filename }
+    {
+      if (file.size() < sizeof event_log::magic
+          || std::memcmp(file.data(), event_log::magic, sizeof event_log::magic) != 0)
+        throw useful::bad_file_contents(filename);
+      std::size_t position = sizeof event_log::magic;
+      std::uint64_t value;
+      if (!get_varint(position, value))
+        throw useful::bad_file_contents(filename);
+      types = std::size_t(value);
+      if (!get_varint(position, value) || position >= file.size())
+        throw useful::bad_file_contents(filename);
+      std::size_t nr_reactions = std::size_t(value);
+      delays = std::uint8_t(file.data()[position++]) & 1;
+      for (std::size_t reaction = 0; reaction < nr_reactions; ++reaction)
+      {
+        std::uint64_t nr_changes;
+        if (!get_varint(position, nr_changes))
+          throw useful::bad_file_contents(filename);
+        changes.emplace_back();
+        for (std::uint64_t cc = 0; cc < nr_changes; ++cc)
+        {
+          std::uint64_t type, zigzag;
+          if (!get_varint(position, type) || !get_varint(position, zigzag) || type >= types)
+            throw useful::bad_file_contents(filename);
+          changes.back().emplace_back(std::size_t(type),
+            std::int64_t(zigzag >> 1) ^ -std::int64_t(zigzag & 1));
+        }
+      }
+      index(position);
+    }
+
+    std::size_t nr_trajectories() const
+    { return starts.size(); }
+
+    std::uint64_t trajectory_id(std::size_t trajectory) const
+    { return ids.at(trajectory); }
+
+    std::size_t nr_types() const
+    { return types; }
+
+    std::size_t nr_reactions() const
+    { return changes.size(); }
+
+    bool has_delays() const
+    { return delays; }
+
+    //  Particle numbers and time at the start of a trajectory
+    std::pair<std::vector<std::size_t>, double> initial(std::size_t trajectory) const
+    {
+      std::size_t position = starts.at(trajectory);
+      return read_start(position);
+    }
+
+    //  Replay a trajectory, calling
+    //  visitor(double time, std::size_t reaction, double delay, std::vector<std::size_t> const& particles)
+    //  after each event, with the particle numbers just after it
+    template <typename Visitor>
+    void replay(std::size_t trajectory, Visitor&& visitor) const
+    {
+      std::size_t position = starts.at(trajectory);
+      std::size_t end = trajectory + 1 < starts.size() ? starts[trajectory + 1] : end_valid;
+      auto [particles, time_start] = read_start(position);
+      std::uint64_t time_bits = event_log::bits(time_start);
+      std::uint64_t delay_bits = 0;
+      while (position < end)
+      {
+        std::uint64_t tag, time_xor, delay_xor;
+        get_varint(position, tag);
+        get_varint(position, time_xor);
+        time_bits ^= time_xor;
+        bool delayed = (tag - 1) & 1;
+        if (delayed)
+        {
+          get_varint(position, delay_xor);
+          delay_bits ^= delay_xor;
+        }
+        double delay = delayed ? event_log::from_bits(delay_bits) : 0.;
+        std::size_t reaction = std::size_t((tag - 1) >> 1);
+        for (auto const& change : changes[reaction])
+        {
+          std::int64_t number = std::int64_t(particles[change.first]) + change.second;
+          if (number < 0)
+            throw useful::bad_file_contents(filename);
+          particles[change.first] = std::size_t(number);
+        }
+        visitor(event_log::from_bits(time_bits), reaction, delay, std::as_const(particles));
+      }
+    }
+
+    //  Particle numbers of a trajectory at each of the sorted times,
+    //  after all events before each time, as Gillespie_Engine::advance leaves them
+    template <typename Times>
+    std::vector<std::vector<std::size_t>> particles(std::size_t trajectory, Times const& times) const
+    {
+      std::vector<std::vector<std::size_t>> states;
+      states.reserve(std::size(times));
+      auto time_it = std::begin(times);
+      std::vector<std::size_t> current = initial(trajectory).first;
+      replay(trajectory,
+        [&](double time, std::size_t, double, std::vector<std::size_t> const& particles)
+        {
+          for (; time_it != std::end(times) && !(time < *time_it); ++time_it)
+            states.push_back(current);
+          current = particles;
+        });
+      for (; time_it != std::end(times); ++time_it)
+        states.push_back(current);
+      return states;
+    }
+
+  private:
+    useful::MappedFile file;
+    const std::string filename;
+    std::size_t types{ 0 };
+    bool delays{ 0 };
+    std::vector<event_log::Changes> changes;
+    std::vector<std::size_t> starts;        // Offsets of trajectory start records
+    std::vector<std::uint64_t> ids;
+    std::size_t end_valid{ 0 };             // Offset past the last complete record
+
+    bool get_varint(std::size_t& position, std::uint64_t& value) const
+    {
+      value = 0;
+      for (unsigned shift = 0; shift < 64 && position < file.size(); shift += 7)
+      {
+        std::uint8_t byte = std::uint8_t(file.data()[position++]);
+        value |= std::uint64_t(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+          return 1;
+      }
+      return 0;
+    }
+
+    //  Read a trajectory start record
+    std::pair<std::vector<std::size_t>, double> read_start(std::size_t& position) const
+    {
+      std::uint64_t value;
+      get_varint(position, value);
+      get_varint(position, value);
+      double time = get_double(position);
+      std::vector<std::size_t> particles(types);
+      for (auto& particle : particles)
+      {
+        get_varint(position, value);
+        particle = std::size_t(value);
+      }
+      return { particles, time };
+    }
+
+    double get_double(std::size_t& position) const
+    {
+      double value;
+      std::memcpy(&value, file.data() + position, sizeof value);
+      position += sizeof value;
+      return value;
+    }
+
+    //  Record the trajectory starts and check all records, up to the last complete one
+    void index(std::size_t position)
+    {
+      end_valid = position;
+      std::uint64_t value, tag;
+      while (position < file.size())
+      {
+        if (!get_varint(position, tag))
+          break;
+        if (tag == 0)
+        {
+          std::size_t start = end_valid;
+          std::uint64_t id;
+          if (!get_varint(position, id) || position + sizeof(double) > file.size())
+            break;
+          position += sizeof(double);
+          bool complete = 1;
+          for (std::size_t type = 0; type < types && complete; ++type)
+            complete = get_varint(position, value);
+          if (!complete)
+            break;
+          starts.push_back(start);
+          ids.push_back(id);
+        }
+        else
+        {
+          if (starts.empty() || (tag - 1) >> 1 >= changes.size() || (!delays && !(tag & 1)))
+            throw useful::bad_file_contents(filename);
+          if (!get_varint(position, value))
+            break;
+          if (!(tag & 1) && !get_varint(position, value))
+            break;
+        }
+        end_valid = position;
+      }
+    }
+  };
+}
+
+#endif /* EventLog_h */
@@ -9,28 +9,44 @@
 #ifndef Gillespie_h
 #define Gillespie_h
 
+#include <cstdint>
+#include <iterator>
 #include <tuple>
 #include <limits>
 #include <vector>
 #include <random>
 #include <utility>
 #include "general/useful.h"
+#include "Stochastic/Random.h"
 
 //  For use with Gillespie algorithm, reaction handler classes should implement:
 //  double rate(std::vector<std::size_t> const& numbers) const;
 //  void operator()(std::vector<std::size_t>& concentration, double time_step, double time);
 //  A visible type Stoichiometry
 
+//  Engine_t is the random number engine used to pick reactions
+
 namespace gillespie
 {
-  template<typename WaitingTime, typename DelayTime, typename... Reactions>
-  class Gillespie
+  //  Event sinks receive each reaction executed by Gillespie_Engine::advance or observe
+  //  when passed to them, through
+  //  void event(double time, std::size_t reaction, double delay);
+  //  with its time, index, and the delay drawn for it, e.g. EventLog_Writer (see EventLog.h)
+  //  The sink is a template parameter, so that the default sink costs nothing
+  struct EventSink_none
+  {
+    void event(double, std::size_t, double)
+    {}
+  };
+
+  template<typename Engine_t, typename WaitingTime, typename DelayTime, typename... Reactions>
+  class Gillespie_Engine
   {
   public:
     using ReactantStoichiometry = typename std::tuple_element<0, std::tuple<Reactions...>>::type::Stoichiometry::ReactantStoichiometry;
     using Part_Container = std::vector<std::size_t>;
 
-    Gillespie(Part_Container particles, double time, WaitingTime waiting_time, DelayTime delay_time, Reactions... reactions)
+    Gillespie_Engine(Part_Container particles, double time, WaitingTime waiting_time, DelayTime delay_time, Reactions... reactions)
     : particle_container(particles)
     , time_current(time)
     , waiting_time(waiting_time)
@@ -45,11 +61,15 @@ namespace gillespie
     {
       particle_container = particles;
       time_current = time;
+      pending = 0;
     }
 
     //  Set particle numbers of a type
     void set(std::size_t type, std::size_t particle_nr)
-    { particle_container[type] = particle_nr; }
+    {
+      particle_container[type] = particle_nr;
+      pending = 0;
+    }
 
     //  Set particle numbers of designated types
     void set(std::vector<std::size_t> const& types, Part_Container const& particles)
@@ -59,26 +79,48 @@ namespace gillespie
     }
 
     void time(double time)
-    { time_current = time; }
+    {
+      time_current = time;
+      pending = 0;
+    }
+
+    //  Reseed all random streams, e.g. to key them to a realization index
+    //  for common random numbers across parameter values,
+    //  or to decorrelate a copy from the original
+    //  The pending reaction, if any, is kept
+    void seed(std::uint64_t value)
+    {
+      rng.seed(typename Engine_t::result_type(stochastic::seed_realization(value, 0)));
+      stochastic::seed_generator(waiting_time, stochastic::seed_realization(value, 1));
+      stochastic::seed_generator(delay_time, stochastic::seed_realization(value, 2));
+    }
 
     // Remove all particles
     void clear()
-    { std::fill(particle_container.begin(), particle_container.end(), 0); }
+    {
+      std::fill(particle_container.begin(), particle_container.end(), 0);
+      pending = 0;
+    }
 
     void add(std::size_t type, std::size_t increment = 1)
-    { particle_container[type] += increment; }
+    {
+      particle_container[type] += increment;
+      pending = 0;
+    }
 
     void remove(std::size_t type, std::size_t increment = 1)
     {
       particle_container[type] > increment
       ? particle_container[type] -= increment
       : 0;
+      pending = 0;
     }
 
     //  Update state to just after next reaction
     void evolve()
     {
       reacted = 0;
+      pending = 0;
       rates();
       if (*std::max_element(rate_container.begin(), rate_container.end()) == 0.)
         time_next_reaction = std::numeric_limits<double>::infinity();
@@ -86,7 +128,7 @@ namespace gillespie
       {
         pick_reaction();
         compute_time_next_reaction();
-        react(next_reaction);
+        react(next_reaction, no_events);
         reacted = 1;
       }
       time_current = time_next_reaction;
@@ -94,9 +136,13 @@ namespace gillespie
 
     //  Update state to time_max
     //  A record of the next reaction time and reaction is kept
+    //  A reaction sampled past time_max is discarded and resampled from time_max
+    //  on the next call, which is only exact for memoryless dynamics without delay;
+    //  see advance for the general case
     void evolve(double time_max)
     {
       reacted = 0;
+      pending = 0;
       while (1)
       {
         // Compute rates
@@ -112,7 +158,7 @@ namespace gillespie
         if (time_next_reaction <time_max)
         {
           time_current = time_next_reaction;
-          react(next_reaction);
+          react(next_reaction, no_events);
           reacted = 1;
         }
         else
@@ -123,12 +169,87 @@ namespace gillespie
       }
     }
 
+    //  Update state to time_max, keeping a reaction sampled past time_max
+    //  pending until a later call reaches it, so that stopping at intermediate
+    //  times does not change the dynamics for any WaitingTime and DelayTime
+    //  The pending reaction is discarded if the state is changed externally
+    //  Each executed reaction is reported to sink
+    template <typename Sink>
+    void advance(double time_max, Sink& sink)
+    {
+      reacted = 0;
+      while (1)
+      {
+        if (!pending)
+        {
+          rates();
+          if (*std::max_element(rate_container.begin(), rate_container.end()) == 0.)
+            time_next_reaction = std::numeric_limits<double>::infinity();
+          else
+          {
+            pick_reaction();
+            compute_time_next_reaction();
+          }
+          pending = 1;
+        }
+        if (time_next_reaction < time_max)
+        {
+          time_current = time_next_reaction;
+          react(next_reaction, sink);
+          reacted = 1;
+          pending = 0;
+        }
+        else
+        {
+          time_current = time_max;
+          break;
+        }
+      }
+    }
+
+    void advance(double time_max)
+    { advance(time_max, no_events); }
+
+    //  Advance through the sorted observation times in a single pass,
+    //  calling observer(index, *this) at each times[index]
+    //  and reporting each executed reaction to sink
+    template <typename Times, typename Observer, typename Sink>
+    void observe(Times const& times, Observer&& observer, Sink& sink)
+    {
+      std::size_t index = 0;
+      for (auto const& time_observe : times)
+      {
+        advance(time_observe, sink);
+        observer(index++, std::as_const(*this));
+      }
+    }
+
+    template <typename Times, typename Observer>
+    void observe(Times const& times, Observer&& observer)
+    { observe(times, std::forward<Observer>(observer), no_events); }
+
+    //  Particle numbers at each of the sorted observation times
+    template <typename Times>
+    void observe(Times const& times, std::vector<Part_Container>& states)
+    {
+      states.resize(std::size(times));
+      observe(times, [&states](std::size_t index, Gillespie_Engine const& gillespie)
+      { states[index] = gillespie.particles(); });
+    }
+
     double rate_sum() const
     {
       rates();
       return operation::sum(rate_container);
     }
 
+    //  True if all reaction rates are zero in the current state
+    bool absorbing() const
+    {
+      rates();
+      return *std::max_element(rate_container.begin(), rate_container.end()) == 0.;
+    }
+
     double time() const
     { return time_current; }
 
@@ -156,11 +277,14 @@ namespace gillespie
     std::size_t nr_types() const
     { return particle_container.size(); }
 
-    ReactantStoichiometry const& reactants(std::size_t reaction)
-    { return reactant_table[reaction](); }
+    static constexpr std::size_t nr_reactions()
+    { return sizeof...(Reactions); }
 
-    ReactantStoichiometry const& products(std::size_t reaction)
-    { return product_table[reaction](); }
+    ReactantStoichiometry const& reactants(std::size_t reaction) const
+    { return reactant_table[reaction](reactions); }
+
+    ReactantStoichiometry const& products(std::size_t reaction) const
+    { return product_table[reaction](reactions); }
 
   private:
 
@@ -171,7 +295,7 @@ namespace gillespie
     using function_array_stoichiometry = std::array<function_type_stoichiometry, sizeof...(Reactions)>;
     using array_type = std::array<double, sizeof...(Reactions)>;
 
-    mutable std::mt19937 rng{ std::random_device{}() };  // RNG
+    mutable Engine_t rng{ std::random_device{}() };     // RNG
     Part_Container particle_container;                  //Numbers of particles of each type
     double time_current;
     WaitingTime waiting_time;                           // Intrinsic inter-reaction time
@@ -187,18 +311,23 @@ namespace gillespie
     double time_next_reaction;
     std::size_t last_reaction;
     std::size_t next_reaction;
+    double delay_next_reaction{ 0. };
+    EventSink_none no_events;           // Default sink, ignoring executed reactions
     bool reacted = 0;                   // True if reacted during the last evolution
+    bool pending = 0;                   // True if the next reaction has been sampled but not executed
 
     mutable array_type rate_container;  // State-dependent rates for each reaction
 
     // Compile-time check if there is more than one reaction
     constexpr static bool more_than_one_reaction{ bool(std::minus<std::size_t>{}(sizeof...(Reactions), 1)) };
 
-    void react(std::size_t index)
+    template <typename Sink>
+    void react(std::size_t index, Sink& sink)
     {
       last_reaction = next_reaction;
       time_last_reaction = time_next_reaction;
       reaction_table[index](reactions, particle_container);
+      sink.event(time_next_reaction, index, delay_next_reaction);
     }
 
     //  Cumulative reaction rates based on current state
@@ -215,7 +344,8 @@ namespace gillespie
     void compute_time_next_reaction()
     {
       double waiting = waiting_time(rate_container);
-      time_next_reaction = time_current + waiting + delay_time(waiting);
+      delay_next_reaction = delay_time(waiting);
+      time_next_reaction = time_current + waiting + delay_next_reaction;
     }
 
     // If there is more than one reaction
@@ -283,6 +413,9 @@ namespace gillespie
           return std::get<Indices>(reactions).stoichiometry.products; }... } };
     }
   };
+
+  template<typename WaitingTime, typename DelayTime, typename... Reactions>
+  using Gillespie = Gillespie_Engine<std::mt19937, WaitingTime, DelayTime, Reactions...>;
 }
 
 
@@ -8,6 +8,8 @@
 
 //  High-level helpers to built instances of generalized Gillespie
 //  algorithm handlers for mass-action reactions
+//  The random number engine may be given as first template argument,
+//  e.g. make_Gillespie_MassAction<stochastic::xoshiro256pp>(...)
 
 #ifndef Gillespie_Stoichiometric_h
 #define Gillespie_Stoichiometric_h
@@ -21,42 +23,42 @@
 namespace gillespie
 {
   //  Make a Gillespie for mass action reactions with overall delay
-  template <typename DelayTime, typename... Stoichiometry>
+  template <typename Engine_t = std::mt19937, typename DelayTime, typename... Stoichiometry>
   auto make_Gillespie_MassAction_Delay(std::vector<std::size_t> numbers, double time, DelayTime delay_time, Stoichiometry&&... stoichiometry)
   {
     return
-    Gillespie<WaitingTime_Exponential, DelayTime, decltype(stochastic::Reaction_MassAction{ stoichiometry })...>
+    Gillespie_Engine<Engine_t, WaitingTime_Exponential<Engine_t>, DelayTime, decltype(stochastic::Reaction_MassAction{ stoichiometry })...>
     { numbers, time, {}, delay_time,
       stochastic::Reaction_MassAction{ std::forward<Stoichiometry>(stoichiometry) }... };
   }
 
   //  Make a Gillespie for mass action reactions with overall delay
   //  Start time at 0.
-  template <typename DelayTime, typename... Stoichiometry>
+  template <typename Engine_t = std::mt19937, typename DelayTime, typename... Stoichiometry>
   auto make_Gillespie_MassAction_Delay
   (std::vector<std::size_t> numbers, DelayTime delay_time, Stoichiometry&&... stoichiometry)
   {
     return
-    make_Gillespie_MassAction_Delay
+    make_Gillespie_MassAction_Delay<Engine_t>
     (numbers, 0., delay_time, std::forward<Stoichiometry>(stoichiometry)...);
   }
 
   //  Make a Gillespie for regular mass action reactions
-  template <typename... Stoichiometry>
+  template <typename Engine_t = std::mt19937, typename... Stoichiometry>
   auto make_Gillespie_MassAction(std::vector<std::size_t> numbers, double time, Stoichiometry&&... stoichiometry)
   {
     return
-    make_Gillespie_MassAction_Delay
+    make_Gillespie_MassAction_Delay<Engine_t>
     (numbers, time, stochastic::DelayTime_NoDelay{}, std::forward<Stoichiometry>(stoichiometry)...);
   }
 
   //  Make a Gillespie for regular mass action reactions
   //  Start time at 0.
-  template <typename... Stoichiometry>
+  template <typename Engine_t = std::mt19937, typename... Stoichiometry>
   auto make_Gillespie_MassAction(std::vector<std::size_t> numbers, Stoichiometry&&... stoichiometry)
   {
     return
-    make_Gillespie_MassAction
+    make_Gillespie_MassAction<Engine_t>
     (numbers, 0., std::forward<Stoichiometry>(stoichiometry)...);
   }
 }
@@ -0,0 +1,248 @@
+//
+//  Gillespie_Weighted.h
+//  Stochastic
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Importance-sampled Gillespie algorithm for mass-action reactions with delay,
+//  for rare events such as late-time survival
+//  Trajectories are drawn under a biased law: the propensity of each reaction,
+//  from Reaction_MassAction::rate, is multiplied by a tilting factor,
+//  and delays are drawn through DelayTime::tilted with a tilting factor
+//  Each trajectory carries the likelihood ratio of the original to the biased law,
+//  so that averages of weight * observable estimate the original averages
+//  (see statistics::Weighted)
+//  A reaction with propensity a and factor f has biased propensity f * a,
+//  and with total propensities a0 and b0 and waiting time tau each event
+//  contributes a log likelihood ratio -log(f) - (a0 - b0) * tau plus that of its delay
+//  Tilting classes must implement
+//  double propensity(std::size_t reaction, std::vector<std::size_t> const& particles) const,
+//  a factor greater than zero for each reaction, and
+//  double delay(std::vector<std::size_t> const& particles) const,
+//  the delay factor, with 1 for no delay tilting
+//  The weight of a trajectory includes the event sampled but not yet executed,
+//  as that draw determines the state up to its time
+
+#ifndef Gillespie_Weighted_h
+#define Gillespie_Weighted_h
+
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "general/useful.h"
+#include "Stochastic/Random.h"
+#include "Stochastic/Reaction.h"
+#include "Stochastic/Stoichiometry.h"
+#include "DelayTime.h"
+
+namespace gillespie
+{
+  //  The same factors in every state
+  struct Tilting_Constant
+  {
+    std::vector<double> factors;    // Factor of each reaction
+    double delay_factor{ 1. };
+
+    double propensity(std::size_t reaction, std::vector<std::size_t> const&) const
+    { return factors[reaction]; }
+
+    double delay(std::vector<std::size_t> const&) const
+    { return delay_factor; }
+  };
+
+  template <typename DelayTime = stochastic::DelayTime_NoDelay,
+            typename Tilting = Tilting_Constant, typename Engine_t = std::mt19937>
+  class Gillespie_Weighted
+  {
+  public:
+    using Part_Container = std::vector<std::size_t>;
+    using Stoichiometry = stochastic::Stoichiometry;
+
+    Gillespie_Weighted
+    (Part_Container particles, std::vector<Stoichiometry> const& stoichiometries,
+     DelayTime delay_time, Tilting tilting, double time = 0.)
+    : particle_container{ particles }
+    , time_current{ time }
+    , delay_time{ delay_time }
+    , tilting{ tilting }
+    , propensities(stoichiometries.size())
+    , propensities_biased(stoichiometries.size())
+    {
+      for (auto const& stoichiometry : stoichiometries)
+        reactions.emplace_back(stoichiometry);
+    }
+
+    //  Start a new trajectory, with unit weight
+    void set(Part_Container const& particles, double time = 0.)
+    {
+      particle_container = particles;
+      time_current = time;
+      log_likelihood = 0.;
+      pending = 0;
+    }
+
+    //  Reseed all random streams, keeping the pending reaction, if any
+    void seed(std::uint64_t value)
+    {
+      rng.seed(typename Engine_t::result_type(stochastic::seed_realization(value, 0)));
+      stochastic::seed_generator(delay_time, stochastic::seed_realization(value, 1));
+    }
+
+    //  Update state to just after next reaction
+    void evolve()
+    {
+      if (!pending)
+        sample();
+      pending = 0;
+      time_current = time_next_reaction;
+      if (time_next_reaction < std::numeric_limits<double>::infinity())
+        reactions[next_reaction].react(particle_container);
+    }
+
+    //  Update state to time_max, keeping a reaction sampled past time_max
+    //  pending until a later call reaches it
+    //  Resampling it instead would bias the weights
+    void evolve(double time_max)
+    {
+      while (1)
+      {
+        if (!pending)
+        {
+          sample();
+          pending = 1;
+        }
+        if (time_next_reaction < time_max)
+        {
+          time_current = time_next_reaction;
+          reactions[next_reaction].react(particle_container);
+          pending = 0;
+        }
+        else
+        {
+          time_current = time_max;
+          break;
+        }
+      }
+    }
+
+    //  Advance through the sorted observation times in a single pass,
+    //  calling observer(index, *this) at each times[index]
+    template <typename Times, typename Observer>
+    void observe(Times const& times, Observer&& observer)
+    {
+      std::size_t index = 0;
+      for (auto const& time_observe : times)
+      {
+        evolve(time_observe);
+        observer(index++, std::as_const(*this));
+      }
+    }
+
+    //  Likelihood ratio of the trajectory so far, original to biased law
+    double weight() const
+    { return std::exp(log_likelihood); }
+
+    double log_weight() const
+    { return log_likelihood; }
+
+    double time() const
+    { return time_current; }
+
+    Part_Container const& particles() const
+    { return particle_container; }
+
+    std::size_t particles(std::size_t type) const
+    { return particle_container[type]; }
+
+    std::size_t nr_types() const
+    { return particle_container.size(); }
+
+  private:
+    mutable Engine_t rng{ std::random_device{}() };
+    Part_Container particle_container;
+    double time_current;
+    DelayTime delay_time;
+    Tilting tilting;
+    std::vector<stochastic::Reaction_MassAction> reactions;
+    std::vector<double> propensities;
+    std::vector<double> propensities_biased;
+    double log_likelihood{ 0. };
+    double time_next_reaction{ 0. };
+    std::size_t next_reaction{ 0 };
+    bool pending{ 0 };
+    std::exponential_distribution<double> exp_dist{ 1. };
+    std::uniform_real_distribution<double> unif_dist{ 0., 1. };
+
+    template <typename Delay>
+    using tilted_t = decltype(std::declval<Delay&>().tilted(0., 0.));
+
+    //  Draw the next reaction and its time under the biased law,
+    //  and update the likelihood ratio
+    void sample()
+    {
+      double total = 0.;
+      double total_biased = 0.;
+      for (std::size_t reaction = 0; reaction < reactions.size(); ++reaction)
+      {
+        propensities[reaction] = reactions[reaction].rate(particle_container);
+        propensities_biased[reaction] = propensities[reaction] > 0.
+          ? tilting.propensity(reaction, particle_container) * propensities[reaction]
+          : 0.;
+        total += propensities[reaction];
+        total_biased += propensities_biased[reaction];
+      }
+      if (total == 0.)
+      {
+        time_next_reaction = std::numeric_limits<double>::infinity();
+        return;
+      }
+      if (!(total_biased > 0.))
+        throw std::domain_error{ "Gillespie_Weighted: Tilting factors must be positive" };
+
+      double choice = unif_dist(rng) * total_biased;
+      next_reaction = 0;
+      while (next_reaction + 1 < reactions.size() && choice >= propensities_biased[next_reaction])
+        choice -= propensities_biased[next_reaction++];
+      while (propensities_biased[next_reaction] == 0.)
+        --next_reaction;
+
+      double waiting = exp_dist(rng) / total_biased;
+      log_likelihood += std::log(propensities[next_reaction] / propensities_biased[next_reaction])
+        - (total - total_biased) * waiting;
+      time_next_reaction = time_current + waiting + delay(waiting);
+    }
+
+    double delay(double waiting)
+    {
+      double factor = tilting.delay(particle_container);
+      if (factor == 1.)
+        return delay_time(waiting);
+      if constexpr (useful::has_method<tilted_t, DelayTime>::value)
+      {
+        auto delay_weighted = delay_time.tilted(waiting, factor);
+        log_likelihood += delay_weighted.second;
+        return delay_weighted.first;
+      }
+      else
+        throw std::invalid_argument{ "Gillespie_Weighted: Delay cannot be tilted" };
+    }
+  };
+
+  //  Make a weighted Gillespie for mass action reactions with overall delay
+  template <typename Engine_t = std::mt19937, typename DelayTime, typename Tilting>
+  auto make_Gillespie_MassAction_Weighted
+  (std::vector<std::size_t> numbers, std::vector<stochastic::Stoichiometry> const& stoichiometries,
+   DelayTime delay_time, Tilting tilting)
+  {
+    return Gillespie_Weighted<DelayTime, Tilting, Engine_t>{
+      numbers, stoichiometries, delay_time, tilting };
+  }
+}
+
+#endif /* Gillespie_Weighted_h */
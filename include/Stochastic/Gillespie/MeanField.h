@@ -0,0 +1,217 @@
+//
+//  MeanField.h
+//  Stochastic
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Mean-field limit of mass-action reactions with overall delay, as simulated by
+//  make_Gillespie_MassAction_Delay, for large numbers of particles
+//  Each waiting time w is followed by a delay with E[exp(-s * delay(w))] = exp(-w * phi(s)),
+//  so that physical time is T(tau) = tau + D(tau) in the operational time tau of the reactions,
+//  with D a subordinator with Laplace exponent phi (see DelayTime.h, laplace_exponent)
+//  All reactions run on this single clock, so for many particles the concentrations at
+//  physical time t are c_ode(E_t), with c_ode the solution of the mass-action rate equations
+//  in operational time and E_t = inf{ tau : T(tau) > t } the inverse subordinator
+//  Since E_t > tau exactly when D(tau) < t - tau, the mean-field concentrations are
+//  E[c_ode(E_t)] = c_ode(t) - int_0^t c_ode'(tau) P(D(tau) > t - tau) dtau,
+//  written as a correction to c_ode(t) to avoid cancellation when c_ode(t) << c(0)
+//  The survival function of D(tau), with Laplace transform (1 - exp(-tau * phi(s))) / s,
+//  is inverted numerically, and the integral is computed with Gauss-Legendre panels
+//  graded geometrically toward both ends of [0, t], where the integrand varies fastest,
+//  so that early observation times are resolved as well as late ones
+//  c_ode is integrated once for all observation times with the adaptive Rosenbrock
+//  reactor of Reaction.h
+
+#ifndef MeanField_h
+#define MeanField_h
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <iterator>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "general/Operations.h"
+#include "general/Quadrature.h"
+#include "Stochastic/Reaction.h"
+#include "Stochastic/Stoichiometry.h"
+
+namespace gillespie
+{
+  template <typename DelayTime>
+  class MeanField_Delay
+  {
+  public:
+    using Stoichiometry = stochastic::Stoichiometry;
+
+    //  nr_panels quadrature panels cover each half of [0, t],
+    //  the one nearest the end spanning grading_min * t
+    MeanField_Delay
+    (std::vector<double> concentrations, std::vector<Stoichiometry> const& stoichiometries,
+     DelayTime delay_time, std::size_t nr_panels = 32)
+    : concentrations_initial{ concentrations }
+    , stoichiometries{ stoichiometries }
+    , delay_time{ delay_time }
+    , nr_panels{ nr_panels }
+    {
+      if (nr_panels == 0 || stoichiometries.empty())
+        throw std::invalid_argument{ "MeanField_Delay: Inappropriate parameters" };
+      for (auto const& stoichiometry : stoichiometries)
+      {
+        double factor = 1.;
+        for (auto const& reactant : stoichiometry.reactants)
+          factor *= operation::factorial(reactant.second);
+        rates.push_back(stoichiometry.reaction_rate / factor);
+        reactants.push_back(stoichiometry.reactants);
+        std::vector<double> net(concentrations.size(), 0.);
+        for (auto const& reactant : stoichiometry.reactants)
+          net.at(reactant.first) -= double(reactant.second);
+        for (auto const& product : stoichiometry.products)
+          net.at(product.first) += double(product.second);
+        stoichiometry_net.push_back(net);
+      }
+    }
+
+    //  Mean-field concentrations at each of the observation times,
+    //  calling observer(index, concentrations) for each times[index] in order
+    template <typename Times, typename Observer>
+    void observe(Times const& times, Observer&& observer)
+    {
+      std::vector<double> observation_times(std::begin(times), std::end(times));
+      for (double time : observation_times)
+        if (!(time >= 0.))
+          throw std::invalid_argument{ "MeanField_Delay: Observation times must be nonnegative" };
+
+      //  Nodes of all observation times in operational time, weighted by the survival
+      //  function of the delay, integrated through in increasing order,
+      //  and each observation time itself, for c_ode(t)
+      struct Node
+      {
+        double tau;
+        double weight;
+        std::size_t index;
+        bool endpoint;
+      };
+      std::vector<Node> nodes;
+      quadrature::Rule rule = quadrature::gauss_legendre(nodes_per_panel, 0., 1.);
+      std::vector<double> breakpoints = graded_breakpoints();
+      for (std::size_t index = 0; index < observation_times.size(); ++index)
+      {
+        double time = observation_times[index];
+        nodes.push_back({ time, 0., index, true });
+        if (time == 0.)
+          continue;
+        for (std::size_t panel = 0; panel + 1 < breakpoints.size(); ++panel)
+        {
+          double left = breakpoints[panel];
+          double width = breakpoints[panel + 1] - left;
+          for (std::size_t node = 0; node < rule.nodes.size(); ++node)
+          {
+            //  Fraction from either end of [0, t], so that remaining times are exact
+            double fraction = left + width * rule.nodes[node];
+            double weight = time * width * rule.weights[node];
+            nodes.push_back({ time * fraction,
+              -weight * delay_survival(time * fraction, time * (1. - fraction)), index, false });
+            nodes.push_back({ time * (1. - fraction),
+              -weight * delay_survival(time * (1. - fraction), time * fraction), index, false });
+          }
+        }
+      }
+      std::sort(nodes.begin(), nodes.end(),
+                [](Node const& node_1, Node const& node_2) { return node_1.tau < node_2.tau; });
+
+      std::vector<std::vector<double>> concentrations(observation_times.size(),
+        std::vector<double>(concentrations_initial.size(), 0.));
+      stochastic::Reaction_concentration_MassAction_Rosenbrock reactor{
+        stoichiometries, concentrations_initial, tol_rel, tol_abs };
+      std::vector<double> derivative(concentrations_initial.size());
+      for (auto const& node : nodes)
+      {
+        reactor.evolve(node.tau);
+        if (node.endpoint)
+        {
+          for (std::size_t type = 0; type < derivative.size(); ++type)
+            concentrations[node.index][type] += reactor.concentrations()[type];
+          continue;
+        }
+        rates_of_change(reactor.concentrations(), derivative);
+        for (std::size_t type = 0; type < derivative.size(); ++type)
+          concentrations[node.index][type] += node.weight * derivative[type];
+      }
+      for (std::size_t index = 0; index < observation_times.size(); ++index)
+        observer(index, std::as_const(concentrations[index]));
+    }
+
+  private:
+    const std::vector<double> concentrations_initial;
+    const std::vector<Stoichiometry> stoichiometries;
+    DelayTime delay_time;
+    const std::size_t nr_panels;
+    std::vector<double> rates;      // Rate constants, scaled by reactant factorials
+    std::vector<Stoichiometry::ReactantStoichiometry> reactants;
+    std::vector<std::vector<double>> stoichiometry_net;
+
+    static constexpr std::size_t nodes_per_panel = 8;
+    static constexpr double grading_min = 1.e-12;
+    static constexpr double tol_rel = 1.e-10;
+    static constexpr double tol_abs = 1.e-12;
+
+    //  Panel ends in [0, 1/2], geometric from grading_min / 2 up to 1/2
+    std::vector<double> graded_breakpoints() const
+    {
+      std::vector<double> breakpoints{ 0. };
+      for (std::size_t panel = 0; panel < nr_panels; ++panel)
+        breakpoints.push_back(0.5 * std::pow(grading_min,
+          double(nr_panels - 1 - panel) / double(nr_panels - 1 ? nr_panels - 1 : 1)));
+      return breakpoints;
+    }
+
+    //  P(D(tau) > remaining)
+    double delay_survival(double tau, double remaining) const
+    {
+      return quadrature::invert_laplace_euler([this, tau](std::complex<double> ss)
+        {
+          //  1 - exp(-exponent), by its series when small
+          std::complex<double> exponent = tau * delay_time.laplace_exponent(ss);
+          std::complex<double> complement = std::abs(exponent) < 1.e-3
+            ? exponent * (1. - exponent / 2. * (1. - exponent / 3. * (1. - exponent / 4.)))
+            : 1. - std::exp(-exponent);
+          return complement / ss;
+        }, remaining);
+    }
+
+    double rate(std::size_t reaction, std::vector<double> const& concentrations) const
+    {
+      double rate_val = rates[reaction];
+      for (auto const& reactant : reactants[reaction])
+        rate_val *= std::pow(concentrations[reactant.first], double(reactant.second));
+      return rate_val;
+    }
+
+    //  Time derivative of the concentrations in operational time
+    void rates_of_change(std::vector<double> const& concentrations, std::vector<double>& derivative) const
+    {
+      std::fill(derivative.begin(), derivative.end(), 0.);
+      for (std::size_t reaction = 0; reaction < rates.size(); ++reaction)
+      {
+        double rate_val = rate(reaction, concentrations);
+        for (std::size_t type = 0; type < derivative.size(); ++type)
+          derivative[type] += stoichiometry_net[reaction][type] * rate_val;
+      }
+    }
+  };
+
+  //  Make a mean-field solver for mass action reactions with overall delay
+  template <typename DelayTime>
+  auto make_MeanField_MassAction_Delay
+  (std::vector<double> concentrations, std::vector<stochastic::Stoichiometry> const& stoichiometries,
+   DelayTime delay_time, std::size_t nr_panels = 32)
+  {
+    return MeanField_Delay<DelayTime>{ concentrations, stoichiometries, delay_time, nr_panels };
+  }
+}
+
+#endif /* MeanField_h */
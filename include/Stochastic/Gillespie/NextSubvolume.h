@@ -0,0 +1,402 @@
+//
+//  NextSubvolume.h
+//  Stochastic
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Compartmentalized reaction-diffusion by the next-subvolume method
+//  (Elf and Ehrenberg, Syst. Biol. 1, 2004), with chCTRW-type delays
+//  A regular grid of subvolumes in 1 to 3 dimensions, with reflecting boundaries,
+//  holds particle numbers of each species. Within each subvolume, mass-action
+//  reactions and diffusive jumps to each neighbor are competing events, and
+//  the subvolume's next event time is drawn as in Gillespie:
+//  an exponential waiting time for the total rate plus DelayTime(waiting)
+//  The next event times of all subvolumes are kept in an indexed binary heap,
+//  so each event costs O(log nr_subvolumes), with rates updated only in the
+//  subvolumes it changes
+//  The event is picked when it fires, which is equivalent to picking it
+//  when it was drawn since the subvolume state does not change in between;
+//  a subvolume whose state changes through an arriving particle or set
+//  draws a new event time from the current time
+//  Particle numbers are 32-bit, to halve the memory of large grids,
+//  and a change that would exceed their range throws std::overflow_error
+
+#ifndef NextSubvolume_h
+#define NextSubvolume_h
+
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+#include "general/IndexedHeap.h"
+#include "general/Operations.h"
+#include "general/useful.h"
+#include "Stochastic/Random.h"
+#include "Stochastic/Stoichiometry.h"
+#include "DelayTime.h"
+
+namespace gillespie
+{
+  //  Reaction rates are given for concentrations, as numbers per unit volume,
+  //  and are scaled by the subvolume volume spacing^dimensions
+  //  Engine_t is the random number engine for waiting times and event choice
+  template <typename DelayTime = stochastic::DelayTime_NoDelay, typename Engine_t = std::mt19937>
+  class NextSubvolume
+  {
+  public:
+    using Count = std::uint32_t;
+    using Stoichiometry = stochastic::Stoichiometry;
+
+    //  shape holds the number of subvolumes along each dimension,
+    //  and diffusivities the diffusion coefficient of each species
+    NextSubvolume
+    (std::vector<std::size_t> const& shape, double spacing,
+     std::vector<double> const& diffusivities, std::vector<Stoichiometry> const& stoichiometries,
+     DelayTime delay_time = {}, double time = 0.)
+    : shape{ shape }
+    , nr_species{ diffusivities.size() }
+    , nr_subvolumes{ std::accumulate(shape.begin(), shape.end(), std::size_t(1), std::multiplies<>{}) }
+    , time_current{ time }
+    , delay_time{ delay_time }
+    , counts(nr_subvolumes * nr_species, 0)
+    , rate_reaction(nr_subvolumes, 0.)
+    , rate_diffusion(nr_subvolumes, 0.)
+    , heap{ nr_subvolumes }
+    {
+      if (shape.empty() || shape.size() > 3 || nr_subvolumes == 0 || spacing <= 0.)
+        throw useful::bad_parameters();
+      std::size_t stride = 1;
+      for (auto size : shape)
+      {
+        strides.push_back(stride);
+        stride *= size;
+      }
+      for (auto diffusivity : diffusivities)
+        jump_rates.push_back(diffusivity / (spacing * spacing));
+      volume = std::pow(spacing, double(shape.size()));
+      for (auto const& stoichiometry : stoichiometries)
+        add(stoichiometry);
+      propensities.resize(reactions.size());
+    }
+
+    //  Reseed all random streams, e.g. to key them to a realization index
+    //  Event times already drawn are kept, so call before set
+    void seed(std::uint64_t value)
+    {
+      rng.seed(typename Engine_t::result_type(stochastic::seed_realization(value, 0)));
+      stochastic::seed_generator(delay_time, stochastic::seed_realization(value, 1));
+    }
+
+    //  Set particle numbers of all species in all subvolumes,
+    //  indexed by subvolume * nr_species + species, and draw all event times
+    void set(std::vector<Count> const& particles, double time)
+    {
+      if (particles.size() != counts.size())
+        throw useful::bad_parameters();
+      counts = particles;
+      time_current = time;
+      std::vector<double> times(nr_subvolumes);
+      for (std::size_t subvolume = 0; subvolume < nr_subvolumes; ++subvolume)
+      {
+        rates(subvolume);
+        times[subvolume] = time_next(subvolume);
+      }
+      heap.assign(times);
+    }
+
+    //  Set the particle number of a species in a subvolume
+    void set(std::size_t subvolume, std::size_t species, Count count)
+    {
+      counts[subvolume * nr_species + species] = count;
+      refresh(subvolume);
+    }
+
+    void add(std::size_t subvolume, std::size_t species, Count increment = 1)
+    {
+      Count& count = counts[subvolume * nr_species + species];
+      if (increment > std::numeric_limits<Count>::max() - count)
+        throw overflow();
+      count += increment;
+      refresh(subvolume);
+    }
+
+    //  Fire the next event, if any
+    void evolve()
+    {
+      if (heap.top_key() == std::numeric_limits<double>::infinity())
+      {
+        time_current = heap.top_key();
+        return;
+      }
+      fire();
+    }
+
+    //  Fire all events before time_max and set the time to time_max
+    //  Drawn event times are kept, so stopping at intermediate times
+    //  does not change the dynamics
+    void advance(double time_max)
+    {
+      while (heap.top_key() < time_max)
+        fire();
+      time_current = time_max;
+    }
+
+    //  Advance through the sorted observation times in a single pass,
+    //  calling observer(index, *this) at each times[index]
+    template <typename Times, typename Observer>
+    void observe(Times const& times, Observer&& observer)
+    {
+      std::size_t index = 0;
+      for (auto const& time_observe : times)
+      {
+        advance(time_observe);
+        observer(index++, std::as_const(*this));
+      }
+    }
+
+    double time() const
+    { return time_current; }
+
+    //  Time of the next event
+    double time_next() const
+    { return heap.top_key(); }
+
+    Count particles(std::size_t subvolume, std::size_t species) const
+    { return counts[subvolume * nr_species + species]; }
+
+    //  Particle numbers, indexed by subvolume * nr_species + species
+    std::vector<Count> const& particles() const
+    { return counts; }
+
+    //  Total particle number of a species
+    std::size_t total(std::size_t species) const
+    {
+      std::size_t sum = 0;
+      for (std::size_t subvolume = 0; subvolume < nr_subvolumes; ++subvolume)
+        sum += counts[subvolume * nr_species + species];
+      return sum;
+    }
+
+    std::size_t size() const
+    { return nr_subvolumes; }
+
+    std::size_t nr_types() const
+    { return nr_species; }
+
+    std::size_t dimensions() const
+    { return shape.size(); }
+
+    //  Subvolume index of grid coordinates, first coordinate fastest
+    std::size_t subvolume(std::vector<std::size_t> const& coordinates) const
+    {
+      std::size_t index = 0;
+      for (std::size_t dim = 0; dim < shape.size(); ++dim)
+        index += coordinates[dim] * strides[dim];
+      return index;
+    }
+
+    std::size_t coordinate(std::size_t subvolume, std::size_t dim) const
+    { return subvolume / strides[dim] % shape[dim]; }
+
+    std::size_t nr_events() const
+    { return events; }
+
+  private:
+    struct Reaction
+    {
+      double rate;                                                // Per subvolume, over coefficient factorials
+      std::vector<std::pair<std::size_t, std::size_t>> reactants;
+      std::vector<std::pair<std::size_t, long>> changes;          // Net change of each affected species
+    };
+
+    const std::vector<std::size_t> shape;
+    const std::size_t nr_species;
+    const std::size_t nr_subvolumes;
+    std::vector<std::size_t> strides;
+    std::vector<double> jump_rates;             // Per neighbor, of each species
+    double volume;
+    std::vector<Reaction> reactions;
+    double time_current;
+    DelayTime delay_time;
+    Engine_t rng{ std::random_device{}() };
+    stochastic::exponential_ziggurat_distribution<double> exp_dist{ 1. };
+    std::uniform_real_distribution<double> unif_dist{ 0., 1. };
+    std::size_t events{ 0 };
+
+    std::vector<Count> counts;
+    std::vector<double> rate_reaction;          // Total reaction rate in each subvolume
+    std::vector<double> rate_diffusion;         // Total jump rate out of each subvolume
+    useful::IndexedHeap heap;                   // Next event time of each subvolume
+    std::vector<double> propensities;
+
+    void add(Stoichiometry const& stoichiometry)
+    {
+      Reaction reaction{ stoichiometry.reaction_rate, stoichiometry.reactants, {} };
+      std::size_t order = 0;
+      for (auto const& reactant : stoichiometry.reactants)
+      {
+        if (reactant.first >= nr_species)
+          throw useful::bad_parameters();
+        reaction.rate /= double(operation::factorial(reactant.second));
+        order += reactant.second;
+      }
+      reaction.rate *= std::pow(volume, 1. - double(order));
+      auto change = [&reaction](std::size_t species, long val)
+      {
+        for (auto& entry : reaction.changes)
+          if (entry.first == species)
+          {
+            entry.second += val;
+            return;
+          }
+        reaction.changes.emplace_back(species, val);
+      };
+      for (auto const& reactant : stoichiometry.reactants)
+        change(reactant.first, -long(reactant.second));
+      for (auto const& product : stoichiometry.products)
+      {
+        if (product.first >= nr_species)
+          throw useful::bad_parameters();
+        change(product.first, long(product.second));
+      }
+      reactions.push_back(std::move(reaction));
+    }
+
+    std::size_t nr_neighbors(std::size_t subvolume) const
+    {
+      std::size_t nr = 0;
+      for (std::size_t dim = 0; dim < shape.size(); ++dim)
+      {
+        std::size_t coord = coordinate(subvolume, dim);
+        nr += (coord > 0) + (coord + 1 < shape[dim]);
+      }
+      return nr;
+    }
+
+    double propensity(Reaction const& reaction, Count const* particles) const
+    {
+      double rate = reaction.rate;
+      for (auto const& reactant : reaction.reactants)
+        rate *= double(operation::factorial_incomplete(particles[reactant.first], reactant.second));
+      return rate;
+    }
+
+    static std::overflow_error overflow()
+    { return std::overflow_error{ "NextSubvolume: Particle number out of range" }; }
+
+    //  Update the total rates of a subvolume
+    void rates(std::size_t subvolume)
+    {
+      Count const* particles = &counts[subvolume * nr_species];
+      double reaction_sum = 0.;
+      for (auto const& reaction : reactions)
+        reaction_sum += propensity(reaction, particles);
+      double jump_sum = 0.;
+      for (std::size_t species = 0; species < nr_species; ++species)
+        jump_sum += particles[species] * jump_rates[species];
+      rate_reaction[subvolume] = reaction_sum;
+      rate_diffusion[subvolume] = jump_sum * double(nr_neighbors(subvolume));
+    }
+
+    //  Draw the next event time of a subvolume from the current time
+    double time_next(std::size_t subvolume)
+    {
+      double rate_total = rate_reaction[subvolume] + rate_diffusion[subvolume];
+      if (rate_total <= 0.)
+        return std::numeric_limits<double>::infinity();
+      double waiting = exp_dist(rng) / rate_total;
+      return time_current + waiting + delay_time(waiting);
+    }
+
+    //  Update rates and draw a new event time after a state change
+    void refresh(std::size_t subvolume)
+    {
+      rates(subvolume);
+      heap.update(subvolume, time_next(subvolume));
+    }
+
+    //  Execute the next event
+    void fire()
+    {
+      std::size_t subvolume = heap.top();
+      time_current = heap.top_key();
+      ++events;
+      Count* particles = &counts[subvolume * nr_species];
+      double choice = unif_dist(rng) * (rate_reaction[subvolume] + rate_diffusion[subvolume]);
+
+      if (choice < rate_reaction[subvolume] || rate_diffusion[subvolume] == 0.)
+      {
+        std::size_t picked = reactions.size();
+        for (std::size_t rr = 0; rr < reactions.size(); ++rr)
+        {
+          propensities[rr] = propensity(reactions[rr], particles);
+          if (propensities[rr] > 0.)
+          {
+            picked = rr;
+            if (choice < propensities[rr])
+              break;
+            choice -= propensities[rr];
+          }
+        }
+        for (auto const& entry : reactions[picked].changes)
+        {
+          long count = long(particles[entry.first]) + entry.second;
+          if (count > long(std::numeric_limits<Count>::max()))
+            throw overflow();
+          particles[entry.first] = Count(count);
+        }
+        refresh(subvolume);
+        return;
+      }
+
+      //  Diffusive jump: species in proportion to its jump rate,
+      //  then a neighbor uniformly
+      choice -= rate_reaction[subvolume];
+      std::size_t nr = nr_neighbors(subvolume);
+      std::size_t species_picked = nr_species;
+      for (std::size_t species = 0; species < nr_species; ++species)
+      {
+        double rate = particles[species] * jump_rates[species] * double(nr);
+        if (rate > 0.)
+        {
+          species_picked = species;
+          if (choice < rate)
+            break;
+          choice -= rate;
+        }
+      }
+      std::size_t neighbor_picked = std::min(std::size_t(unif_dist(rng) * double(nr)), nr - 1);
+      std::size_t target = subvolume;
+      for (std::size_t dim = 0; dim < shape.size(); ++dim)
+      {
+        std::size_t coord = coordinate(subvolume, dim);
+        if (coord > 0 && neighbor_picked-- == 0)
+        {
+          target = subvolume - strides[dim];
+          break;
+        }
+        if (coord + 1 < shape[dim] && neighbor_picked-- == 0)
+        {
+          target = subvolume + strides[dim];
+          break;
+        }
+      }
+      Count& arriving = counts[target * nr_species + species_picked];
+      if (arriving == std::numeric_limits<Count>::max())
+        throw overflow();
+      --particles[species_picked];
+      ++arriving;
+      refresh(subvolume);
+      refresh(target);
+    }
+  };
+}
+
+#endif /* NextSubvolume_h */
@@ -16,23 +16,29 @@
 #define WaitingTime_h
 
 #include <cmath>
+#include <cstdint>
 #include <vector>
 #include <random>
 #include "general/Operations.h"
+#include "Stochastic/Random.h"
 
 namespace gillespie
 {
   //  Standard Gillespie exponential waiting time
+	template <typename Engine_t = std::mt19937>
 	class WaitingTime_Exponential
 	{
 	public:
 		template <typename Container>
 		double operator() (Container const& rates, std::size_t reaction = 0)
 		{ return dist(rng)/operation::sum(rates); }
+
+		void seed(std::uint64_t value)
+		{ rng.seed(typename Engine_t::result_type(value)); }
     
 	private:
-		std::exponential_distribution<double> dist{ 1. };
-		std::mt19937 rng{ std::random_device{}() };
+		stochastic::exponential_ziggurat_distribution<double> dist{ 1. };
+		Engine_t rng{ std::random_device{}() };
 	};
 }
 
@@ -0,0 +1,194 @@
+//
+//  WeightedEnsemble.h
+//  Stochastic
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Weighted-ensemble resampling of a population of simulator replicas
+//  (Huber and Kim, Biophys. J. 70, 1996; Zhang, Jasnow and Zuckerman, J. Chem. Phys. 132, 2010)
+//  Replicas carry weights summing to one and are advanced independently;
+//  at each resampling they are binned by a progress coordinate, and within each
+//  occupied bin the heaviest replicas are split and the lightest merged until
+//  the bin holds replicas_per_bin replicas, conserving the total weight of the bin
+//  A merge keeps one of two replicas with probability proportional to its weight,
+//  so that weighted averages remain unbiased, and effort stays spread over
+//  the bins however improbable they become
+//  Simulator must be copyable, including its random number state, and implement
+//  void advance(double time) and void seed(std::uint64_t value), used to decorrelate
+//  the copy made by a split; Gillespie_Engine qualifies
+//  Progress must implement double operator()(Simulator const&)
+
+#ifndef WeightedEnsemble_h
+#define WeightedEnsemble_h
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <random>
+#include <utility>
+#include <vector>
+#include "general/Parallel.h"
+#include "general/useful.h"
+#include "Stochastic/Random.h"
+
+namespace gillespie
+{
+  template <typename Simulator, typename Progress, typename Engine_t = std::mt19937>
+  class WeightedEnsemble
+  {
+  public:
+    struct Replica
+    {
+      Simulator simulator;
+      double weight;
+    };
+
+    //  Bin bb holds progress values in [bin_edges[bb - 1], bin_edges[bb]),
+    //  with bins below the first and from the last edge
+    //  The population starts as replicas_per_bin copies of simulator
+    WeightedEnsemble(Simulator const& simulator, Progress progress,
+                     std::vector<double> bin_edges, std::size_t replicas_per_bin)
+    : progress{ progress }
+    , bin_edges{ bin_edges }
+    , replicas_per_bin{ std::max(replicas_per_bin, std::size_t(1)) }
+    {
+      if (!std::is_sorted(this->bin_edges.begin(), this->bin_edges.end()))
+        throw useful::bad_parameters();
+      reset(simulator);
+    }
+
+    //  Restart from replicas_per_bin copies of simulator
+    void reset(Simulator const& simulator)
+    {
+      replicas.clear();
+      replicas.reserve(replicas_per_bin);
+      for (std::size_t rr = 0; rr < replicas_per_bin; ++rr)
+      {
+        replicas.push_back(Replica{ simulator, 1. / double(replicas_per_bin) });
+        replicas.back().simulator.seed(stochastic::random_bits_64(rng));
+      }
+    }
+
+    //  Seed the resampling and the streams of new copies
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
+    //  Advance all replicas to time, on nr_threads threads
+    void advance(double time, std::size_t nr_threads = 1)
+    {
+      parallel::for_each_index(0, replicas.size(), nr_threads,
+        [this, time](std::size_t index)
+        { replicas[index].simulator.advance(time); });
+    }
+
+    //  Split and merge replicas within each occupied bin
+    void resample()
+    {
+      std::vector<std::vector<Replica>> bins(bin_edges.size() + 1);
+      for (auto& replica : replicas)
+        bins[bin(replica.simulator)].push_back(std::move(replica));
+      replicas.clear();
+      for (auto& members : bins)
+      {
+        if (members.empty())
+          continue;
+        merge(members);
+        split(members);
+        for (auto& member : members)
+          replicas.push_back(std::move(member));
+      }
+    }
+
+    //  Weighted average of function(simulator) over replicas
+    template <typename Function>
+    double average(Function&& function) const
+    {
+      double sum = 0.;
+      for (auto const& replica : replicas)
+        sum += replica.weight * double(function(replica.simulator));
+      return sum;
+    }
+
+    double total_weight() const
+    {
+      double sum = 0.;
+      for (auto const& replica : replicas)
+        sum += replica.weight;
+      return sum;
+    }
+
+    std::size_t size() const
+    { return replicas.size(); }
+
+    std::size_t bin(Simulator const& simulator) const
+    {
+      return std::size_t(std::upper_bound(bin_edges.begin(), bin_edges.end(), progress(simulator))
+                         - bin_edges.begin());
+    }
+
+    std::vector<Replica> const& population() const
+    { return replicas; }
+
+  private:
+    Progress progress;
+    const std::vector<double> bin_edges;
+    const std::size_t replicas_per_bin;
+    std::vector<Replica> replicas;
+    Engine_t rng{ std::random_device{}() };
+    std::uniform_real_distribution<double> unif_dist{ 0., 1. };
+
+    //  Merge the two lightest replicas until at most replicas_per_bin remain
+    //  Works on indices, as simulators need only be copy and move constructible
+    void merge(std::vector<Replica>& members)
+    {
+      if (members.size() <= replicas_per_bin)
+        return;
+      std::vector<double> weights(members.size());
+      std::vector<std::size_t> alive(members.size());
+      for (std::size_t mm = 0; mm < members.size(); ++mm)
+      {
+        weights[mm] = members[mm].weight;
+        alive[mm] = mm;
+      }
+      while (alive.size() > replicas_per_bin)
+      {
+        std::partial_sort(alive.begin(), alive.begin() + 2, alive.end(),
+          [&weights](std::size_t left, std::size_t right)
+          { return weights[left] < weights[right]; });
+        double weight = weights[alive[0]] + weights[alive[1]];
+        std::size_t kept = unif_dist(rng) * weight < weights[alive[0]] ? 0 : 1;
+        std::size_t removed = 1 - kept;
+        weights[alive[kept]] = weight;
+        alive[removed] = alive.back();
+        alive.pop_back();
+      }
+      std::vector<Replica> merged;
+      merged.reserve(alive.size());
+      for (std::size_t mm : alive)
+      {
+        merged.push_back(std::move(members[mm]));
+        merged.back().weight = weights[mm];
+      }
+      members.swap(merged);
+    }
+
+    //  Split the heaviest replica in two until replicas_per_bin are present
+    void split(std::vector<Replica>& members)
+    {
+      while (members.size() < replicas_per_bin)
+      {
+        auto heaviest = std::max_element(members.begin(), members.end(),
+          [](Replica const& left, Replica const& right)
+          { return left.weight < right.weight; });
+        heaviest->weight /= 2.;
+        Replica copy = *heaviest;
+        copy.simulator.seed(stochastic::random_bits_64(rng));
+        members.push_back(std::move(copy));
+      }
+    }
+  };
+}
+
+#endif /* WeightedEnsemble_h */
@@ -15,9 +15,13 @@
 #include <array>
 #include <cmath>
 #include <complex>
+#include <iterator>
+#include <cstdint>
+#include <limits>
 #include <list>
 #include <random>
 #include <stdexcept>
+#include <type_traits>
 #include <utility>
 #include <vector>
 #include "general/Constants.h"
@@ -27,7 +31,163 @@
 
 namespace stochastic
 {
-  
+  // xoshiro256++ engine (Blackman and Vigna, "Scrambled linear pseudorandom
+  // number generators", 2021), with 32 bytes of state against about 2.5 kB
+  // for std::mt19937, for objects that each own an engine
+  // Satisfies the standard random number engine interface; period 2^256 - 1
+  class xoshiro256pp
+  {
+  public:
+    using result_type = std::uint64_t;
+
+    static constexpr result_type min()
+    { return 0; }
+
+    static constexpr result_type max()
+    { return std::numeric_limits<result_type>::max(); }
+
+    static constexpr result_type default_seed = 0x9e3779b97f4a7c15;
+
+    explicit xoshiro256pp(result_type value = default_seed)
+    { seed(value); }
+
+    template <typename Sseq, typename = std::enable_if_t<!std::is_arithmetic<Sseq>::value
+                                                       && !std::is_same<Sseq, xoshiro256pp>::value>>
+    explicit xoshiro256pp(Sseq& sequence)
+    { seed(sequence); }
+
+    // State from a single value expanded by splitmix64, never all zero
+    void seed(result_type value = default_seed)
+    {
+      for (auto& word : state)
+        word = splitmix64(value);
+    }
+
+    template <typename Sseq, typename = std::enable_if_t<!std::is_arithmetic<Sseq>::value>>
+    void seed(Sseq& sequence)
+    {
+      std::array<std::uint32_t, 8> words;
+      sequence.generate(words.begin(), words.end());
+      for (std::size_t ii = 0; ii < 4; ++ii)
+        state[ii] = (std::uint64_t(words[2 * ii]) << 32) | words[2 * ii + 1];
+      if (!(state[0] | state[1] | state[2] | state[3]))
+        seed();
+    }
+
+    result_type operator()()
+    { return next(state[0], state[1], state[2], state[3]); }
+
+    // Fill [first, last) with consecutive outputs, with the state held in registers
+    template <typename OutputIt>
+    void fill(OutputIt first, OutputIt last)
+    {
+      std::uint64_t s0 = state[0], s1 = state[1], s2 = state[2], s3 = state[3];
+      for (; first != last; ++first)
+        *first = next(s0, s1, s2, s3);
+      state = { s0, s1, s2, s3 };
+    }
+
+    void discard(unsigned long long nr)
+    {
+      for (; nr; --nr)
+        (*this)();
+    }
+
+    // Advance by 2^128 steps, to split a seed into non-overlapping streams
+    void jump()
+    {
+      constexpr std::uint64_t polynomial[] = {
+        0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c };
+      std::array<std::uint64_t, 4> jumped{};
+      for (auto word : polynomial)
+        for (int bit = 0; bit < 64; ++bit)
+        {
+          if (word & (std::uint64_t(1) << bit))
+            for (std::size_t ii = 0; ii < 4; ++ii)
+              jumped[ii] ^= state[ii];
+          (*this)();
+        }
+      state = jumped;
+    }
+
+    friend bool operator==(xoshiro256pp const& left, xoshiro256pp const& right)
+    { return left.state == right.state; }
+
+    friend bool operator!=(xoshiro256pp const& left, xoshiro256pp const& right)
+    { return !(left == right); }
+
+  private:
+    std::array<std::uint64_t, 4> state;
+
+    static std::uint64_t rotl(std::uint64_t val, int shift)
+    { return (val << shift) | (val >> (64 - shift)); }
+
+    static std::uint64_t next(std::uint64_t& s0, std::uint64_t& s1, std::uint64_t& s2, std::uint64_t& s3)
+    {
+      std::uint64_t result = rotl(s0 + s3, 23) + s0;
+      std::uint64_t tt = s1 << 17;
+      s2 ^= s0;
+      s3 ^= s1;
+      s1 ^= s2;
+      s0 ^= s3;
+      s2 ^= tt;
+      s3 = rotl(s3, 45);
+      return result;
+    }
+
+    static std::uint64_t splitmix64(std::uint64_t& value)
+    {
+      std::uint64_t zz = (value += 0x9e3779b97f4a7c15);
+      zz = (zz ^ (zz >> 30)) * 0xbf58476d1ce4e5b9;
+      zz = (zz ^ (zz >> 27)) * 0x94d049bb133111eb;
+      return zz ^ (zz >> 31);
+    }
+  };
+
+  // Mix of the bits of val (splitmix64 finalizer)
+  inline std::uint64_t mix64(std::uint64_t val)
+  {
+    val = (val ^ (val >> 30)) * 0xbf58476d1ce4e5b9;
+    val = (val ^ (val >> 27)) * 0x94d049bb133111eb;
+    return val ^ (val >> 31);
+  }
+
+  // Seed of random stream number stream for realization index under a base seed,
+  // for common random numbers: the same (base, index, stream) always gives
+  // the same seed, and different ones give decorrelated seeds
+  inline std::uint64_t seed_realization(std::uint64_t base, std::uint64_t index, std::uint64_t stream = 0)
+  {
+    return mix64(mix64(mix64(base + 0x9e3779b97f4a7c15) ^ index) ^ (stream + 0x632be59bd9b4e019));
+  }
+
+  template <typename Generator>
+  using seed_method_t = decltype(std::declval<Generator&>().seed(std::uint64_t{}));
+
+  // Seed a generator through its seed method if it has one,
+  // and leave it alone otherwise (e.g. for constant generators)
+  template <typename Generator>
+  void seed_generator(Generator& generator, std::uint64_t value)
+  {
+    if constexpr (useful::has_method<seed_method_t, Generator>::value)
+      generator.seed(value);
+  }
+
+  template <typename Distribution_t, typename OutputIt, typename Generator>
+  using fill_method_t = decltype(std::declval<Distribution_t&>().fill(
+    std::declval<OutputIt>(), std::declval<OutputIt>(), std::declval<Generator&>()));
+
+  // Fill [first, last) with draws from dist,
+  // using dist.fill(first, last, rng) if it exists
+  template <typename Distribution_t, typename OutputIt, typename Generator>
+  void fill_distribution(Distribution_t& dist, OutputIt first, OutputIt last, Generator& rng)
+  {
+    if constexpr (useful::has_method<fill_method_t, Distribution_t, OutputIt, Generator>::value)
+      dist.fill(first, last, rng);
+    else
+      for (; first != last; ++first)
+        *first = dist(rng);
+  }
+
   // Wrapper for random number generation with own rng
   template <typename Distribution_t, typename Engine_t = std::mt19937>
   struct RNG
@@ -43,6 +203,14 @@ namespace stochastic
     result_type operator() ()
     { return dist(rng); }
 
+    // Fill [first, last) with draws, in bulk if the distribution supports it
+    template <typename OutputIt>
+    void fill(OutputIt first, OutputIt last)
+    { fill_distribution(dist, first, last, rng); }
+
+    void seed(std::uint64_t value)
+    { rng.seed(typename Engine_t::result_type(value)); }
+
     Distribution_t dist;
 
   private:
@@ -65,12 +233,336 @@ namespace stochastic
     result_type operator() ()
     { return dist(rng); }
 
+    template <typename OutputIt>
+    void fill(OutputIt first, OutputIt last)
+    { fill_distribution(dist, first, last, rng); }
+
     Distribution_t dist;
 
   private:
     Engine_t& rng;
   };
 
+  // 64 uniformly random bits from any engine
+  // Engines producing 32 bits are called twice,
+  // other ranges go through std::uniform_int_distribution
+  template <typename Generator>
+  std::uint64_t random_bits_64(Generator& rng)
+  {
+    constexpr auto range = Generator::max() - Generator::min();
+    if constexpr (Generator::min() == 0
+                  && range == std::numeric_limits<std::uint64_t>::max())
+      return rng();
+    else if constexpr (Generator::min() == 0
+                       && range == std::numeric_limits<std::uint32_t>::max())
+    {
+      std::uint64_t high = rng();
+      return (high << 32) | std::uint64_t(rng());
+    }
+    else
+      return std::uniform_int_distribution<std::uint64_t>{}(rng);
+  }
+
+  // Uniform double in [0, 1) from the top 53 of 64 random bits
+  inline double bits_to_uniform(std::uint64_t bits)
+  { return double(bits >> 11) * 0x1.0p-53; }
+
+  // Ziggurat method (Marsaglia and Tsang, 2000) for monotone decreasing densities
+  // Each draw picks a layer of equal area v from 8 random bits
+  // and accepts without evaluating the density except in the
+  // thin wedges and the tail, i.e. a small fraction of draws
+  namespace ziggurat
+  {
+    constexpr std::size_t nr_layers = 256;
+
+    // Layer edges x[0] > x[1] = r > ... > x[nr_layers] = 0
+    // x[0] is the width of the base layer including the tail,
+    // f holds the (unnormalized) density at each edge
+    struct Table
+    {
+      std::array<double, nr_layers + 1> x;
+      std::array<double, nr_layers + 1> f;
+    };
+
+    // r : tail start
+    // v : area of each layer
+    template <typename Density, typename Inverse>
+    Table make_table(double r, double v, Density density, Inverse inverse)
+    {
+      Table table;
+      table.x[0] = v / density(r);
+      table.x[1] = r;
+      for (std::size_t ii = 2; ii < nr_layers; ++ii)
+        table.x[ii] = inverse(std::min(density(table.x[ii-1]) + v / table.x[ii-1], 1.));
+      table.x[nr_layers] = 0.;
+      for (std::size_t ii = 0; ii <= nr_layers; ++ii)
+        table.f[ii] = density(table.x[ii]);
+
+      return table;
+    }
+
+    // exp(-x)
+    inline Table const& table_exponential()
+    {
+      static const Table table = make_table(
+        7.69711747013104972, 3.949659822581572e-3,
+        [](double xx){ return std::exp(-xx); },
+        [](double yy){ return -std::log(yy); });
+      return table;
+    }
+
+    // exp(-x^2/2)
+    inline Table const& table_normal()
+    {
+      static const Table table = make_table(
+        3.6541528853610088, 4.92867323399e-3,
+        [](double xx){ return std::exp(-0.5 * xx * xx); },
+        [](double yy){ return std::sqrt(-2. * std::log(yy)); });
+      return table;
+    }
+
+    // Unit-rate exponential, after a candidate xx in layer
+    // fell outside the rectangle fast path
+    // Returns the tail or wedge value if accepted, a fresh draw otherwise
+    template <typename Generator>
+    double exponential_outside(std::size_t layer, double xx, Generator& rng);
+
+    // Unit-rate exponential
+    template <typename Generator>
+    double exponential(Generator& rng)
+    {
+      Table const& table = table_exponential();
+      std::uint64_t bits = random_bits_64(rng);
+      std::size_t layer = bits & 0xff;
+      double xx = bits_to_uniform(bits) * table.x[layer];
+      if (xx < table.x[layer+1])
+        return xx;
+      return exponential_outside(layer, xx, rng);
+    }
+
+    template <typename Generator>
+    double exponential_outside(std::size_t layer, double xx, Generator& rng)
+    {
+      Table const& table = table_exponential();
+      // Tail, memoryless beyond r
+      if (layer == 0)
+        return table.x[1] - std::log1p(-bits_to_uniform(random_bits_64(rng)));
+      // Wedge
+      if (table.f[layer] + bits_to_uniform(random_bits_64(rng))
+          * (table.f[layer+1] - table.f[layer]) < std::exp(-xx))
+        return xx;
+      return exponential(rng);
+    }
+
+    // Standard normal
+    template <typename Generator>
+    double normal(Generator& rng)
+    {
+      Table const& table = table_normal();
+      while (1)
+      {
+        std::uint64_t bits = random_bits_64(rng);
+        std::size_t layer = bits & 0xff;
+        double sign = bits & 0x100 ? -1. : 1.;
+        double xx = bits_to_uniform(bits) * table.x[layer];
+        if (xx < table.x[layer+1])
+          return sign * xx;
+        // Tail beyond r (Marsaglia, 1964)
+        if (layer == 0)
+        {
+          double tail, yy;
+          do
+          {
+            tail = -std::log1p(-bits_to_uniform(random_bits_64(rng))) / table.x[1];
+            yy = -std::log1p(-bits_to_uniform(random_bits_64(rng)));
+          } while (yy + yy < tail * tail);
+          return sign * (table.x[1] + tail);
+        }
+        // Wedge
+        if (table.f[layer] + bits_to_uniform(random_bits_64(rng))
+            * (table.f[layer+1] - table.f[layer]) < std::exp(-0.5 * xx * xx))
+          return sign * xx;
+      }
+    }
+  }
+
+  // Exponential distribution sampled with the ziggurat method
+  // Drop-in replacement for std::exponential_distribution
+  template <typename Value_type = double>
+  class exponential_ziggurat_distribution
+  {
+  public:
+    using result_type = Value_type;
+
+    struct param_type
+    {
+      using distribution_type = exponential_ziggurat_distribution;
+
+      explicit param_type(Value_type lambda = 1.)
+      : lambda_val{ lambda }
+      {}
+
+      Value_type lambda() const
+      { return lambda_val; }
+
+      friend bool operator==(param_type const& left, param_type const& right)
+      { return left.lambda_val == right.lambda_val; }
+
+      friend bool operator!=(param_type const& left, param_type const& right)
+      { return !(left == right); }
+
+    private:
+      Value_type lambda_val;
+    };
+
+    explicit exponential_ziggurat_distribution(Value_type lambda = 1.)
+    : params{ lambda }
+    {}
+
+    explicit exponential_ziggurat_distribution(param_type const& params)
+    : params{ params }
+    {}
+
+    template <typename Generator>
+    result_type operator() (Generator& rng)
+    { return result_type(mean * ziggurat::exponential(rng)); }
+
+    template <typename Generator>
+    result_type operator() (Generator& rng, param_type const& params)
+    { return result_type(ziggurat::exponential(rng) / params.lambda()); }
+
+    // Fill [first, last) with draws
+    // Random bits for a block are drawn first, then the rectangle fast path
+    // runs as a branch-free loop, and only the remaining entries
+    // go through the wedge and tail steps
+    template <typename OutputIt, typename Generator>
+    void fill(OutputIt first, OutputIt last, Generator& rng)
+    {
+      constexpr std::size_t block_size = 64;
+      ziggurat::Table const& table = ziggurat::table_exponential();
+      std::array<std::uint64_t, block_size> bits;
+      std::array<double, block_size> values;
+      std::array<bool, block_size> accepted;
+      std::array<std::size_t, block_size> layers;
+      for (auto remaining = std::distance(first, last); remaining > 0; remaining -= block_size)
+      {
+        std::size_t nr_values = std::min(std::size_t(remaining), block_size);
+        for (std::size_t ii = 0; ii < nr_values; ++ii)
+          bits[ii] = random_bits_64(rng);
+        for (std::size_t ii = 0; ii < nr_values; ++ii)
+        {
+          layers[ii] = bits[ii] & 0xff;
+          values[ii] = bits_to_uniform(bits[ii]) * table.x[layers[ii]];
+          accepted[ii] = values[ii] < table.x[layers[ii]+1];
+        }
+        for (std::size_t ii = 0; ii < nr_values; ++ii, ++first)
+          *first = result_type(mean * (accepted[ii]
+            ? values[ii]
+            : ziggurat::exponential_outside(layers[ii], values[ii], rng)));
+      }
+    }
+
+    void reset()
+    {}
+
+    Value_type lambda() const
+    { return params.lambda(); }
+
+    param_type param() const
+    { return params; }
+
+    void param(param_type const& params_new)
+    {
+      params = params_new;
+      mean = 1. / params.lambda();
+    }
+
+    result_type min() const
+    { return 0.; }
+
+    result_type max() const
+    { return std::numeric_limits<result_type>::infinity(); }
+
+  private:
+    param_type params;
+    double mean{ 1. / params.lambda() };
+  };
+
+  // Normal distribution sampled with the ziggurat method
+  // Drop-in replacement for std::normal_distribution
+  template <typename Value_type = double>
+  class normal_ziggurat_distribution
+  {
+  public:
+    using result_type = Value_type;
+
+    struct param_type
+    {
+      using distribution_type = normal_ziggurat_distribution;
+
+      explicit param_type(Value_type mean = 0., Value_type stddev = 1.)
+      : mean_val{ mean }
+      , stddev_val{ stddev }
+      {}
+
+      Value_type mean() const
+      { return mean_val; }
+
+      Value_type stddev() const
+      { return stddev_val; }
+
+      friend bool operator==(param_type const& left, param_type const& right)
+      { return left.mean_val == right.mean_val && left.stddev_val == right.stddev_val; }
+
+      friend bool operator!=(param_type const& left, param_type const& right)
+      { return !(left == right); }
+
+    private:
+      Value_type mean_val;
+      Value_type stddev_val;
+    };
+
+    explicit normal_ziggurat_distribution(Value_type mean = 0., Value_type stddev = 1.)
+    : params{ mean, stddev }
+    {}
+
+    explicit normal_ziggurat_distribution(param_type const& params)
+    : params{ params }
+    {}
+
+    template <typename Generator>
+    result_type operator() (Generator& rng)
+    { return (*this)(rng, params); }
+
+    template <typename Generator>
+    result_type operator() (Generator& rng, param_type const& params)
+    { return result_type(params.mean() + params.stddev() * ziggurat::normal(rng)); }
+
+    void reset()
+    {}
+
+    Value_type mean() const
+    { return params.mean(); }
+
+    Value_type stddev() const
+    { return params.stddev(); }
+
+    param_type param() const
+    { return params; }
+
+    void param(param_type const& params_new)
+    { params = params_new; }
+
+    result_type min() const
+    { return -std::numeric_limits<result_type>::infinity(); }
+
+    result_type max() const
+    { return std::numeric_limits<result_type>::infinity(); }
+
+  private:
+    param_type params;
+  };
+
   // Skewed Levy stable distribution
   // alpha : exponent, pdf $\sim t^{-1-\alpha}$
   // sigma : scale parameter
@@ -115,9 +607,38 @@ namespace stochastic
       return sigma * vv * tt * ss + mu;
     }
 
+    // Fill [first, last) with draws
+    // The uniform and exponential variates of a block are drawn first,
+    // so that the transform runs as a loop free of random number generation,
+    // with its two powers combined into a single exponential
+    template <typename OutputIt, typename Generator>
+    void fill(OutputIt first, OutputIt last, Generator& rng)
+    {
+      constexpr std::size_t block_size = 64;
+      const double exponent_cos = 1. / alpha;
+      const double exponent_ratio = (1. - alpha) / alpha;
+      const double scale = sigma * vv;
+      std::array<double, block_size> uniforms;
+      std::array<double, block_size> exponentials;
+      for (auto remaining = std::distance(first, last); remaining > 0; remaining -= block_size)
+      {
+        std::size_t nr_values = std::min(std::size_t(remaining), block_size);
+        for (std::size_t ii = 0; ii < nr_values; ++ii)
+          uniforms[ii] = constants::pi * (uniform_dist(rng) - 0.5);
+        exponential_dist.fill(exponentials.begin(), exponentials.begin() + nr_values, rng);
+        for (std::size_t ii = 0; ii < nr_values; ++ii, ++first)
+        {
+          double uu = uniforms[ii];
+          double log_ratio = std::log(std::cos((1. - alpha) * uu - alpha * xi) / exponentials[ii]);
+          *first = Value_type(scale * std::sin(alpha * (uu + xi))
+            * std::exp(exponent_ratio * log_ratio - exponent_cos * std::log(std::cos(uu))) + mu);
+        }
+      }
+    }
+
   private:
     std::uniform_real_distribution<double> uniform_dist{ 0., 1. };
-    std::exponential_distribution<double> exponential_dist{ 1. };
+    exponential_ziggurat_distribution<double> exponential_dist{ 1. };
   };
 
   template <typename Value_type = double>
@@ -147,7 +668,7 @@ namespace stochastic
     }
 
   private:
-    std::exponential_distribution<double> exponential_dist{ 1. };
+    exponential_ziggurat_distribution<double> exponential_dist{ 1. };
   };
 
   // Inverse Gaussian distribution (with drift)
@@ -190,7 +711,7 @@ namespace stochastic
 
   private:
     std::uniform_real_distribution<double> uniform_dist{ 0., 1. };
-    std::normal_distribution<double> normal_dist{ 0., 1. };
+    normal_ziggurat_distribution<double> normal_dist{ 0., 1. };
 
     double ratio{ 0.5*var/(mean*mean) };
   };
@@ -221,7 +742,7 @@ namespace stochastic
 
   private:
     param_type dim;
-    std::normal_distribution<double> normal_dist{};
+    normal_ziggurat_distribution<double> normal_dist{};
   };
 
   // Returns a pdf of given set of values,
@@ -12,7 +12,13 @@
 #ifndef Reaction_h
 #define Reaction_h
 
+#include <algorithm>
 #include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
 #include "Stochastic/Stoichiometry.h"
 #include "general/Operations.h"
 
@@ -153,6 +159,10 @@ namespace stochastic
     double particles(std::size_t type)
     { return mass(type); }
 
+    // True if a mass is zero, so that the reaction is stopped
+    bool absorbing() const
+    { return masses[0] == 0. || masses[1] == 0.; }
+
   private:
     std::vector<double> masses{ 0., 0. };
     double time_current{ 0. };
@@ -207,10 +217,356 @@ namespace stochastic
     double particles(std::size_t type)
     { return mass(type); }
 
+    // True if the mass is zero, so that decay no longer changes it
+    bool absorbing() const
+    { return masses == 0.; }
+
   private:
     double masses{ 0. };
     double time_current{ 0. };
   };
+  //  Continuous mass-action networks of any number of reactions and species,
+  //  integrated with the adaptive second-order Rosenbrock method of
+  //  Shampine and Reichelt (ode23s), with an embedded third-order error estimate
+  //  The method is linearly implicit, so stiff networks take large steps
+  //  The Jacobian is assembled from a sparsity pattern derived from the stoichiometry,
+  //  with one entry per (reaction, reactant, changed species) triplet
+  //  evolve throws std::runtime_error if a step gives a non-finite error estimate,
+  //  or if steps are rejected max_rejections times in a row or shrink below the time resolution,
+  //  as when the solution blows up
+  class Reaction_concentration_MassAction_Rosenbrock
+  {
+  public:
+    using Stoichiometry = stochastic::Stoichiometry;
+    const std::size_t nr_types;
+
+    Reaction_concentration_MassAction_Rosenbrock
+    (std::vector<Stoichiometry> const& stoichiometries, std::size_t nr_types,
+     double tol_rel = 1.e-6, double tol_abs = 1.e-10)
+    : nr_types{ nr_types }
+    , masses(nr_types, 0.)
+    , tol_rel{ tol_rel }
+    , tol_abs{ tol_abs }
+    {
+      for (auto const& stoichiometry : stoichiometries)
+        add(stoichiometry);
+      allocate();
+    }
+
+    Reaction_concentration_MassAction_Rosenbrock
+    (std::vector<Stoichiometry> const& stoichiometries, std::vector<double> const& concentration,
+     double tol_rel = 1.e-6, double tol_abs = 1.e-10)
+    : Reaction_concentration_MassAction_Rosenbrock{
+      stoichiometries, concentration.size(), tol_rel, tol_abs }
+    { set(concentration); }
+
+    void set(std::size_t type, double val)
+    { masses[type] = val; }
+
+    void set(std::vector<double> const& concentration)
+    {
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        set(ii, concentration[ii]);
+    }
+
+    //  Integrate up to time_max
+    //  The last accepted step size is kept as the first trial step of the next call
+    void evolve(double time_max)
+    {
+      if (time_max <= time_current)
+        return;
+      rates(masses, deriv_0);
+      if (step <= 0.)
+        step = initial_step(time_max - time_current);
+      std::size_t nr_rejected = 0;
+      while (time_current < time_max)
+      {
+        bool last = time_current + step >= time_max;
+        double step_try = last ? time_max - time_current : step;
+        double error = attempt(step_try);
+        ++nr_steps;
+        if (!std::isfinite(error))
+          throw failure("Non-finite error estimate");
+        if (error <= 1.)
+        {
+          time_current = last ? time_max : time_current + step_try;
+          for (std::size_t ii = 0; ii < nr_types; ++ii)
+            masses[ii] = mass_new[ii] > 0. ? mass_new[ii] : 0.;
+          std::swap(deriv_0, deriv_2);
+          if (!last)
+            step = step_try * std::min(max_growth, safety * std::cbrt(1. / std::max(error, 1.e-12)));
+          nr_rejected = 0;
+        }
+        else
+        {
+          step = step_try * std::max(min_shrink, safety * std::cbrt(1. / error));
+          double step_min = 16. * std::numeric_limits<double>::epsilon()
+            * std::max(std::abs(time_current), std::abs(time_max));
+          if (++nr_rejected > max_rejections || step < step_min)
+            throw failure("Step size underflow");
+        }
+      }
+    }
+
+    void time(double val)
+    { time_current = val; }
+
+    double time() const
+    { return time_current; }
+
+    double mass(std::size_t type) const
+    { return masses[type]; }
+
+    double particles(std::size_t type) const
+    { return mass(type); }
+
+    std::vector<double> const& concentrations() const
+    { return masses; }
+
+    //  Number of attempted steps since construction
+    std::size_t steps() const
+    { return nr_steps; }
+
+    //  True if every reaction has a zero rate, so that the state no longer changes
+    bool absorbing() const
+    {
+      for (auto const& reaction : reactions)
+      {
+        bool zero = 0;
+        for (auto const& reactant : reaction.reactants)
+          zero = zero || masses[reactant.first] == 0.;
+        if (!zero)
+          return 0;
+      }
+      return 1;
+    }
+
+  private:
+    struct Reaction
+    {
+      double rate;                                                // Reaction rate over product of coefficient factorials
+      std::vector<std::pair<std::size_t, std::size_t>> reactants;
+      std::vector<std::pair<std::size_t, double>> changes;        // Net stoichiometric change of each affected species
+      std::size_t partials;                                       // Offset of reactant partial derivatives
+    };
+
+    //  Jacobian entry row, col += change * partial
+    struct Entry
+    {
+      std::size_t index;      // row * nr_types + col
+      std::size_t partial;
+      double change;
+    };
+
+    std::vector<double> masses;
+    double time_current{ 0. };
+    double step{ 0. };
+    std::size_t nr_steps{ 0 };
+    const double tol_rel;
+    const double tol_abs;
+    std::vector<Reaction> reactions;
+    std::vector<Entry> entries;
+    std::size_t nr_partials{ 0 };
+
+    static constexpr double gamma = 0.29289321881345248;        // 1/(2+sqrt(2))
+    static constexpr double e32 = 7.4142135623730951;           // 6+sqrt(2)
+    static constexpr double safety = 0.8;
+    static constexpr double max_growth = 5.;
+    static constexpr double min_shrink = 0.1;
+    static constexpr std::size_t max_rejections = 100;    // Consecutive rejected steps before failing
+
+    //  Work arrays
+    std::vector<double> reaction_rates;
+    std::vector<double> partial_vals;
+    std::vector<double> matrix;
+    std::vector<std::size_t> pivots;
+    std::vector<double> deriv_0, deriv_1, deriv_2;
+    std::vector<double> kk_1, kk_2, kk_3;
+    std::vector<double> mass_mid, mass_new;
+
+    void add(Stoichiometry const& stoichiometry)
+    {
+      Reaction reaction{ stoichiometry.reaction_rate, stoichiometry.reactants, {}, nr_partials };
+      for (auto const& reactant : stoichiometry.reactants)
+        reaction.rate /= double(operation::factorial(reactant.second));
+      auto change = [&reaction](std::size_t type, double val)
+      {
+        for (auto& entry : reaction.changes)
+          if (entry.first == type)
+          {
+            entry.second += val;
+            return;
+          }
+        reaction.changes.emplace_back(type, val);
+      };
+      for (auto const& reactant : stoichiometry.reactants)
+        change(reactant.first, -double(reactant.second));
+      for (auto const& product : stoichiometry.products)
+        change(product.first, double(product.second));
+
+      for (std::size_t rr = 0; rr < reaction.reactants.size(); ++rr)
+        for (auto const& entry : reaction.changes)
+          if (entry.second != 0.)
+            entries.push_back({ entry.first * nr_types + reaction.reactants[rr].first,
+                                nr_partials + rr, entry.second });
+      nr_partials += reaction.reactants.size();
+      reactions.push_back(std::move(reaction));
+    }
+
+    void allocate()
+    {
+      reaction_rates.resize(reactions.size());
+      partial_vals.resize(nr_partials);
+      matrix.resize(nr_types * nr_types);
+      pivots.resize(nr_types);
+      for (auto vec : { &deriv_0, &deriv_1, &deriv_2, &kk_1, &kk_2, &kk_3, &mass_mid, &mass_new })
+        vec->resize(nr_types);
+    }
+
+    std::runtime_error failure(std::string const& reason) const
+    {
+      return std::runtime_error{ "Reaction_concentration_MassAction_Rosenbrock: " + reason
+        + " at time " + std::to_string(time_current) };
+    }
+
+    static double power(double val, std::size_t exponent)
+    {
+      double result = 1.;
+      for (std::size_t ii = 0; ii < exponent; ++ii)
+        result *= val;
+      return result;
+    }
+
+    //  Time derivative of concentration
+    void rates(std::vector<double> const& concentration, std::vector<double>& deriv)
+    {
+      std::fill(deriv.begin(), deriv.end(), 0.);
+      for (auto const& reaction : reactions)
+      {
+        double rate = reaction.rate;
+        for (auto const& reactant : reaction.reactants)
+          rate *= power(std::max(concentration[reactant.first], 0.), reactant.second);
+        for (auto const& entry : reaction.changes)
+          deriv[entry.first] += entry.second * rate;
+      }
+    }
+
+    //  matrix = I - gamma * step * Jacobian at masses
+    void assemble(double step_try)
+    {
+      for (auto const& reaction : reactions)
+        for (std::size_t rr = 0; rr < reaction.reactants.size(); ++rr)
+        {
+          double partial = reaction.rate;
+          for (std::size_t ss = 0; ss < reaction.reactants.size(); ++ss)
+          {
+            double val = std::max(masses[reaction.reactants[ss].first], 0.);
+            std::size_t exponent = reaction.reactants[ss].second;
+            if (ss != rr)
+              partial *= power(val, exponent);
+            else
+              partial *= exponent ? double(exponent) * power(val, exponent - 1) : 0.;
+          }
+          partial_vals[reaction.partials + rr] = partial;
+        }
+      std::fill(matrix.begin(), matrix.end(), 0.);
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        matrix[ii * nr_types + ii] = 1.;
+      double factor = -gamma * step_try;
+      for (auto const& entry : entries)
+        matrix[entry.index] += factor * entry.change * partial_vals[entry.partial];
+    }
+
+    //  LU decomposition of matrix in place with partial pivoting
+    void decompose()
+    {
+      for (std::size_t col = 0; col < nr_types; ++col)
+      {
+        std::size_t pivot = col;
+        for (std::size_t row = col + 1; row < nr_types; ++row)
+          if (std::abs(matrix[row * nr_types + col]) > std::abs(matrix[pivot * nr_types + col]))
+            pivot = row;
+        pivots[col] = pivot;
+        if (pivot != col)
+          for (std::size_t cc = 0; cc < nr_types; ++cc)
+            std::swap(matrix[col * nr_types + cc], matrix[pivot * nr_types + cc]);
+        double diagonal = matrix[col * nr_types + col];
+        for (std::size_t row = col + 1; row < nr_types; ++row)
+        {
+          double factor = matrix[row * nr_types + col] /= diagonal;
+          if (factor != 0.)
+            for (std::size_t cc = col + 1; cc < nr_types; ++cc)
+              matrix[row * nr_types + cc] -= factor * matrix[col * nr_types + cc];
+        }
+      }
+    }
+
+    //  Solve with the decomposed matrix in place
+    void solve(std::vector<double>& vec) const
+    {
+      for (std::size_t col = 0; col < nr_types; ++col)
+        std::swap(vec[col], vec[pivots[col]]);
+      for (std::size_t row = 1; row < nr_types; ++row)
+        for (std::size_t cc = 0; cc < row; ++cc)
+          vec[row] -= matrix[row * nr_types + cc] * vec[cc];
+      for (std::size_t row = nr_types; row-- > 0;)
+      {
+        for (std::size_t cc = row + 1; cc < nr_types; ++cc)
+          vec[row] -= matrix[row * nr_types + cc] * vec[cc];
+        vec[row] /= matrix[row * nr_types + row];
+      }
+    }
+
+    //  One step from masses with derivative deriv_0,
+    //  leaving the result in mass_new and its derivative in deriv_2
+    //  Returns the scaled error norm, accept if <= 1
+    double attempt(double step_try)
+    {
+      assemble(step_try);
+      decompose();
+
+      kk_1 = deriv_0;
+      solve(kk_1);
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        mass_mid[ii] = masses[ii] + 0.5 * step_try * kk_1[ii];
+      rates(mass_mid, deriv_1);
+
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        kk_2[ii] = deriv_1[ii] - kk_1[ii];
+      solve(kk_2);
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+      {
+        kk_2[ii] += kk_1[ii];
+        mass_new[ii] = masses[ii] + step_try * kk_2[ii];
+      }
+      rates(mass_new, deriv_2);
+
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        kk_3[ii] = deriv_2[ii] - e32 * (kk_2[ii] - deriv_1[ii]) - 2. * (kk_1[ii] - deriv_0[ii]);
+      solve(kk_3);
+
+      double error = 0.;
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+      {
+        double estimate = step_try / 6. * std::abs(kk_1[ii] - 2. * kk_2[ii] + kk_3[ii]);
+        double scale = tol_abs + tol_rel * std::max(std::abs(masses[ii]), std::abs(mass_new[ii]));
+        if (!std::isfinite(estimate / scale))
+          return std::numeric_limits<double>::infinity();
+        error = std::max(error, estimate / scale);
+      }
+      return error;
+    }
+
+    //  First trial step, a tenth of the fastest relative rate of change
+    double initial_step(double interval) const
+    {
+      double ratio = 0.;
+      for (std::size_t ii = 0; ii < nr_types; ++ii)
+        ratio = std::max(ratio, std::abs(deriv_0[ii]) / (tol_abs + std::abs(masses[ii])));
+      double guess = ratio > 0. ? 0.1 / ratio : interval;
+      return std::min(interval, guess);
+    }
+  };
 }
 
 #endif /* Reaction_h */
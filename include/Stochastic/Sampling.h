@@ -0,0 +1,280 @@
+//
+// Sampling.h
+// Stochastic
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Variance-reduced sampling of a distribution through its quantile function
+// Unit-interval points are drawn i.i.d., stratified, Latin-hypercube,
+// or from a scrambled Sobol sequence, and mapped through the quantile
+// Strata have equal probability, so all samples carry equal weight
+
+#ifndef Stochastic_Sampling_h
+#define Stochastic_Sampling_h
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <numeric>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Stochastic/Random.h"
+
+namespace stochastic
+{
+  // iid : independent draws
+  // stratified : one draw in each of nr_samples equal-probability strata, in order
+  // latin_hypercube : as stratified, with strata visited in random order
+  // sobol : Owen-scrambled Sobol points (base-2 van der Corput in one dimension)
+  enum class Sampling
+  { iid, stratified, latin_hypercube, sobol };
+
+  // Sampling from its index in the enumeration, e.g. a command line option
+  inline Sampling make_Sampling(std::size_t index)
+  {
+    if (index > std::size_t(Sampling::sobol))
+      throw std::invalid_argument{ "Sampling: Unknown sampling " + std::to_string(index) };
+    return Sampling(index);
+  }
+
+  // Regularized lower incomplete gamma function P(a, x)
+  double gamma_p(double a, double x)
+  {
+    if (a <= 0. || x < 0.)
+      throw std::invalid_argument{ "gamma_p: Inappropriate parameters" };
+    if (x == 0.)
+      return 0.;
+
+    const double eps = std::numeric_limits<double>::epsilon();
+    const double tiny = std::numeric_limits<double>::min() / eps;
+    double log_prefactor = -x + a * std::log(x) - std::lgamma(a);
+
+    // Series representation
+    if (x < a + 1.)
+    {
+      double term = 1. / a;
+      double sum = term;
+      for (double aa = a + 1.; std::abs(term) > std::abs(sum) * eps; aa += 1.)
+      {
+        term *= x / aa;
+        sum += term;
+      }
+      return sum * std::exp(log_prefactor);
+    }
+
+    // Continued fraction for Q(a, x) (modified Lentz)
+    double bb = x + 1. - a;
+    double cc = 1. / tiny;
+    double dd = 1. / bb;
+    double hh = dd;
+    for (std::size_t ii = 1; ii < 10000; ++ii)
+    {
+      double an = -double(ii) * (double(ii) - a);
+      bb += 2.;
+      dd = an * dd + bb;
+      if (std::abs(dd) < tiny)
+        dd = tiny;
+      cc = bb + an / cc;
+      if (std::abs(cc) < tiny)
+        cc = tiny;
+      dd = 1. / dd;
+      double delta = dd * cc;
+      hh *= delta;
+      if (std::abs(delta - 1.) <= eps)
+        break;
+    }
+    return 1. - std::exp(log_prefactor) * hh;
+  }
+
+  // Inverse of P(a, x) in x
+  // Initial guess and Halley iteration following Numerical Recipes (3rd ed.), 6.2.1
+  double gamma_p_inverse(double a, double p)
+  {
+    if (a <= 0.)
+      throw std::invalid_argument{ "gamma_p_inverse: Inappropriate parameters" };
+    if (p <= 0.)
+      return 0.;
+    if (p >= 1.)
+      return std::numeric_limits<double>::infinity();
+
+    double a1 = a - 1.;
+    double log_gamma = std::lgamma(a);
+    double log_a1 = 0.;
+    double factor = 0.;
+    double xx;
+    if (a > 1.)
+    {
+      log_a1 = std::log(a1);
+      factor = std::exp(a1 * (log_a1 - 1.) - log_gamma);
+      double pp = p < 0.5 ? p : 1. - p;
+      double tt = std::sqrt(-2. * std::log(pp));
+      xx = (2.30753 + tt * 0.27061) / (1. + tt * (0.99229 + tt * 0.04481)) - tt;
+      if (p < 0.5)
+        xx = -xx;
+      xx = std::max(1.e-3,
+                    a * std::pow(1. - 1. / (9. * a) - xx / (3. * std::sqrt(a)), 3.));
+    }
+    else
+    {
+      double tt = 1. - a * (0.253 + a * 0.12);
+      xx = p < tt
+      ? std::pow(p / tt, 1. / a)
+      : 1. - std::log(1. - (p - tt) / (1. - tt));
+    }
+
+    for (std::size_t iter = 0; iter < 32; ++iter)
+    {
+      if (xx <= 0.)
+        return 0.;
+      double error = gamma_p(a, xx) - p;
+      double density = a > 1.
+      ? factor * std::exp(-(xx - a1) + a1 * (std::log(xx) - log_a1))
+      : std::exp(-xx + a1 * std::log(xx) - log_gamma);
+      double ratio = error / density;
+      double step = ratio / (1. - 0.5 * std::min(1., ratio * (a1 / xx - 1.)));
+      xx -= step;
+      if (xx <= 0.)
+        xx = 0.5 * (xx + step);
+      if (std::abs(step) < 1.e-13 * xx)
+        break;
+    }
+
+    return xx;
+  }
+
+  // Quantile functions, uu in [0, 1)
+  double quantile(std::gamma_distribution<double> const& dist, double uu)
+  { return dist.beta() * gamma_p_inverse(dist.alpha(), uu); }
+
+  double quantile(std::exponential_distribution<double> const& dist, double uu)
+  { return -std::log1p(-uu) / dist.lambda(); }
+
+  double quantile(exponential_ziggurat_distribution<double> const& dist, double uu)
+  { return -std::log1p(-uu) / dist.lambda(); }
+
+  // Owen scrambling of base-2 digits through the Laine-Karras hash
+  // (Burley, "Practical hash-based Owen scrambling", 2020)
+  inline std::uint32_t reverse_bits(std::uint32_t xx)
+  {
+    xx = ((xx >> 1) & 0x55555555u) | ((xx & 0x55555555u) << 1);
+    xx = ((xx >> 2) & 0x33333333u) | ((xx & 0x33333333u) << 2);
+    xx = ((xx >> 4) & 0x0f0f0f0fu) | ((xx & 0x0f0f0f0fu) << 4);
+    xx = ((xx >> 8) & 0x00ff00ffu) | ((xx & 0x00ff00ffu) << 8);
+    return (xx >> 16) | (xx << 16);
+  }
+
+  inline std::uint32_t laine_karras_permutation(std::uint32_t xx, std::uint32_t seed)
+  {
+    xx += seed;
+    xx ^= xx * 0x6c50b47cu;
+    xx ^= xx * 0xb82f1e52u;
+    xx ^= xx * 0xc7afe638u;
+    xx ^= xx * 0x8d22f6e6u;
+    return xx;
+  }
+
+  // Owen-scrambled point index of the one-dimensional Sobol sequence
+  // The unscrambled point is reverse_bits(index) / 2^32
+  inline double sobol_scrambled(std::uint32_t index, std::uint32_t seed)
+  { return reverse_bits(laine_karras_permutation(index, seed)) * 0x1.0p-32; }
+
+  // Points in [0, 1) sampled according to sampling
+  // Stratified schemes use nr_samples strata; draws beyond nr_samples
+  // start a new, independent round
+  template <typename Engine_t = std::mt19937>
+  class UnitSampler
+  {
+  public:
+    const std::size_t nr_samples;
+    const Sampling sampling;
+
+    UnitSampler(std::size_t nr_samples, Sampling sampling = Sampling::iid)
+    : nr_samples{ std::max(nr_samples, std::size_t(1)) }
+    , sampling{ sampling }
+    { new_round(); }
+
+    double operator() ()
+    {
+      if (sampling == Sampling::iid)
+        return uniform(rng);
+      if (current == nr_samples)
+        new_round();
+      std::size_t stratum = order[current++];
+      // Jitter below the 2^-32 resolution of the Sobol points
+      if (sampling == Sampling::sobol)
+        return std::min(sobol_scrambled(std::uint32_t(stratum), scramble)
+                        + uniform(rng) * 0x1.0p-32, 1. - 0x1.0p-53);
+      return std::min((stratum + uniform(rng)) / nr_samples, 1. - 0x1.0p-53);
+    }
+
+    // Reseed and start a new round
+    void seed(std::uint64_t value)
+    {
+      rng.seed(typename Engine_t::result_type(value));
+      new_round();
+    }
+
+  private:
+    Engine_t rng{ std::random_device{}() };
+    std::uniform_real_distribution<double> uniform{ 0., 1. };
+    std::vector<std::size_t> order;
+    std::size_t current{ 0 };
+    std::uint32_t scramble{ 0 };    // Owen scrambling seed of the current Sobol round
+
+    void new_round()
+    {
+      current = 0;
+      if (sampling == Sampling::iid)
+        return;
+      order.resize(nr_samples);
+      std::iota(order.begin(), order.end(), 0);
+      if (sampling == Sampling::latin_hypercube)
+        std::shuffle(order.begin(), order.end(), rng);
+      if (sampling == Sampling::sobol)
+        scramble = std::uint32_t(random_bits_64(rng));
+    }
+  };
+
+  // Wrapper for random number generation with own rng,
+  // optionally drawing through the quantile function with variance-reduced sampling
+  // A quantile(Distribution_t const&, double) overload must exist
+  // for sampling other than Sampling::iid
+  template <typename Distribution_t, typename Engine_t = std::mt19937>
+  struct RNG_quantile
+  {
+    using param_type = typename Distribution_t::param_type;
+    using result_type = typename Distribution_t::result_type;
+
+    template <typename param_t>
+    RNG_quantile(param_t const& params, std::size_t nr_samples = 1, Sampling sampling = Sampling::iid)
+    : dist{ param_type(params) }
+    , unit_sampler{ nr_samples, sampling }
+    {}
+
+    result_type operator() ()
+    {
+      return unit_sampler.sampling == Sampling::iid
+      ? dist(rng)
+      : result_type(quantile(dist, unit_sampler()));
+    }
+
+    void seed(std::uint64_t value)
+    {
+      rng.seed(typename Engine_t::result_type(seed_realization(value, 0)));
+      unit_sampler.seed(seed_realization(value, 1));
+    }
+
+    Distribution_t dist;
+
+  private:
+    Engine_t rng{ std::random_device{}() };
+    UnitSampler<Engine_t> unit_sampler;
+  };
+}
+
+#endif /* Stochastic_Sampling_h */
@@ -0,0 +1,179 @@
+//
+//  Cache.h
+//  Streamtube
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Content-addressed cache of completed streamtubes, so that reruns only simulate
+//  the streamtubes not computed before, when nr_velocities is raised
+//  A CacheKey holds every parameter the streamtube samples depend on, at full precision,
+//  except the number of streamtubes, and the code they were computed with; any other
+//  change, including to the measure points, starts a new entry; entries live in a directory named by its 64-bit
+//  FNV-1a hash, and each file holds a contiguous range of streamtubes in the format
+//  of Measurer::save, with the key text and the velocity of each streamtube
+//  Reuse requires a base seed, which makes every streamtube a function of its index;
+//  cached streamtubes are loaded from the first one on while their velocities match
+//  the requested ones, so that the output is identical to a run from scratch
+//  Files are written under a temporary name and renamed, so an interrupted or
+//  concurrent run never leaves a partial file, and hash collisions are detected
+//  through the key text and ignored
+
+#ifndef Cache_Streamtube_h
+#define Cache_Streamtube_h
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+#include <unistd.h>
+#include "general/Columnar.h"
+#include "general/useful.h"
+#include "Models.h"
+#include "Measurer.h"
+
+namespace streamtube
+{
+  //  Code the cached streamtubes were computed with: the drivers' Makefiles define
+  //  STREAMTUBE_CACHE_CODE as a checksum of the sources, compiler and flags,
+  //  so that entries are never reused by different code; without it,
+  //  every compilation counts as different code
+#ifdef STREAMTUBE_CACHE_CODE
+  constexpr char cache_code_version[] = STREAMTUBE_CACHE_CODE;
+#else
+  constexpr char cache_code_version[] = __DATE__ " " __TIME__;
+#endif
+
+  //  Parameters identifying cached results, with floating-point values
+  //  written exactly in hexadecimal
+  class CacheKey
+  {
+  public:
+    CacheKey()
+    { add("code_version", cache_code_version); }
+
+    template <typename Value>
+    CacheKey& add(std::string const& name, Value const& value)
+    {
+      std::ostringstream stream;
+      if constexpr (std::is_floating_point<Value>::value)
+        stream << std::hexfloat;
+      stream << value;
+      key += name + "=" + stream.str() + ";";
+      return *this;
+    }
+
+    std::string const& text() const
+    { return key; }
+
+    std::uint64_t hash() const
+    {
+      std::uint64_t hash = 14695981039346656037ull;
+      for (unsigned char cc : key)
+      {
+        hash ^= cc;
+        hash *= 1099511628211ull;
+      }
+      return hash;
+    }
+
+    std::string hex() const
+    {
+      char buffer[17];
+      std::snprintf(buffer, sizeof buffer, "%016llx", static_cast<unsigned long long>(hash()));
+      return buffer;
+    }
+
+  private:
+    std::string key;
+  };
+
+  class StreamtubeCache
+  {
+  public:
+    //  Entry for key in directory, created if needed
+    StreamtubeCache(std::string const& directory, CacheKey const& key)
+    : key{ key.text() }
+    , entry{ std::filesystem::path{ directory } / key.hex() }
+    { std::filesystem::create_directories(entry); }
+
+    //  Load the cached streamtubes from first on into measurer, up to last
+    //  or the first that is missing or has a velocity other than in advections
+    //  Returns the number loaded
+    template <typename Measurer>
+    std::size_t load(Measurer& measurer, std::vector<double> const& advections,
+                     std::size_t first, std::size_t last)
+    {
+      std::vector<std::filesystem::path> paths;
+      for (auto const& file : std::filesystem::directory_iterator{ entry })
+        if (file.path().extension() == ".col")
+          paths.push_back(file.path());
+      std::sort(paths.begin(), paths.end());
+
+      //  File and velocity of each cached streamtube, keeping the first copy
+      std::vector<std::unique_ptr<columnar::Reader>> files;
+      std::map<std::size_t, std::pair<std::size_t, double>> cached;
+      for (auto const& path : paths)
+      {
+        auto file = std::make_unique<columnar::Reader>(path.string());
+        if (!file->has_attribute("cache_key") || file->attribute<std::string>("cache_key") != key)
+          continue;
+        std::map<std::string, double> velocities;
+        for (auto const& attribute : file->all_attributes())
+          if (attribute.first.compare(0, 10, "advection_") == 0)
+            velocities[attribute.first] = std::get<double>(attribute.second);
+        for (std::size_t streamtube : shard_streamtubes(*file))
+          cached.emplace(streamtube, std::make_pair(files.size(),
+            velocities.at("advection_" + std::to_string(streamtube))));
+        files.push_back(std::move(file));
+      }
+
+      std::size_t streamtube = first;
+      for (; streamtube < last; ++streamtube)
+      {
+        auto it = cached.find(streamtube);
+        if (it == cached.end() || it->second.second != advections[streamtube])
+          break;
+        measurer.load(*files[it->second.first], streamtube);
+      }
+      return streamtube - first;
+    }
+
+    //  Save the streamtubes recorded by measurer, with velocities from advections
+    template <typename Measurer>
+    void save(Measurer const& measurer, std::vector<double> const& advections) const
+    {
+      std::vector<std::size_t> streamtubes = measurer.recorded();
+      if (streamtubes.empty())
+        return;
+      columnar::Table table;
+      table.attribute("cache_key", key);
+      for (std::size_t streamtube : streamtubes)
+        table.attribute("advection_" + std::to_string(streamtube), advections[streamtube]);
+      measurer.save(table);
+      auto range = std::minmax_element(streamtubes.begin(), streamtubes.end());
+      std::string name = "streamtubes_" + std::to_string(*range.first)
+        + "_" + std::to_string(*range.second + 1);
+      std::filesystem::path path = entry / (name + ".col");
+      static std::atomic<std::size_t> nr_written{ 0 };
+      std::filesystem::path path_temporary = entry / (name + ".tmp_"
+        + std::to_string(::getpid()) + "_" + std::to_string(nr_written++));
+      table.write(path_temporary.string());
+      std::filesystem::rename(path_temporary, path);
+    }
+
+  private:
+    const std::string key;
+    const std::filesystem::path entry;
+  };
+}
+
+#endif /* Cache_Streamtube_h */
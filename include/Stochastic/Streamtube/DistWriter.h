@@ -0,0 +1,243 @@
+//
+//  DistWriter.h
+//  Streamtube
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Streaming binary output of per-streamtube distributions
+//  Layout (native byte order, all fields 8 bytes):
+//    char[8]   magic "STDIST02"
+//    uint64    nr_measures, at least one
+//    uint64    nr_streamtubes expected
+//    uint64    nr_rows written (updated at each chunk flush and on close)
+//    uint64    chunk_rows
+//    uint64    header_size, in bytes, offset of the first row
+//    double    measure points [nr_measures]
+//    rows      nr_rows rows of 8 + 16 * nr_measures bytes,
+//              row r at header_size + r * (8 + 16 * nr_measures):
+//              the uint64 streamtube index, then the positions (or times),
+//              then the masses at each measure
+//  Rows are written as streamtubes finish, not in streamtube order,
+//  so each row carries the index of its streamtube
+//  Fixed-stride rows allow the file to be memory-mapped and indexed directly
+
+#ifndef DistWriter_Streamtube_h
+#define DistWriter_Streamtube_h
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <string>
+#include <valarray>
+#include <vector>
+#include "general/MappedFile.h"
+#include "general/useful.h"
+
+namespace streamtube
+{
+  class DistWriter_binary
+  {
+  public:
+    static constexpr char magic[8] = { 'S', 'T', 'D', 'I', 'S', 'T', '0', '2' };
+
+    DistWriter_binary(std::string const& filename, std::valarray<double> const& measure_points,
+                      std::size_t nr_streamtubes, std::size_t chunk_rows = 256)
+    : nr_measures{ measure_points.size() }
+    , chunk_rows{ std::max(chunk_rows, std::size_t(1)) }
+    , output{ filename, std::ios::binary | std::ios::trunc }
+    {
+      if (nr_measures == 0)
+        throw useful::bad_parameters();
+      if (!output.is_open())
+        throw useful::open_write_error(filename);
+      header_size = 6 * sizeof(std::uint64_t) + nr_measures * sizeof(double);
+      output.write(magic, sizeof magic);
+      write_uint64(nr_measures);
+      write_uint64(nr_streamtubes);
+      write_uint64(0);
+      write_uint64(this->chunk_rows);
+      write_uint64(header_size);
+      for (auto const& point : measure_points)
+        output.write(reinterpret_cast<char const*>(&point), sizeof point);
+      buffer.reserve(this->chunk_rows * row_size());
+    }
+
+    DistWriter_binary(DistWriter_binary const&) = delete;
+    DistWriter_binary& operator=(DistWriter_binary const&) = delete;
+
+    ~DistWriter_binary()
+    {
+      try
+      { close(); }
+      catch (...)
+      {}
+    }
+
+    //  Append the row of a finished streamtube,
+    //  from nr_measures positions and nr_measures masses
+    void write(std::uint64_t streamtube, double const* positions, double const* masses)
+    {
+      append(&streamtube, sizeof streamtube);
+      append(positions, nr_measures * sizeof(double));
+      append(masses, nr_measures * sizeof(double));
+      if (++nr_buffered == chunk_rows)
+        flush();
+    }
+
+    //  Bytes per row
+    std::size_t row_size() const
+    { return sizeof(std::uint64_t) + 2 * nr_measures * sizeof(double); }
+
+    //  Write pending rows and the final row count
+    void close()
+    {
+      if (!output.is_open())
+        return;
+      flush();
+      output.close();
+    }
+
+    std::size_t rows() const
+    { return nr_rows + nr_buffered; }
+
+  private:
+    const std::size_t nr_measures;
+    const std::size_t chunk_rows;
+    std::ofstream output;
+    std::size_t header_size;
+    std::size_t nr_rows{ 0 };
+    std::size_t nr_buffered{ 0 };
+    std::vector<char> buffer;
+
+    void write_uint64(std::uint64_t val)
+    { output.write(reinterpret_cast<char const*>(&val), sizeof val); }
+
+    void append(void const* data, std::size_t size)
+    {
+      char const* bytes = static_cast<char const*>(data);
+      buffer.insert(buffer.end(), bytes, bytes + size);
+    }
+
+    //  Write buffered rows and record the row count in the header
+    void flush()
+    {
+      output.write(buffer.data(), std::streamsize(buffer.size()));
+      nr_rows += nr_buffered;
+      nr_buffered = 0;
+      buffer.clear();
+      auto end = output.tellp();
+      output.seekp(sizeof magic + 2 * sizeof(std::uint64_t));
+      write_uint64(nr_rows);
+      output.seekp(end);
+      output.flush();
+    }
+  };
+
+  //  Accumulates per-streamtube averages over runs and streams each streamtube's row
+  //  to a DistWriter_binary once all its runs have been collected at all measures
+  //  Memory use depends only on the number of streamtubes in progress
+  class DistStream
+  {
+  public:
+    DistStream(std::string const& filename, std::valarray<double> const& measure_points,
+               std::size_t nr_runs, std::size_t nr_streamtubes, double particles_characteristic)
+    : nr_measures{ measure_points.size() }
+    , nr_runs{ nr_runs }
+    , particles_characteristic{ particles_characteristic }
+    , writer{ filename, measure_points, nr_streamtubes }
+    {}
+
+    void collect(std::size_t streamtube, std::size_t measure, double position, double mass)
+    {
+      auto it = pending.find(streamtube);
+      if (it == pending.end())
+        it = pending.emplace(streamtube, Row{
+          std::valarray<double>(nr_measures), std::valarray<double>(nr_measures), 0 }).first;
+      Row& row = it->second;
+      row.positions[measure] += position;
+      row.masses[measure] += mass;
+      if (++row.nr_collected == nr_runs * nr_measures)
+      {
+        row.positions /= nr_runs;
+        row.masses /= particles_characteristic * nr_runs;
+        writer.write(streamtube, std::begin(row.positions), std::begin(row.masses));
+        pending.erase(it);
+      }
+    }
+
+    //  Rows of unfinished streamtubes are not written
+    void close()
+    { writer.close(); }
+
+  private:
+    struct Row
+    {
+      std::valarray<double> positions;
+      std::valarray<double> masses;
+      std::size_t nr_collected;
+    };
+
+    const std::size_t nr_measures;
+    const std::size_t nr_runs;
+    const double particles_characteristic;
+    DistWriter_binary writer;
+    std::map<std::size_t, Row> pending;
+  };
+
+  //  Concatenate the rows of binary distribution files, e.g. written by the shards of a run,
+  //  in the order given, into filename, keeping the streamtube index of each row
+  //  All inputs must have the same measure points
+  void concatenate_dist(std::vector<std::string> const& inputs, std::string const& filename)
+  {
+    std::unique_ptr<DistWriter_binary> writer;
+    std::valarray<double> measure_points;
+    for (auto const& input : inputs)
+    {
+      useful::MappedFile file{ input };
+      std::uint64_t header[5];
+      if (file.size() < sizeof DistWriter_binary::magic + sizeof header
+          || std::memcmp(file.data(), DistWriter_binary::magic, sizeof DistWriter_binary::magic) != 0)
+        throw useful::bad_file_contents(input);
+      std::memcpy(header, file.data() + sizeof DistWriter_binary::magic, sizeof header);
+      std::size_t nr_measures = header[0];
+      std::size_t nr_rows = header[2];
+      std::size_t header_size = header[4];
+      std::size_t row_size = sizeof(std::uint64_t) + 2 * nr_measures * sizeof(double);
+      if (nr_measures == 0
+          || header_size < sizeof DistWriter_binary::magic + sizeof header + nr_measures * sizeof(double)
+          || file.size() < header_size + nr_rows * row_size)
+        throw useful::bad_file_contents(input);
+
+      std::valarray<double> points(nr_measures);
+      std::memcpy(std::begin(points), file.data() + sizeof DistWriter_binary::magic + sizeof header,
+                  nr_measures * sizeof(double));
+      if (!writer)
+      {
+        measure_points = points;
+        writer = std::make_unique<DistWriter_binary>(filename, measure_points, header[1]);
+      }
+      else if (points.size() != measure_points.size()
+               || !std::equal(std::begin(points), std::end(points), std::begin(measure_points)))
+        throw useful::bad_file_contents(input);
+
+      std::uint64_t streamtube;
+      std::vector<double> values(2 * nr_measures);
+      for (std::size_t row = 0; row < nr_rows; ++row)
+      {
+        char const* data = file.data() + header_size + row * row_size;
+        std::memcpy(&streamtube, data, sizeof streamtube);
+        std::memcpy(values.data(), data + sizeof streamtube, values.size() * sizeof(double));
+        writer->write(streamtube, values.data(), values.data() + nr_measures);
+      }
+    }
+    if (writer)
+      writer->close();
+  }
+}
+
+#endif /* DistWriter_Streamtube_h */
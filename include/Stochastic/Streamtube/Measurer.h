@@ -7,28 +7,205 @@
 //
 
 //  Measurer classes for streamtube models
+//  A run can be split into shards over streamtubes: each shard records the sample
+//  of every streamtube it completes and saves them, unnormalized, to a columnar table
+//  (save), and measurers loaded with all shards in streamtube order (load)
+//  reproduce the output of the single run
 
 #ifndef Measurer_Streamtube_h
 #define Measurer_Streamtube_h
 
+#include <algorithm>
+#include <initializer_list>
+#include <memory>
+#include <stdexcept>
 #include <string>
+#include <utility>
 #include <valarray>
 #include <vector>
+#include "DistWriter.h"
+#include "general/Columnar.h"
+#include "general/Statistics.h"
 
 namespace streamtube
 {
   template <typename Evolution_tag>
   class Measurer;
 
+  //  Values of streamtube ss at each measure of a measures x streamtubes distribution
+  std::vector<double> column_dist(std::vector<std::valarray<double>> const& dist, std::size_t ss)
+  {
+    std::vector<double> column;
+    column.reserve(dist.size());
+    for (auto const& row : dist)
+      column.push_back(row[ss]);
+    return column;
+  }
+
+  //  Copy of a mapped column
+  std::valarray<double> column_values(columnar::Column const& column)
+  { return std::valarray<double>(column.data, column.size); }
+
+  //  Streamtubes saved in a shard, in the order saved
+  std::vector<std::size_t> shard_streamtubes(columnar::Reader const& shard)
+  {
+    const std::string prefix{ "sample_0_" };
+    std::vector<std::size_t> streamtubes;
+    for (auto const& name : shard.columns())
+      if (name.compare(0, prefix.size(), prefix) == 0)
+        streamtubes.push_back(std::stoul(name.substr(prefix.size())));
+    return streamtubes;
+  }
+
+  //  Per-streamtube averages over runs of several quantities at each measure
+  //  Runs sharing a streamtube velocity are correlated, so each streamtube
+  //  contributes one sample, its run average, to the accumulator of each
+  //  quantity and measure once all its runs have been collected
+  //  Standard errors treat streamtubes as i.i.d., and so overstate the error
+  //  under stratified, Latin hypercube or Sobol velocity sampling
+  //  Run sums of streamtubes in progress are kept in a pool of slots, reused
+  //  once a streamtube completes, so that collecting does not allocate
+  class StreamtubeStatistics
+  {
+  public:
+    StreamtubeStatistics(std::size_t nr_quantities, std::size_t nr_measures, std::size_t nr_runs,
+                         std::size_t nr_streamtubes = 0)
+    : nr_quantities{ nr_quantities }
+    , nr_measures{ nr_measures }
+    , nr_runs{ nr_runs }
+    , accumulators(nr_quantities * nr_measures)
+    , slot_of(nr_streamtubes, no_slot)
+    {}
+
+    void add(std::size_t streamtube, std::size_t measure, std::initializer_list<double> values)
+    {
+      if (streamtube >= slot_of.size())
+        slot_of.resize(streamtube + 1, no_slot);
+      std::size_t& slot = slot_of[streamtube];
+      if (slot == no_slot)
+        slot = acquire_slot();
+      Pending& sums = pool[slot];
+      std::size_t quantity = 0;
+      for (double val : values)
+        sums.values[quantity++ * nr_measures + measure] += val;
+      if (++sums.nr_collected == nr_runs * nr_measures)
+      {
+        sums.values /= double(nr_runs);
+        add_sample(streamtube, sums.values);
+        sums.values = 0.;
+        sums.nr_collected = 0;
+        free_slots.push_back(slot);
+        slot = no_slot;
+      }
+    }
+
+    //  Add the sample of a complete streamtube, its run averages
+    //  indexed by quantity * nr_measures + measure
+    void add_sample(std::size_t streamtube, std::valarray<double> const& sample)
+    {
+      for (std::size_t ii = 0; ii < accumulators.size(); ++ii)
+        accumulators[ii].add(sample[ii]);
+      if (recording)
+        samples.emplace_back(streamtube, sample);
+    }
+
+    //  Keep the samples of complete streamtubes, for save
+    void record()
+    { recording = 1; }
+
+    //  Recorded streamtubes, in the order completed
+    std::vector<std::size_t> streamtubes() const
+    {
+      std::vector<std::size_t> recorded;
+      for (auto const& streamtube_sample : samples)
+        recorded.push_back(streamtube_sample.first);
+      return recorded;
+    }
+
+    //  Add the recorded samples as columns indexed by measure,
+    //  column sample_<quantity>_<streamtube>
+    void save(columnar::Table& table) const
+    {
+      for (auto const& streamtube_sample : samples)
+        for (std::size_t quantity = 0; quantity < nr_quantities; ++quantity)
+          table.column("sample_" + std::to_string(quantity) + "_"
+                       + std::to_string(streamtube_sample.first),
+                       std::valarray<double>(streamtube_sample.second[
+                         std::slice(quantity * nr_measures, nr_measures, 1)]));
+    }
+
+    //  Add the sample of a streamtube saved in shard
+    void load(columnar::Reader const& shard, std::size_t streamtube)
+    {
+      std::valarray<double> sample(nr_quantities * nr_measures);
+      for (std::size_t quantity = 0; quantity < nr_quantities; ++quantity)
+      {
+        auto column = shard.column("sample_" + std::to_string(quantity) + "_"
+                                   + std::to_string(streamtube));
+        if (column.size != nr_measures)
+          throw std::length_error{ "StreamtubeStatistics: Wrong number of measures in shard" };
+        std::copy(column.begin(), column.end(), std::begin(sample) + quantity * nr_measures);
+      }
+      add_sample(streamtube, sample);
+    }
+
+    statistics::Welford const& operator()(std::size_t quantity, std::size_t measure) const
+    { return accumulators[quantity * nr_measures + measure]; }
+
+    //  Accumulators of a quantity at all measures
+    std::vector<statistics::Welford> quantity(std::size_t quantity) const
+    {
+      return std::vector<statistics::Welford>(
+        accumulators.begin() + quantity * nr_measures,
+        accumulators.begin() + (quantity + 1) * nr_measures);
+    }
+
+    //  Number of streamtubes with all runs collected
+    std::size_t nr_complete() const
+    { return accumulators.empty() ? 0 : accumulators[0].size(); }
+
+  private:
+    struct Pending
+    {
+      std::valarray<double> values;
+      std::size_t nr_collected;
+    };
+
+    std::size_t acquire_slot()
+    {
+      if (free_slots.empty())
+      {
+        pool.push_back(Pending{ std::valarray<double>(0., nr_quantities * nr_measures), 0 });
+        return pool.size() - 1;
+      }
+      std::size_t slot = free_slots.back();
+      free_slots.pop_back();
+      return slot;
+    }
+
+    const std::size_t nr_quantities;
+    const std::size_t nr_measures;
+    const std::size_t nr_runs;
+    std::vector<statistics::Welford> accumulators;
+    static constexpr std::size_t no_slot = std::size_t(-1);
+    std::vector<std::size_t> slot_of;       // Pool slot of each streamtube in progress
+    std::vector<Pending> pool;
+    std::vector<std::size_t> free_slots;
+    bool recording{ 0 };
+    std::vector<std::pair<std::size_t, std::valarray<double>>> samples;
+  };
+
   //  Measures average mass of each species and average product of masses as a function of time,
-  //  and if dist = 1., measures particle positions and fixed-velocity mass averages
+  //  with their standard errors over streamtubes, and if dist = 1, measures particle positions and fixed-velocity mass averages
+  //  If dist = 2, the latter are streamed to a binary file set by stream_dist
+  //  as each streamtube finishes (see DistWriter.h), instead of held in memory
   template <>
   class Measurer<Time_tag>
   {
   public:
-    std::string filename_base{ "Data_StreamTube_Mass" };
+    static inline const std::string filename_base{ "Data_StreamTube_Mass" };
 
-    Measurer(std::valarray<double> measure_times, std::size_t nr_runs,  std::size_t nr_streamtubes, double particles_characteristic, bool dist = 0)
+    Measurer(std::valarray<double> measure_times, std::size_t nr_runs,  std::size_t nr_streamtubes, double particles_characteristic, std::size_t dist = 0)
     : measure_times{ measure_times }
     , nr_runs{ nr_runs }
     , nr_streamtubes{ nr_streamtubes }
@@ -36,31 +213,124 @@ namespace streamtube
     , average_of_mass_1(measure_times.size())
     , average_of_mass_2(measure_times.size())
     , average_of_product(measure_times.size())
-    , average_of_mass_dist(measure_times.size(), std::valarray<double>(nr_streamtubes))
-    , positions(measure_times.size(), std::valarray<double>(nr_streamtubes))
+    , error_of_mass_1(measure_times.size())
+    , error_of_mass_2(measure_times.size())
+    , error_of_product(measure_times.size())
+    , average_of_mass_dist(dist == 1 ? measure_times.size() : 0, std::valarray<double>(nr_streamtubes))
+    , positions(dist == 1 ? measure_times.size() : 0, std::valarray<double>(nr_streamtubes))
     , dist(dist)
+    , streamtube_statistics{ 3, measure_times.size(), nr_runs, nr_streamtubes }
+    {}
+
+    //  Measurer for the run a shard belongs to
+    Measurer(columnar::Reader const& shard)
+    : Measurer{ column_values(shard.column("measure")),
+                std::size_t(shard.attribute<std::int64_t>("shard_nr_runs")),
+                std::size_t(shard.attribute<std::int64_t>("shard_nr_streamtubes")),
+                shard.attribute<double>("shard_particles_characteristic"),
+                std::size_t(shard.attribute<std::int64_t>("shard_dist")) }
     {}
 
     template < typename StreamTubeDynamics >
     void collect(StreamTubeDynamics const& streamtube_dynamics, std::size_t measure, std::size_t streamtube)
     {
-      average_of_mass_1[measure] += streamtube_dynamics.mass(0);
-      average_of_mass_2[measure] += streamtube_dynamics.mass_immobile(0);
-      average_of_product[measure] += streamtube_dynamics.mass(0) * streamtube_dynamics.mass_immobile(0);
-      if (dist)
+      double mass_1 = double(streamtube_dynamics.mass(0));
+      double mass_2 = double(streamtube_dynamics.mass_immobile(0));
+      streamtube_statistics.add(streamtube, measure, { mass_1, mass_2, mass_1 * mass_2 });
+      if (dist == 1)
       {
         average_of_mass_dist[measure][streamtube] += streamtube_dynamics.mass(0);
         positions[measure][streamtube] += streamtube_dynamics.position();
       }
+      if (dist == 2)
+        dist_stream->collect(streamtube, measure,
+                             streamtube_dynamics.position(), streamtube_dynamics.mass(0));
+    }
+
+    //  Open the binary file for dist = 2, before collecting
+    void stream_dist(std::string const& filename)
+    {
+      dist_stream = std::make_unique<DistStream>(
+        filename, measure_times, nr_runs, nr_streamtubes, particles_characteristic);
+    }
+
+    //  Collect every streamtube in a batch,
+    //  with lane ii belonging to streamtube streamtubes[ii]
+    template <typename StreamTubeBatch>
+    void collect(StreamTubeBatch const& batch, std::size_t measure, std::vector<std::size_t> const& streamtubes)
+    {
+      for (std::size_t lane = 0; lane < batch.size(); ++lane)
+        collect(batch.lane(lane), measure, streamtubes[lane]);
     }
     
+    //  Accumulators of the mobile mass at each measure, over completed streamtubes
+    std::vector<statistics::Welford> statistics_mass() const
+    { return streamtube_statistics.quantity(0); }
+
+    std::size_t nr_complete() const
+    { return streamtube_statistics.nr_complete(); }
+
+    //  Record the streamtubes completed from now on, for save
+    void record()
+    { streamtube_statistics.record(); }
+
+    //  Recorded streamtubes, in the order completed
+    std::vector<std::size_t> recorded() const
+    { return streamtube_statistics.streamtubes(); }
+
+    //  Save the recorded streamtubes to a shard, before normalize,
+    //  with the distribution sums over runs if dist = 1
+    void save(columnar::Table& table) const
+    {
+      table.attribute("shard_evolution", "time");
+      table.attribute("shard_nr_runs", nr_runs);
+      table.attribute("shard_nr_streamtubes", nr_streamtubes);
+      table.attribute("shard_particles_characteristic", particles_characteristic);
+      table.attribute("shard_dist", dist);
+      table.column("measure", measure_times);
+      streamtube_statistics.save(table);
+      if (dist == 1)
+        for (std::size_t streamtube : streamtube_statistics.streamtubes())
+        {
+          table.column("sum_position_" + std::to_string(streamtube), column_dist(positions, streamtube));
+          table.column("sum_mass_" + std::to_string(streamtube), column_dist(average_of_mass_dist, streamtube));
+        }
+    }
+
+    //  Add a streamtube saved in shard
+    void load(columnar::Reader const& shard, std::size_t streamtube)
+    {
+      streamtube_statistics.load(shard, streamtube);
+      if (dist == 1)
+      {
+        auto sum_position = shard.column("sum_position_" + std::to_string(streamtube));
+        auto sum_mass = shard.column("sum_mass_" + std::to_string(streamtube));
+        for (std::size_t measure = 0; measure < measure_times.size(); ++measure)
+        {
+          positions[measure][streamtube] += sum_position[measure];
+          average_of_mass_dist[measure][streamtube] += sum_mass[measure];
+        }
+      }
+    }
+
+    //  Averages and standard errors over the streamtubes collected so far
     void normalize()
     {
-      average_of_mass_1 /= particles_characteristic*nr_runs*nr_streamtubes;
-      average_of_mass_2 /= particles_characteristic*nr_runs*nr_streamtubes;
-      average_of_product /= particles_characteristic*particles_characteristic*nr_runs*nr_streamtubes;
+      for (std::size_t tt = 0; tt < measure_times.size(); ++tt)
+      {
+        average_of_mass_1[tt] = streamtube_statistics(0, tt).mean()/particles_characteristic;
+        average_of_mass_2[tt] = streamtube_statistics(1, tt).mean()/particles_characteristic;
+        average_of_product[tt] = streamtube_statistics(2, tt).mean()
+          /(particles_characteristic*particles_characteristic);
+        error_of_mass_1[tt] = streamtube_statistics(0, tt).standard_error()/particles_characteristic;
+        error_of_mass_2[tt] = streamtube_statistics(1, tt).standard_error()/particles_characteristic;
+        error_of_product[tt] = streamtube_statistics(2, tt).standard_error()
+          /(particles_characteristic*particles_characteristic);
+      }
+      if (dist_stream)
+        dist_stream->close();
       
-      if (dist)
+      if (dist == 1)
         for (std::size_t tt = 0; tt < measure_times.size(); ++tt)
         {
           average_of_mass_dist[tt] /= particles_characteristic*nr_runs;
@@ -76,8 +346,11 @@ namespace streamtube
         output_mass << measure_times[tt] << "\t"
                     << average_of_mass_1[tt] << "\t"
                     << average_of_mass_2[tt] << "\t"
-                    << average_of_product[tt] << "\n";
-        if (dist)
+                    << average_of_product[tt] << "\t"
+                    << error_of_mass_1[tt] << "\t"
+                    << error_of_mass_2[tt] << "\t"
+                    << error_of_product[tt] << "\n";
+        if (dist == 1)
         {
           output_dist << measure_times[tt] << "\t";
           for (std::size_t ss = 0; ss < nr_streamtubes; ++ss)
@@ -95,7 +368,28 @@ namespace streamtube
         output_mass << measure_times[tt] << "\t"
                     << average_of_mass_1[tt] << "\t"
                     << average_of_mass_2[tt] << "\t"
-                    << average_of_product[tt] << "\n";
+                    << average_of_product[tt] << "\t"
+                    << error_of_mass_1[tt] << "\t"
+                    << error_of_mass_2[tt] << "\t"
+                    << error_of_product[tt] << "\n";
+    }
+
+    //  Add the measured averages as columns, and the distributions if dist = 1
+    void columns(columnar::Table& table) const
+    {
+      table.column("time", measure_times);
+      table.column("mass_1", average_of_mass_1);
+      table.column("mass_2", average_of_mass_2);
+      table.column("product", average_of_product);
+      table.column("mass_1_se", error_of_mass_1);
+      table.column("mass_2_se", error_of_mass_2);
+      table.column("product_se", error_of_product);
+      if (dist == 1)
+        for (std::size_t ss = 0; ss < nr_streamtubes; ++ss)
+        {
+          table.column("position_" + std::to_string(ss), column_dist(positions, ss));
+          table.column("mass_" + std::to_string(ss), column_dist(average_of_mass_dist, ss));
+        }
     }
 
   private:
@@ -106,46 +400,140 @@ namespace streamtube
     std::valarray<double> average_of_mass_1;
     std::valarray<double> average_of_mass_2;
     std::valarray<double> average_of_product;
+    std::valarray<double> error_of_mass_1;
+    std::valarray<double> error_of_mass_2;
+    std::valarray<double> error_of_product;
     std::vector<std::valarray<double>> average_of_mass_dist;
     std::vector<std::valarray<double>> positions;
-    bool dist;
+    std::size_t dist;
+    std::unique_ptr<DistStream> dist_stream;
+    StreamtubeStatistics streamtube_statistics;
   };
 
   //  Measures average mass of first species as a function of space,
-  //  and if dist = 1., measures crossing times and fixed-velocity mass averages
+  //  with its standard error over streamtubes, and if dist = 1, measures crossing times and fixed-velocity mass averages
+  //  If dist = 2, the latter are streamed to a binary file set by stream_dist
+  //  as each streamtube finishes (see DistWriter.h), instead of held in memory
   template <>
   class Measurer<Space_tag>
   {
   public:
-    const std::string filename_base{ "Data_StreamTube_BTC" };
+    static inline const std::string filename_base{ "Data_StreamTube_BTC" };
 
-    Measurer(std::valarray<double> measure_distances, std::size_t nr_runs, std::size_t nr_streamtubes, double particles_characteristic, bool dist)
+    Measurer(std::valarray<double> measure_distances, std::size_t nr_runs, std::size_t nr_streamtubes, double particles_characteristic, std::size_t dist = 0)
     : measure_distances{ measure_distances }
     , nr_runs(nr_runs)
     , nr_streamtubes{ nr_streamtubes }
     , particles_characteristic{ particles_characteristic }
     , average_of_mass(measure_distances.size())
-    , average_of_mass_dist(measure_distances.size(), std::valarray<double>(nr_streamtubes))
-    , crossing_times(measure_distances.size(), std::valarray<double>(nr_streamtubes))
+    , error_of_mass(measure_distances.size())
+    , average_of_mass_dist(dist == 1 ? measure_distances.size() : 0, std::valarray<double>(nr_streamtubes))
+    , crossing_times(dist == 1 ? measure_distances.size() : 0, std::valarray<double>(nr_streamtubes))
     , dist(dist)
+    , streamtube_statistics{ 1, measure_distances.size(), nr_runs, nr_streamtubes }
+    {}
+
+    //  Measurer for the run a shard belongs to
+    Measurer(columnar::Reader const& shard)
+    : Measurer{ column_values(shard.column("measure")),
+                std::size_t(shard.attribute<std::int64_t>("shard_nr_runs")),
+                std::size_t(shard.attribute<std::int64_t>("shard_nr_streamtubes")),
+                shard.attribute<double>("shard_particles_characteristic"),
+                std::size_t(shard.attribute<std::int64_t>("shard_dist")) }
     {}
 
     template <typename StreamTubeDynamics>
     void collect(StreamTubeDynamics const& streamtube_dynamics, std::size_t measure, std::size_t streamtube)
     {
-      average_of_mass[measure] += streamtube_dynamics.mass(0);
-      if (dist==1)
+      streamtube_statistics.add(streamtube, measure, { double(streamtube_dynamics.mass(0)) });
+      if (dist == 1)
       {
         average_of_mass_dist[measure][streamtube] += streamtube_dynamics.mass(0);
         crossing_times[measure][streamtube] += streamtube_dynamics.time();
       }
+      if (dist == 2)
+        dist_stream->collect(streamtube, measure,
+                             streamtube_dynamics.time(), streamtube_dynamics.mass(0));
+    }
+
+    //  Open the binary file for dist = 2, before collecting
+    void stream_dist(std::string const& filename)
+    {
+      dist_stream = std::make_unique<DistStream>(
+        filename, measure_distances, nr_runs, nr_streamtubes, particles_characteristic);
+    }
+
+    //  Collect every streamtube in a batch,
+    //  with lane ii belonging to streamtube streamtubes[ii]
+    template <typename StreamTubeBatch>
+    void collect(StreamTubeBatch const& batch, std::size_t measure, std::vector<std::size_t> const& streamtubes)
+    {
+      for (std::size_t lane = 0; lane < batch.size(); ++lane)
+        collect(batch.lane(lane), measure, streamtubes[lane]);
     }
     
+    //  Accumulators of the mobile mass at each measure, over completed streamtubes
+    std::vector<statistics::Welford> statistics_mass() const
+    { return streamtube_statistics.quantity(0); }
+
+    std::size_t nr_complete() const
+    { return streamtube_statistics.nr_complete(); }
+
+    //  Record the streamtubes completed from now on, for save
+    void record()
+    { streamtube_statistics.record(); }
+
+    //  Recorded streamtubes, in the order completed
+    std::vector<std::size_t> recorded() const
+    { return streamtube_statistics.streamtubes(); }
+
+    //  Save the recorded streamtubes to a shard, before normalize,
+    //  with the distribution sums over runs if dist = 1
+    void save(columnar::Table& table) const
+    {
+      table.attribute("shard_evolution", "space");
+      table.attribute("shard_nr_runs", nr_runs);
+      table.attribute("shard_nr_streamtubes", nr_streamtubes);
+      table.attribute("shard_particles_characteristic", particles_characteristic);
+      table.attribute("shard_dist", dist);
+      table.column("measure", measure_distances);
+      streamtube_statistics.save(table);
+      if (dist == 1)
+        for (std::size_t streamtube : streamtube_statistics.streamtubes())
+        {
+          table.column("sum_time_" + std::to_string(streamtube), column_dist(crossing_times, streamtube));
+          table.column("sum_mass_" + std::to_string(streamtube), column_dist(average_of_mass_dist, streamtube));
+        }
+    }
+
+    //  Add a streamtube saved in shard
+    void load(columnar::Reader const& shard, std::size_t streamtube)
+    {
+      streamtube_statistics.load(shard, streamtube);
+      if (dist == 1)
+      {
+        auto sum_time = shard.column("sum_time_" + std::to_string(streamtube));
+        auto sum_mass = shard.column("sum_mass_" + std::to_string(streamtube));
+        for (std::size_t measure = 0; measure < measure_distances.size(); ++measure)
+        {
+          crossing_times[measure][streamtube] += sum_time[measure];
+          average_of_mass_dist[measure][streamtube] += sum_mass[measure];
+        }
+      }
+    }
+
+    //  Averages and standard errors over the streamtubes collected so far
     void normalize()
     {
-      average_of_mass /= particles_characteristic*nr_runs*nr_streamtubes;
+      for (std::size_t xx = 0; xx < measure_distances.size(); ++xx)
+      {
+        average_of_mass[xx] = streamtube_statistics(0, xx).mean()/particles_characteristic;
+        error_of_mass[xx] = streamtube_statistics(0, xx).standard_error()/particles_characteristic;
+      }
+      if (dist_stream)
+        dist_stream->close();
       
-      if (dist)
+      if (dist == 1)
          for (std::size_t xx = 0; xx < measure_distances.size(); ++xx)
          {
            average_of_mass_dist[xx] /= particles_characteristic*nr_runs;
@@ -159,8 +547,9 @@ namespace streamtube
       for (std::size_t xx = 0; xx < measure_distances.size(); ++xx)
       {
         output_mass << measure_distances[xx] << "\t"
-                    << average_of_mass[xx] << "\n";
-        if (dist)
+                    << average_of_mass[xx] << "\t"
+                    << error_of_mass[xx] << "\n";
+        if (dist == 1)
         {
           output_mass << measure_distances[xx] << "\t";
           for (std::size_t ss = 0; ss < nr_streamtubes; ++ss)
@@ -175,7 +564,22 @@ namespace streamtube
     {
       for (std::size_t xx = 0; xx < measure_distances.size(); ++xx)
         output_mass << measure_distances[xx] << "\t"
-                    << average_of_mass[xx] << "\n";
+                    << average_of_mass[xx] << "\t"
+                    << error_of_mass[xx] << "\n";
+    }
+
+    //  Add the measured averages as columns, and the distributions if dist = 1
+    void columns(columnar::Table& table) const
+    {
+      table.column("distance", measure_distances);
+      table.column("mass", average_of_mass);
+      table.column("mass_se", error_of_mass);
+      if (dist == 1)
+        for (std::size_t ss = 0; ss < nr_streamtubes; ++ss)
+        {
+          table.column("time_" + std::to_string(ss), column_dist(crossing_times, ss));
+          table.column("mass_" + std::to_string(ss), column_dist(average_of_mass_dist, ss));
+        }
     }
 
   private:
@@ -184,9 +588,12 @@ namespace streamtube
     const std::size_t nr_streamtubes;
     const double particles_characteristic;
     std::valarray<double> average_of_mass;
+    std::valarray<double> error_of_mass;
     std::vector<std::valarray<double>> average_of_mass_dist;
     std::vector<std::valarray<double>> crossing_times;
-    bool dist;
+    std::size_t dist;
+    std::unique_ptr<DistStream> dist_stream;
+    StreamtubeStatistics streamtube_statistics;
   };
 }
 
@@ -7,17 +7,25 @@
 //
 
 //  Type and helper function definitions for different streamtube models
-//  namespace naming convention is model_<velocity_dist>_<reactive_length_dist>_<conservative_length_dist>
+//  namespace naming convention is model_<velocity_dist>_<reactive_length_dist>_<conservative_length_dist>,
+//  each holding the model type Model
+//  Models can be selected by name at run time through with_model
 
 #ifndef Models_Streamtube_h
 #define Models_Streamtube_h
 
 #include <cmath>
 #include <cstdio>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <type_traits>
 #include <valarray>
+#include <vector>
 #include "Streamtube.h"
 #include "Patch.h"
 #include "Stochastic/Random.h"
+#include "Stochastic/Sampling.h"
 #include "general/useful.h"
 
 namespace streamtube
@@ -75,6 +83,11 @@ namespace streamtube
 		const double mean_advection;
 	};
 
+  // Random number engine for generators owned by each streamtube,
+  // kept small since many streamtubes are alive at once
+	using Engine = stochastic::xoshiro256pp;
+
+  //  Advection of a streamtube, uniform along it
 	struct Advection_uniform
 	{
 		const double advection;
@@ -83,103 +96,126 @@ namespace streamtube
 		{ return advection; }
 	};
 
-	namespace model_uniform_exp_exp
+  //  Velocity and patch length distributions the models are built from
+	using AdvectionGenerator_constant = useful::StoreConst<double>;
+	using AdvectionGenerator_gamma = stochastic::RNG_quantile<std::gamma_distribution<double>>;
+	using Length_constant = useful::StoreConst<double>;
+	using Length_exponential = stochastic::RNG<stochastic::exponential_ziggurat_distribution<double>, Engine>;
+	using Length_stable = stochastic::RNG<stochastic::skewedlevystable_distribution<double>, Engine>;
+
+  //  Streamtube model from its dynamics in space or time (Evolution_tag),
+  //  whether the mean conservative patch length is finite (Mean_tag),
+  //  and the velocity and patch length distributions
+  //  Velocities are constant or gamma with the given mean and variance,
+  //  and patch lengths are given by their mean, or by their scale and
+  //  stability exponent alpha for stable lengths
+	template <typename Evolution_tag_t, typename Mean_tag_t, typename AdvectionGenerator_t,
+	          typename Length_reactive_t, typename Length_conservative_t>
+	struct Model_base
 	{
-		using Evolution_tag = Time_tag;
-		using Mean_tag = Finite_tag;
+		using Evolution_tag = Evolution_tag_t;
+		using Mean_tag = Mean_tag_t;
 		using Advection = Advection_uniform;
 		using Tortuosity = useful::StoreConst<double>;
-		using Length_reactive = stochastic::RNG<std::exponential_distribution<double>>;
-		using Length_conservative = stochastic::RNG<std::exponential_distribution<double>>;
-		using AdvectionGenerator = useful::StoreConst<double>;
-		AdvectionGenerator make_AdvectionGenerator(double advection, double = 0.)
-		{ return AdvectionGenerator{ advection }; }
-		Length_reactive make_LengthReactive(double length, double = 0.)
-		{ return Length_reactive{ 1./length }; }
-		Length_conservative make_LengthConservative(double length, double = 0.)
-		{ return Length_conservative{ 1./length }; }
-		char filename_model[32] = { "uniform_exp_exp" };
+		using Length_reactive = Length_reactive_t;
+		using Length_conservative = Length_conservative_t;
+		using AdvectionGenerator = AdvectionGenerator_t;
+
+    //  Velocity generator over nr_samples draws with the given mean and variance
+    //  Non-i.i.d. sampling stratifies the velocity quantiles over the nr_samples draws
+		static AdvectionGenerator make_AdvectionGenerator
+		(double mean, double var = 0., std::size_t nr_samples = 1,
+		 stochastic::Sampling sampling = stochastic::Sampling::iid)
+		{
+			if constexpr (std::is_same<AdvectionGenerator, AdvectionGenerator_gamma>::value)
+				return AdvectionGenerator{
+					typename AdvectionGenerator::param_type{ mean * mean / var, var / mean },
+					nr_samples, sampling };
+			else
+				return AdvectionGenerator{ mean };
+		}
+
+		static Length_reactive make_LengthReactive(double length, double alpha = 0.)
+		{ return make_Length<Length_reactive>(length, alpha); }
+
+		static Length_conservative make_LengthConservative(double length, double alpha = 0.)
+		{ return make_Length<Length_conservative>(length, alpha); }
+
+	private:
+		template <typename Length>
+		static Length make_Length(double length, double alpha)
+		{
+			if constexpr (std::is_same<Length, Length_stable>::value)
+				return Length{ typename Length::param_type{ alpha,
+					std::pow(std::cos(constants::pi * alpha / 2.), 1. / alpha) * length } };
+			else
+				return Length{ 1. / length };
+		}
+	};
+
+	namespace model_uniform_exp_exp
+	{
+		struct Model
+		: Model_base<Time_tag, Finite_tag, AdvectionGenerator_constant, Length_exponential, Length_exponential>
+		{ static constexpr char const* filename_model = "uniform_exp_exp"; };
 	}
 
 	namespace model_uniform_exp_power
 	{
-		using Evolution_tag = Time_tag;
-		using Mean_tag = Infinite_tag;
-		using Advection = Advection_uniform;
-		using Tortuosity = useful::StoreConst<double>;
-		using Length_reactive = stochastic::RNG<std::exponential_distribution<double>>;
-		using Length_conservative = stochastic::RNG<stochastic::skewedlevystable_distribution<double>>;
-		using AdvectionGenerator = useful::StoreConst<double>;
-		AdvectionGenerator make_AdvectionGenerator(double advection, double = 0.)
-		{ return AdvectionGenerator{ advection }; }
-		Length_reactive make_LengthReactive(double length, double = 0.)
-		{ return Length_reactive{ 1./length }; }
-		Length_conservative make_LengthConservative(double length, double alpha)
-		{
-      return Length_conservative{
-      Length_conservative::param_type{
-        alpha,
-        std::pow(std::cos(constants::pi * alpha / 2.), 1. / alpha) * length } };
-    }
-		char filename_model[32] = { "uniform_exp_power" };
+		struct Model
+		: Model_base<Time_tag, Infinite_tag, AdvectionGenerator_constant, Length_exponential, Length_stable>
+		{ static constexpr char const* filename_model = "uniform_exp_power"; };
 	}
 
 	namespace model_uniform_uniform_uniform
 	{
-		using Evolution_tag = Time_tag;
-		using Mean_tag = Finite_tag;
-		using Advection = Advection_uniform;
-		using Tortuosity = useful::StoreConst<double>;
-		using Length_reactive = useful::StoreConst<double>;
-		using Length_conservative = useful::StoreConst<double>;
-		using AdvectionGenerator = useful::StoreConst<double>;
-		AdvectionGenerator make_AdvectionGenerator(double advection, double = 0.)
-		{ return AdvectionGenerator{ advection }; }
-		Length_reactive make_LengthReactive(double length, double = 0.)
-		{ return Length_reactive{ 1. / length }; }
-		Length_conservative make_LengthConservative(double length, double = 0.)
-		{ return Length_conservative{ 1. / length }; }
-		char filename_model[32] = { "uniform_uniform_uniform" };
+		struct Model
+		: Model_base<Time_tag, Finite_tag, AdvectionGenerator_constant, Length_constant, Length_constant>
+		{ static constexpr char const* filename_model = "uniform_uniform_uniform"; };
 	}
 
 	namespace model_gamma_exp_exp
 	{
-		using Evolution_tag = Space_tag;
-		using Mean_tag = Finite_tag;
-		using Advection = Advection_uniform;
-		using Tortuosity = useful::StoreConst<double>;
-		using Length_reactive = stochastic::RNG<std::exponential_distribution<double>>;
-		using Length_conservative = stochastic::RNG<std::exponential_distribution<double>>;
-		using AdvectionGenerator = stochastic::RNG<std::gamma_distribution<double>>;
-		AdvectionGenerator make_AdvectionGenerator(double mean, double var)
-		{ return AdvectionGenerator{
-        AdvectionGenerator::param_type{ mean * mean / var, var / mean } }; }
-		Length_reactive make_LengthReactive(double length, double = 0.)
-		{ return Length_reactive{ 1. / length }; }
-		Length_conservative make_LengthConservative(double length, double = 0.)
-		{ return Length_conservative{ 1. / length }; }
-		char filename_model[32] = { "gamma_exp_exp" };
+		struct Model
+		: Model_base<Space_tag, Finite_tag, AdvectionGenerator_gamma, Length_exponential, Length_exponential>
+		{ static constexpr char const* filename_model = "gamma_exp_exp"; };
 	}
 
 	namespace model_gamma_exp_power
 	{
-		using Evolution_tag = Space_tag;
-		using Mean_tag = Infinite_tag;
-		using Advection = Advection_uniform;
-		using Tortuosity = useful::StoreConst<double>;
-		using Length_reactive = stochastic::RNG<std::exponential_distribution<double>>;
-		using Length_conservative = stochastic::RNG< stochastic::skewedlevystable_distribution<double> >;
-		using AdvectionGenerator = stochastic::RNG<std::gamma_distribution<double>>;
-		AdvectionGenerator make_AdvectionGenerator(double mean, double var)
-		{ return AdvectionGenerator{
-        AdvectionGenerator::param_type{ mean * mean / var, var / mean } }; }
-		Length_reactive make_LengthReactive(double length, double = 0.)
-		{ return Length_reactive{ 1. / length }; }
-		Length_conservative make_LengthConservative(double length, double alpha)
-		{ return Length_conservative{
-        Length_conservative::param_type{ alpha,
-          std::pow(std::cos(constants::pi * alpha / 2.), 1. / alpha) * length } }; }
-		char filename_model[32] = { "gamma_exp_power" };
+		struct Model
+		: Model_base<Space_tag, Infinite_tag, AdvectionGenerator_gamma, Length_exponential, Length_stable>
+		{ static constexpr char const* filename_model = "gamma_exp_power"; };
+	}
+
+  //  Model registry
+  //  Each model_* namespace is exposed as the type model_*::Model, all listed in Models,
+  //  and with_model instantiates a caller-provided pipeline for every model,
+  //  so that the model can be chosen by name at run time
+  //  while the dynamics for each model remain fully specialized
+	using Models = std::tuple<
+		model_uniform_exp_exp::Model,
+		model_uniform_exp_power::Model,
+		model_uniform_uniform_uniform::Model,
+		model_gamma_exp_exp::Model,
+		model_gamma_exp_power::Model>;
+
+  //  Names of the registered models
+	std::vector<std::string> model_names()
+	{
+		return std::apply([](auto... models)
+		{ return std::vector<std::string>{ models.filename_model... }; }, Models{});
+	}
+
+  //  Call function(Model{}) for the model struct with filename_model equal to name
+  //  Throws std::invalid_argument if there is no such model
+	template <typename Function>
+	void with_model(std::string const& name, Function&& function)
+	{
+		bool found = std::apply([&](auto... models)
+		{ return ((name == models.filename_model && (function(models), 1)) || ...); }, Models{});
+		if (!found)
+			throw std::invalid_argument{ "Unknown streamtube model " + name };
 	}
 }
 
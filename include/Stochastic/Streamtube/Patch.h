@@ -11,11 +11,60 @@
 #ifndef Patch_h
 #define Patch_h
 
+#include <algorithm>
+#include <utility>
+#include <vector>
+#include "general/useful.h"
+
 namespace streamtube
 {
+  //  Lengths drawn from Length in blocks and handed out one at a time
+  //  Length must implement double operator()(), and blocks are drawn
+  //  through void fill(double* first, double* last) if Length implements it,
+  //  as do all the length distributions of Models.h but constant ones
+  //  Blocks start at block_min lengths and double at each refill up to block_max,
+  //  so that a streamtube crossing few patches draws few more lengths than it uses
+	template <typename Length>
+	class LengthBuffer
+	{
+	public:
+		static constexpr std::size_t block_min = 8;
+		static constexpr std::size_t block_max = 128;
+
+		LengthBuffer(Length length)
+		: length{ length }
+		{}
+
+    //  Next length, refilling the buffer in bulk when used up
+		double operator()()
+		{
+			if (position == buffer.size())
+			{
+				buffer.resize(buffer.empty() ? block_min : std::min(2 * buffer.size(), block_max));
+				if constexpr (useful::has_method<fill_t, Length>::value)
+					length.fill(buffer.data(), buffer.data() + buffer.size());
+				else
+					for (auto& val : buffer)
+						val = length();
+				position = 0;
+			}
+			return buffer[position++];
+		}
+
+	private:
+		Length length;
+		std::vector<double> buffer;
+		std::size_t position{ 0 };
+
+		template <typename Length_t>
+		using fill_t = decltype(std::declval<Length_t&>().fill(
+      std::declval<double*>(), std::declval<double*>()));
+	};
+
   //  New patch alternatingly reactive and non-reactive
   //  Reactive_length must implement double operator()() generating a reactive patch length
   //  Conservative_length must implement double operator()() generating a conservative patch length
+  //  Lengths are drawn in blocks through LengthBuffer
   //  Particle_generator must implement std::vector<Mass> operator()()
   //  generating masses of each type in a reactive patche
   //  Mass is the mass type, typically std::size_t or double
@@ -55,12 +104,18 @@ namespace streamtube
 		Mass mass(std::size_t type) const
 		{ return current_particles[type]; }
 
+    //  Masses of a freshly generated reactive patch, without drawing,
+    //  for particle generators callable as const, which always generate the same masses
+		template <typename Generator = Particle_generator>
+		auto particles_initial() const -> decltype(std::declval<Generator const&>()())
+		{ return particle_generator(); }
+
 		std::size_t nr_types() const
 		{ return current_particles.size(); }
 
 	private:
-		Reactive_length reactive_length;
-		Conservative_length conservative_length;
+		LengthBuffer<Reactive_length> reactive_length;
+		LengthBuffer<Conservative_length> conservative_length;
 		Particle_generator particle_generator;
 		std::vector<Mass> current_particles;
 		double current_length;
@@ -0,0 +1,157 @@
+//
+//  Renewal.h
+//  Streamtube
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Deterministic mean mobile mass of streamtube models by renewal theory
+//  In the first-order limit of A + B -> 0, with the immobile species in excess
+//  and restored in each fresh reactive patch, the mobile mass in a streamtube
+//  with advection v decays at rate reaction_rate * mass_immobile_initial in reactive patches
+//  The surviving fraction at distance x is then E[exp(-q L(x))],
+//  with q = reaction_rate * mass_immobile_initial / v and L(x) the reactive length up to x
+//  Patches alternate starting with a reactive one, so its Laplace transform in x is
+//  S(s) = [(1 - f_r(s + q)) / (s + q) + f_r(s + q) (1 - f_c(s)) / s] / (1 - f_r(s + q) f_c(s)),
+//  with f_r and f_c the Laplace transforms of the reactive and conservative lengths,
+//  and it is inverted numerically at each measure point
+//  Velocity averages use Gauss-Legendre quadrature over the advection quantiles
+//  Away from the first-order limit the result is a lower bound on the bimolecular mean,
+//  since immobile depletion within a patch only slows the reaction
+
+#ifndef Renewal_h
+#define Renewal_h
+
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+#include <valarray>
+#include "general/Constants.h"
+#include "general/Quadrature.h"
+#include "general/useful.h"
+#include "Stochastic/Random.h"
+#include "Stochastic/Sampling.h"
+#include "Models.h"
+
+namespace streamtube
+{
+  //  Laplace transforms E[exp(-s L)] of patch length distributions
+
+	std::complex<double> laplace_transform
+	(stochastic::exponential_ziggurat_distribution<double> const& dist, std::complex<double> ss)
+	{ return 1. / (1. + ss / dist.lambda()); }
+
+  //  One-sided stable, 0 < alpha < 1
+	std::complex<double> laplace_transform
+	(stochastic::skewedlevystable_distribution<double> const& dist, std::complex<double> ss)
+	{
+		return std::exp(-std::pow(dist.sigma * ss, dist.alpha)
+			/ std::cos(constants::pi * dist.alpha / 2.) - dist.mu * ss);
+	}
+
+	template <typename Distribution_t, typename Engine_t>
+	std::complex<double> laplace_transform
+	(stochastic::RNG<Distribution_t, Engine_t> const& length, std::complex<double> ss)
+	{ return laplace_transform(length.dist, ss); }
+
+  //  Advection values and weights for velocity averages
+	quadrature::Rule advection_rule(useful::StoreConst<double> const& generator, std::size_t = 1)
+	{ return quadrature::Rule{ { generator() }, { 1. } }; }
+
+	template <typename Distribution_t, typename Engine_t>
+	quadrature::Rule advection_rule
+	(stochastic::RNG_quantile<Distribution_t, Engine_t> const& generator, std::size_t nr_nodes)
+	{
+		quadrature::Rule rule = quadrature::gauss_legendre(nr_nodes, 0., 1.);
+		for (auto& node : rule.nodes)
+			node = stochastic::quantile(generator.dist, node);
+		return rule;
+	}
+
+  //  Whether a model's patch lengths and advection have the transforms and quadrature needed
+	template <typename Model, typename = void>
+	struct has_renewal : std::false_type {};
+	template <typename Model>
+	struct has_renewal<Model, std::void_t<
+		decltype(laplace_transform(std::declval<typename Model::Length_reactive const&>(),
+															 std::complex<double>{})),
+		decltype(laplace_transform(std::declval<typename Model::Length_conservative const&>(),
+															 std::complex<double>{})),
+		decltype(advection_rule(std::declval<typename Model::AdvectionGenerator const&>(),
+														std::size_t{}))>>
+	: std::true_type {};
+
+	template <typename Length_reactive, typename Length_conservative>
+	class MeanMass_renewal
+	{
+	public:
+		const double reaction_rate;
+		const double mass_immobile_initial;
+
+    //  nr_nodes sets the accuracy of the Laplace inversion, see quadrature::invert_laplace
+		MeanMass_renewal
+		(Length_reactive length_reactive, Length_conservative length_conservative,
+		 double reaction_rate, double mass_immobile_initial, std::size_t nr_nodes = 20)
+		: reaction_rate{ reaction_rate }
+		, mass_immobile_initial{ mass_immobile_initial }
+		, length_reactive{ length_reactive }
+		, length_conservative{ length_conservative }
+		, nr_nodes{ nr_nodes }
+		{}
+
+    //  Fraction of the mobile mass surviving to distance in a streamtube with advection
+		double survival(double distance, double advection) const
+		{
+			if (distance <= 0.)
+				return 1.;
+			double decay = reaction_rate * mass_immobile_initial / advection;
+			return quadrature::invert_laplace(
+				[this, decay](std::complex<double> ss) { return transform(ss, decay); },
+				distance, nr_nodes);
+		}
+
+    //  Laplace transform in distance of the surviving fraction, with decay rate per unit length
+		std::complex<double> transform(std::complex<double> ss, double decay) const
+		{
+			std::complex<double> ss_decay = ss + decay;
+			std::complex<double> reactive = laplace_transform(length_reactive, ss_decay);
+			std::complex<double> conservative = laplace_transform(length_conservative, ss);
+			return ((1. - reactive) / ss_decay + reactive * (1. - conservative) / ss)
+				/ (1. - reactive * conservative);
+		}
+
+    //  Mean mobile mass at each measure point, in time or distance according to Evolution_tag,
+    //  over the advections and weights in advections, where a streamtube with advection v
+    //  starts with mobile mass mass_mobile(v)
+		template <typename Evolution_tag, typename Mass_mobile>
+		std::valarray<double> mean
+		(std::valarray<double> const& measure_points, quadrature::Rule const& advections,
+		 Mass_mobile&& mass_mobile) const
+		{
+			std::valarray<double> mass(0., measure_points.size());
+			for (std::size_t vv = 0; vv < advections.nodes.size(); ++vv)
+			{
+				double advection = advections.nodes[vv];
+				double mass_initial = advections.weights[vv] * mass_mobile(advection);
+				for (std::size_t mm = 0; mm < measure_points.size(); ++mm)
+				{
+					double distance = std::is_same<Evolution_tag, Time_tag>::value
+						? advection * measure_points[mm]
+						: measure_points[mm];
+					mass[mm] += mass_initial * survival(distance, advection);
+				}
+			}
+			return mass;
+		}
+
+	private:
+		Length_reactive length_reactive;
+		Length_conservative length_conservative;
+		const std::size_t nr_nodes;
+	};
+}
+
+#endif /* Renewal_h */
@@ -12,11 +12,16 @@
 //  void set(std::size_t type, double val);
 //  void time(double val);
 //  double particles(std::size_t type);
+//  and optionally
+//  bool absorbing() const;
+//  returning true if reactions can no longer change the state at all
 
 #ifndef Streamtube_h
 #define Streamtube_h
 
+#include <utility>
 #include <vector>
+#include "general/useful.h"
 
 namespace streamtube
 {
@@ -24,6 +29,10 @@ namespace streamtube
   //  Advection implements double()() returning advection in current streamtube
   //  Reactor handles reactions in reactive patches (e.g., Gillespie algorithm or a rate law)
   //  Mass is the mass type, typically std::size_t or double
+  //  If Reactor implements absorbing() and Patch implements particles_initial() const,
+  //  the reactor is no longer called once neither the current nor fresh reactive patches
+  //  can react; patches are still walked, so that positions, times and random numbers
+  //  drawn are those of the full dynamics
 	template <typename Patch, typename Advection, typename Reactor, typename Mass>
 	class StreamTubeDynamics
 	{
@@ -84,6 +93,14 @@ namespace streamtube
 		Mass mass_immobile(std::size_t type) const
 		{ return patch.mass(type); }
 
+		std::vector<Mass> particles_immobile() const
+		{
+			std::vector<Mass> particles(nr_types_immobile);
+			for (std::size_t type = 0; type < nr_types_immobile; ++type)
+				particles[type] = patch.mass(type);
+			return particles;
+		}
+
 		double time() const
 		{ return current_time; }
 
@@ -101,6 +118,12 @@ namespace streamtube
 		std::size_t nr_types_mobile{ mass_mobile.size() };
 		std::size_t nr_types_immobile{ patch.nr_types() };
 		std::size_t nr_types{ nr_types_mobile + nr_types_immobile };
+		bool absorbed{ 0 };       // No reaction possible in current or fresh patches
+
+		template <typename T>
+		using absorbing_t = decltype(std::declval<T const&>().absorbing());
+		template <typename T>
+		using particles_initial_t = decltype(std::declval<T const&>().particles_initial());
 
     //  Set the numbers of particles and time in a reactive patch
 		void set_reactor()
@@ -125,11 +148,12 @@ namespace streamtube
 		void react(double position_increment)
 		{
 			double time_increment = position_increment/advection();
-			if (patch.reactive())
+			if (patch.reactive() && !absorbed)
 			{
 				set_reactor();
 				reactor.evolve(current_time + time_increment);
 				set_state();
+				check_absorbing();
 			}
 			current_position += position_increment;
 			current_time += time_increment;
@@ -141,6 +165,64 @@ namespace streamtube
 			patch.generate();
 			advection.generate();
 		}
+
+    //  Check if the reactor state after reacting in a patch is absorbing,
+    //  both with the current immobile masses and with those of a fresh patch,
+    //  read without drawing from the patch generator
+		void check_absorbing()
+		{
+			if constexpr (useful::has_method<absorbing_t, Reactor>::value
+			              && useful::has_method<particles_initial_t, Patch>::value)
+			{
+				if (!reactor.absorbing())
+					return;
+				auto const& particles = std::as_const(patch).particles_initial();
+				for (std::size_t type = 0; type < nr_types_immobile; ++type)
+					reactor.set(nr_types_mobile + type, particles[type]);
+				absorbed = reactor.absorbing();
+			}
+		}
+	};
+
+  //  Copy of the measurable state of a StreamTubeDynamics
+  //  Has the same accessors, so it can be passed to measurers in its place
+	template <typename Mass>
+	class StreamTubeSnapshot
+	{
+	public:
+		StreamTubeSnapshot() = default;
+
+		template <typename StreamTubeDynamics>
+		StreamTubeSnapshot(StreamTubeDynamics const& streamtube_dynamics)
+		: mass_mobile{ streamtube_dynamics.particles() }
+		, mass_fixed{ streamtube_dynamics.particles_immobile() }
+		, current_position{ streamtube_dynamics.position() }
+		, current_time{ streamtube_dynamics.time() }
+		{}
+
+		auto const& particles() const
+		{ return mass_mobile; }
+
+		auto const& particles_immobile() const
+		{ return mass_fixed; }
+
+		Mass mass(std::size_t type) const
+		{ return mass_mobile[type]; }
+
+		Mass mass_immobile(std::size_t type) const
+		{ return mass_fixed[type]; }
+
+		double time() const
+		{ return current_time; }
+
+		double position() const
+		{ return current_position; }
+
+	private:
+		std::vector<Mass> mass_mobile;
+		std::vector<Mass> mass_fixed;
+		double current_position{ 0. };
+		double current_time{ 0. };
 	};
 }
 
@@ -0,0 +1,348 @@
+//
+//  Streamtube_batch.h
+//  Streamtube
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Batched transport and continuous bimolecular reaction in streamtube models
+//  Equivalent to StreamTubeDynamics with PatchGenerator_alternating,
+//  Advection_uniform and Reaction_concentration_bimolecular_analytical,
+//  but many streamtubes are advanced together in structure-of-arrays form:
+//  each pass reacts every active streamtube up to the end of its current patch
+//  or its target with a vectorized kernel, then moves those that crossed a patch
+//  boundary to the next patch
+
+#ifndef Streamtube_batch_h
+#define Streamtube_batch_h
+
+#include <array>
+#include <cstdint>
+#include <utility>
+#include <vector>
+#include "general/useful.h"
+#include "general/Simd.h"
+#include "Patch.h"
+
+namespace streamtube
+{
+  //  Streamtubes with one mobile and one immobile species reacting as A + B -> 0
+  //  Reactive_length must implement double operator()() generating a reactive patch length
+  //  Conservative_length must implement double operator()() generating a conservative patch length
+  //  Patch lengths are shared by all streamtubes in the batch and drawn through LengthBuffer,
+  //  unless one generator per streamtube is given, e.g. each seeded by realization index
+  //  for common random numbers, so that each streamtube draws the same lengths
+  //  regardless of which other streamtubes share its batch
+  //  Each streamtube starts at position and time zero in a fresh reactive patch
+	template <typename Reactive_length, typename Conservative_length>
+	class StreamTubeBatch_concentration_bimolecular
+	{
+	public:
+    //  Accessors for a single streamtube, with the same interface as StreamTubeDynamics
+		class Lane
+		{
+		public:
+			Lane(StreamTubeBatch_concentration_bimolecular const& batch, std::size_t lane)
+			: batch{ batch }
+			, lane{ lane }
+			{}
+
+			double mass(std::size_t = 0) const
+			{ return batch.mass_mobile[lane]; }
+
+			double mass_immobile(std::size_t = 0) const
+			{ return batch.mass_fixed[lane]; }
+
+			double time() const
+			{ return batch.current_time[lane]; }
+
+			double position() const
+			{ return batch.current_position[lane]; }
+
+		private:
+			StreamTubeBatch_concentration_bimolecular const& batch;
+			std::size_t lane;
+		};
+
+    //  State of a single streamtube at one time, with the same interface as Lane
+		class State
+		{
+		public:
+			State(Lane const& lane)
+			: state{ lane.mass(), lane.mass_immobile(), lane.time(), lane.position() }
+			{}
+
+			double mass(std::size_t = 0) const
+			{ return state[0]; }
+
+			double mass_immobile(std::size_t = 0) const
+			{ return state[1]; }
+
+			double time() const
+			{ return state[2]; }
+
+			double position() const
+			{ return state[3]; }
+
+		private:
+			std::array<double, 4> state;
+		};
+
+    //  State of every streamtube at one time, with the same size and lane accessors
+    //  as the batch, so that it can be collected after the batch has moved on
+		class Snapshot
+		{
+		public:
+			Snapshot(StreamTubeBatch_concentration_bimolecular const& batch)
+			{
+				states.reserve(batch.size());
+				for (std::size_t lane = 0; lane < batch.size(); ++lane)
+					states.emplace_back(batch.lane(lane));
+			}
+
+			std::size_t size() const
+			{ return states.size(); }
+
+			State const& lane(std::size_t lane) const
+			{ return states[lane]; }
+
+		private:
+			std::vector<State> states;
+		};
+
+		const double reaction_rate;
+		const double mass_immobile_initial;
+
+    //  advections and masses_mobile hold the advection and initial mobile mass
+    //  of each streamtube in the batch
+		StreamTubeBatch_concentration_bimolecular
+		(Reactive_length reactive_length, Conservative_length conservative_length,
+		 double reaction_rate, double mass_immobile_initial,
+		 std::vector<double> const& advections, std::vector<double> const& masses_mobile,
+		 double tol = 1.e-10)
+		: StreamTubeBatch_concentration_bimolecular{
+			reactive_length, conservative_length, {}, {},
+			reaction_rate, mass_immobile_initial, advections, masses_mobile, tol }
+		{}
+
+    //  As above, with the patch lengths of each streamtube drawn by its own generators
+		StreamTubeBatch_concentration_bimolecular
+		(std::vector<Reactive_length> reactive_lengths,
+		 std::vector<Conservative_length> conservative_lengths,
+		 double reaction_rate, double mass_immobile_initial,
+		 std::vector<double> const& advections, std::vector<double> const& masses_mobile,
+		 double tol = 1.e-10)
+		: StreamTubeBatch_concentration_bimolecular{
+			reactive_lengths.at(0), conservative_lengths.at(0),
+			std::move(reactive_lengths), std::move(conservative_lengths),
+			reaction_rate, mass_immobile_initial, advections, masses_mobile, tol }
+		{}
+
+		void evolve_position(double final_position)
+		{
+			for (auto& val : target)
+				val = final_position;
+			evolve();
+		}
+
+		void evolve_time(double final_time)
+		{
+			for (std::size_t lane = 0; lane < size(); ++lane)
+				target[lane] = advection[lane] * final_time;
+			evolve();
+		}
+
+		std::size_t size() const
+		{ return advection.size(); }
+
+		Lane lane(std::size_t lane) const
+		{ return Lane{ *this, lane }; }
+
+		Snapshot snapshot() const
+		{ return Snapshot{ *this }; }
+
+		double mass(std::size_t lane) const
+		{ return mass_mobile[lane]; }
+
+		double mass_immobile(std::size_t lane) const
+		{ return mass_fixed[lane]; }
+
+		double time(std::size_t lane) const
+		{ return current_time[lane]; }
+
+		double position(std::size_t lane) const
+		{ return current_position[lane]; }
+
+	private:
+		StreamTubeBatch_concentration_bimolecular
+		(Reactive_length reactive_length, Conservative_length conservative_length,
+		 std::vector<Reactive_length> reactive_lane,
+		 std::vector<Conservative_length> conservative_lane,
+		 double reaction_rate, double mass_immobile_initial,
+		 std::vector<double> const& advections, std::vector<double> const& masses_mobile,
+		 double tol)
+		: reaction_rate{ reaction_rate }
+		, mass_immobile_initial{ mass_immobile_initial }
+		, reactive_length{ reactive_length }
+		, conservative_length{ conservative_length }
+		, reactive_lane(std::move(reactive_lane))
+		, conservative_lane(std::move(conservative_lane))
+		, advection{ advections }
+		, mass_mobile{ masses_mobile }
+		, mass_fixed(advections.size(), mass_immobile_initial)
+		, current_position(advections.size())
+		, current_time(advections.size())
+		, patch_end(advections.size())
+		, patch_reactive(advections.size(), 1)
+		, frozen(advections.size(), 0)
+		, target(advections.size())
+		, tol{ tol }
+		{
+			if (!this->reactive_lane.empty()
+				&& (this->reactive_lane.size() != size() || this->conservative_lane.size() != size()))
+				throw useful::bad_parameters();
+			for (std::size_t lane = 0; lane < size(); ++lane)
+				patch_end[lane] = draw_reactive(lane);
+			active.reserve(size());
+			time_step.resize(size());
+			rate_time.resize(size());
+			mass_a.resize(size());
+			mass_b.resize(size());
+			decay.resize(size());
+		}
+
+		LengthBuffer<Reactive_length> reactive_length;
+		LengthBuffer<Conservative_length> conservative_length;
+		std::vector<Reactive_length> reactive_lane;             // Per-streamtube generators, if any
+		std::vector<Conservative_length> conservative_lane;
+		std::vector<double> advection;
+		std::vector<double> mass_mobile;
+		std::vector<double> mass_fixed;
+		std::vector<double> current_position;
+		std::vector<double> current_time;
+		std::vector<double> patch_end;              // Position where the current patch ends
+		std::vector<std::uint8_t> patch_reactive;
+		std::vector<std::uint8_t> frozen;           // No reaction possible in current or fresh patches
+		std::vector<double> target;
+		const double tol;
+
+    //  Work arrays, indexed by position in active
+		std::vector<std::size_t> active;
+		std::vector<double> time_step;
+		std::vector<double> rate_time;
+		std::vector<double> mass_a;
+		std::vector<double> mass_b;
+		std::vector<double> decay;
+
+    //  Move all streamtubes to their targets
+		void evolve()
+		{
+			active.clear();
+			for (std::size_t lane = 0; lane < size(); ++lane)
+			{
+				if (frozen[lane])
+					fast_forward(lane);
+				else
+					active.push_back(lane);
+			}
+
+			while (!active.empty())
+			{
+				std::size_t nr_active = active.size();
+				for (std::size_t kk = 0; kk < nr_active; ++kk)
+				{
+					std::size_t lane = active[kk];
+					double end = patch_end[lane] < target[lane] ? patch_end[lane] : target[lane];
+					time_step[kk] = (end - current_position[lane]) / advection[lane];
+					rate_time[kk] = patch_reactive[lane] ? reaction_rate * time_step[kk] : 0.;
+					mass_a[kk] = mass_mobile[lane];
+					mass_b[kk] = mass_fixed[lane];
+				}
+
+				react(nr_active);
+
+				std::size_t nr_remaining = 0;
+				for (std::size_t kk = 0; kk < nr_active; ++kk)
+				{
+					std::size_t lane = active[kk];
+					mass_mobile[lane] = mass_a[kk];
+					mass_fixed[lane] = mass_b[kk];
+					current_time[lane] += time_step[kk];
+					if (patch_end[lane] < target[lane])
+					{
+						current_position[lane] = patch_end[lane];
+						generate(lane);
+						if (frozen[lane])
+							fast_forward(lane);
+						else
+							active[nr_remaining++] = lane;
+					}
+					else
+						current_position[lane] = target[lane];
+				}
+				active.resize(nr_remaining);
+			}
+		}
+
+    //  Closed-form bimolecular reaction over rate_time = reaction_rate * time step,
+    //  as in Reaction_concentration_bimolecular_analytical::evolve
+    //  Conservative patches have rate_time = 0 and leave masses unchanged
+		void react(std::size_t nr_active)
+		{
+			for (std::size_t kk = 0; kk < nr_active; ++kk)
+			{
+				double mass_max = mass_a[kk] > mass_b[kk] ? mass_a[kk] : mass_b[kk];
+				double mass_min = mass_a[kk] > mass_b[kk] ? mass_b[kk] : mass_a[kk];
+				decay[kk] = -rate_time[kk] * (mass_max - mass_min);
+			}
+
+			simd::exp(decay.data(), decay.data(), nr_active);
+
+			for (std::size_t kk = 0; kk < nr_active; ++kk)
+			{
+				bool a_max = mass_a[kk] > mass_b[kk];
+				double mass_max = a_max ? mass_a[kk] : mass_b[kk];
+				double mass_min = a_max ? mass_b[kk] : mass_a[kk];
+				double diff = mass_max - mass_min;
+				bool distinct = diff > tol;
+				double sol_base = diff / (distinct ? mass_max - decay[kk] * mass_min : 1.);
+				double solution_equal = mass_max / (1. + rate_time[kk] * mass_max);
+				double new_max = distinct ? mass_max * sol_base : solution_equal;
+				double new_min = distinct ? mass_min * sol_base * decay[kk] : solution_equal;
+				mass_a[kk] = a_max ? new_max : new_min;
+				mass_b[kk] = a_max ? new_min : new_max;
+			}
+		}
+
+    //  Enter the next patch of a streamtube
+		void generate(std::size_t lane)
+		{
+			patch_reactive[lane] = !patch_reactive[lane];
+			if (patch_reactive[lane])
+			{
+				patch_end[lane] += draw_reactive(lane);
+				mass_fixed[lane] = mass_immobile_initial;
+				frozen[lane] = mass_mobile[lane] == 0. || mass_immobile_initial == 0.;
+			}
+			else
+				patch_end[lane] += draw_conservative(lane);
+		}
+
+		double draw_reactive(std::size_t lane)
+		{ return reactive_lane.empty() ? reactive_length() : reactive_lane[lane](); }
+
+		double draw_conservative(std::size_t lane)
+		{ return conservative_lane.empty() ? conservative_length() : conservative_lane[lane](); }
+
+    //  Once no reaction is possible, masses are frozen and the immobile mass
+    //  is that of a fresh patch, so move directly to the target
+		void fast_forward(std::size_t lane)
+		{
+			current_time[lane] += (target[lane] - current_position[lane]) / advection[lane];
+			current_position[lane] = target[lane];
+		}
+	};
+}
+
+#endif /* Streamtube_batch_h */
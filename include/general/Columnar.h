@@ -0,0 +1,287 @@
+//
+// Columnar.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Self-describing columnar binary tables
+// Layout (little-endian):
+//   char[8]   magic "COLUMNS1"
+//   uint64    header_size, offset of the first column, multiple of 8
+//   uint64    nr_rows
+//   uint64    nr_columns
+//   uint64    nr_attributes
+//   attributes, each: string name, uint64 type, value
+//     type 0: double, 1: int64, 2: string
+//   columns, each: string name
+//   zero padding up to header_size
+//   column data, column cc as nr_rows doubles at header_size + 8 * cc * nr_rows
+// Strings are stored as uint64 length followed by the characters
+// Columns are 8-byte aligned in the file, so a mapped file is read in place
+
+#ifndef Columnar_h
+#define Columnar_h
+
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+#include <variant>
+#include <vector>
+#include "general/MappedFile.h"
+#include "general/useful.h"
+
+namespace columnar
+{
+  using Value = std::variant<double, std::int64_t, std::string>;
+
+  constexpr char magic[8] = { 'C', 'O', 'L', 'U', 'M', 'N', 'S', '1' };
+
+  inline bool little_endian()
+  {
+    const std::uint16_t val = 1;
+    unsigned char byte;
+    std::memcpy(&byte, &val, 1);
+    return byte == 1;
+  }
+
+  // Table to write, with named attributes and equal-length double columns
+  class Table
+  {
+  public:
+    void attribute(std::string const& name, double val)
+    { attributes.emplace_back(name, Value{ val }); }
+
+    void attribute(std::string const& name, std::int64_t val)
+    { attributes.emplace_back(name, Value{ val }); }
+
+    void attribute(std::string const& name, std::size_t val)
+    { attributes.emplace_back(name, Value{ std::int64_t(val) }); }
+
+    void attribute(std::string const& name, std::string const& val)
+    { attributes.emplace_back(name, Value{ val }); }
+
+    void attribute(std::string const& name, char const* val)
+    { attribute(name, std::string{ val }); }
+
+    void attribute(std::string const& name, Value const& val)
+    { attributes.emplace_back(name, val); }
+
+    // Copy a container of values convertible to double as a column
+    template <typename Container>
+    void column(std::string const& name, Container const& values)
+    {
+      std::vector<double> data;
+      data.reserve(std::size(values));
+      for (auto const& val : values)
+        data.push_back(double(val));
+      if (!columns.empty() && data.size() != columns[0].second.size())
+        throw std::invalid_argument{ "columnar::Table: Column sizes differ" };
+      columns.emplace_back(name, std::move(data));
+    }
+
+    std::size_t nr_rows() const
+    { return columns.empty() ? 0 : columns[0].second.size(); }
+
+    void write(std::string const& filename) const
+    {
+      if (!little_endian())
+        throw std::runtime_error{ "columnar::Table: Big-endian hosts not supported" };
+      std::ofstream output{ filename, std::ios::binary | std::ios::trunc };
+      if (!output.is_open())
+        throw useful::open_write_error(filename);
+
+      std::string header;
+      for (auto const& attribute : attributes)
+      {
+        put_string(header, attribute.first);
+        put_uint64(header, attribute.second.index());
+        std::visit([&header](auto const& val)
+        {
+          using T = std::decay_t<decltype(val)>;
+          if constexpr (std::is_same_v<T, std::string>)
+            put_string(header, val);
+          else
+            header.append(reinterpret_cast<char const*>(&val), sizeof val);
+        }, attribute.second);
+      }
+      for (auto const& column : columns)
+        put_string(header, column.first);
+
+      std::size_t header_size = sizeof magic + 4 * sizeof(std::uint64_t) + header.size();
+      header_size = (header_size + 7) / 8 * 8;
+      header.resize(header_size - sizeof magic - 4 * sizeof(std::uint64_t), '\0');
+
+      std::string start{ magic, sizeof magic };
+      put_uint64(start, header_size);
+      put_uint64(start, nr_rows());
+      put_uint64(start, columns.size());
+      put_uint64(start, attributes.size());
+      output.write(start.data(), std::streamsize(start.size()));
+      output.write(header.data(), std::streamsize(header.size()));
+      for (auto const& column : columns)
+        output.write(reinterpret_cast<char const*>(column.second.data()),
+                     std::streamsize(column.second.size() * sizeof(double)));
+      if (!output)
+        throw useful::open_write_error(filename);
+    }
+
+  private:
+    std::vector<std::pair<std::string, Value>> attributes;
+    std::vector<std::pair<std::string, std::vector<double>>> columns;
+
+    static void put_uint64(std::string& buffer, std::uint64_t val)
+    { buffer.append(reinterpret_cast<char const*>(&val), sizeof val); }
+
+    static void put_string(std::string& buffer, std::string const& val)
+    {
+      put_uint64(buffer, val.size());
+      buffer.append(val);
+    }
+  };
+
+  // Column of a mapped table, valid while the Reader exists
+  struct Column
+  {
+    double const* data;
+    std::size_t size;
+
+    double const* begin() const
+    { return data; }
+
+    double const* end() const
+    { return data + size; }
+
+    double operator[](std::size_t row) const
+    { return data[row]; }
+  };
+
+  // Zero-copy reader: the file is memory-mapped and columns point into it
+  class Reader
+  {
+  public:
+    Reader(std::string const& filename)
+    : file{ filename }
+    , filename{ filename }
+    {
+      if (!little_endian())
+        throw std::runtime_error{ "columnar::Reader: Big-endian hosts not supported" };
+      if (file.size() < sizeof magic + 4 * sizeof(std::uint64_t)
+          || std::memcmp(file.data(), magic, sizeof magic) != 0)
+        throw useful::bad_file_contents(filename);
+      position = sizeof magic;
+      std::size_t header_size = get_uint64();
+      rows = get_uint64();
+      std::size_t nr_columns = get_uint64();
+      std::size_t nr_attributes = get_uint64();
+      for (std::size_t aa = 0; aa < nr_attributes; ++aa)
+      {
+        std::string name = get_string();
+        std::size_t type = get_uint64();
+        if (type == 0)
+          attributes.emplace_back(name, Value{ get<double>() });
+        else if (type == 1)
+          attributes.emplace_back(name, Value{ get<std::int64_t>() });
+        else if (type == 2)
+          attributes.emplace_back(name, Value{ get_string() });
+        else
+          throw useful::bad_file_contents(filename);
+      }
+      for (std::size_t cc = 0; cc < nr_columns; ++cc)
+      {
+        column_names.push_back(get_string());
+        column_indices.emplace(column_names.back(), cc);
+      }
+      if (header_size % 8 || header_size < position
+          || file.size() < header_size + nr_columns * rows * sizeof(double))
+        throw useful::bad_file_contents(filename);
+      columns_start = file.data() + header_size;
+    }
+
+    std::size_t nr_rows() const
+    { return rows; }
+
+    std::vector<std::string> const& columns() const
+    { return column_names; }
+
+    Column column(std::size_t index) const
+    {
+      return Column{
+        reinterpret_cast<double const*>(columns_start) + index * rows, rows };
+    }
+
+    // Column by name, in constant time, so that reading every column is linear
+    // in the number of columns; the first of any repeated names
+    Column column(std::string const& name) const
+    {
+      auto it = column_indices.find(name);
+      if (it == column_indices.end())
+        throw std::out_of_range{ "columnar::Reader: No column " + name };
+      return column(it->second);
+    }
+
+    bool has_attribute(std::string const& name) const
+    {
+      for (auto const& attribute : attributes)
+        if (attribute.first == name)
+          return 1;
+      return 0;
+    }
+
+    // Attribute value, with T one of double, std::int64_t, std::string
+    template <typename T>
+    T attribute(std::string const& name) const
+    {
+      for (auto const& attribute : attributes)
+        if (attribute.first == name)
+          return std::get<T>(attribute.second);
+      throw std::out_of_range{ "columnar::Reader: No attribute " + name };
+    }
+
+    std::vector<std::pair<std::string, Value>> const& all_attributes() const
+    { return attributes; }
+
+  private:
+    useful::MappedFile file;
+    std::string filename;
+    std::size_t position{ 0 };
+    std::size_t rows{ 0 };
+    std::vector<std::pair<std::string, Value>> attributes;
+    std::vector<std::string> column_names;
+    std::unordered_map<std::string, std::size_t> column_indices;
+    char const* columns_start{ nullptr };
+
+    template <typename T>
+    T get()
+    {
+      if (position + sizeof(T) > file.size())
+        throw useful::bad_file_contents(filename);
+      T val;
+      std::memcpy(&val, file.data() + position, sizeof val);
+      position += sizeof val;
+      return val;
+    }
+
+    std::uint64_t get_uint64()
+    { return get<std::uint64_t>(); }
+
+    std::string get_string()
+    {
+      std::size_t length = get_uint64();
+      if (position + length > file.size())
+        throw useful::bad_file_contents(filename);
+      std::string val{ file.data() + position, length };
+      position += length;
+      return val;
+    }
+  };
+}
+
+#endif /* Columnar_h */
@@ -0,0 +1,123 @@
+//
+// IndexedHeap.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Binary min-heap over items 0, ..., nr_items - 1, each with a key,
+// tracking the heap position of each item so that the key of any item
+// can be changed in O(log nr_items)
+
+#ifndef IndexedHeap_h
+#define IndexedHeap_h
+
+#include <cstdint>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace useful
+{
+  class IndexedHeap
+  {
+  public:
+    using Index = std::uint32_t;
+
+    IndexedHeap(std::size_t nr_items = 0, double key = std::numeric_limits<double>::infinity())
+    { assign(std::vector<double>(nr_items, key)); }
+
+    // Rebuild from the keys of all items, in O(nr_items)
+    void assign(std::vector<double> const& keys)
+    {
+      nodes.resize(keys.size());
+      position.resize(keys.size());
+      for (std::size_t item = 0; item < keys.size(); ++item)
+      {
+        nodes[item] = Node{ keys[item], Index(item) };
+        position[item] = Index(item);
+      }
+      for (std::size_t node = nodes.size() / 2; node-- > 0;)
+        sift_down(node);
+    }
+
+    std::size_t size() const
+    { return nodes.size(); }
+
+    bool empty() const
+    { return nodes.empty(); }
+
+    // Item with the smallest key
+    std::size_t top() const
+    { return nodes[0].item; }
+
+    double top_key() const
+    { return nodes[0].key; }
+
+    double key(std::size_t item) const
+    { return nodes[position[item]].key; }
+
+    void update(std::size_t item, double key)
+    {
+      std::size_t node = position[item];
+      double old_key = nodes[node].key;
+      nodes[node].key = key;
+      if (key < old_key)
+        sift_up(node);
+      else
+        sift_down(node);
+    }
+
+  private:
+    struct Node
+    {
+      double key;
+      Index item;
+    };
+
+    std::vector<Node> nodes;        // Heap order
+    std::vector<Index> position;    // Node of each item
+
+    void place(std::size_t node, Node const& val)
+    {
+      nodes[node] = val;
+      position[val.item] = Index(node);
+    }
+
+    void sift_up(std::size_t node)
+    {
+      Node val = nodes[node];
+      while (node > 0)
+      {
+        std::size_t parent = (node - 1) / 2;
+        if (!(val.key < nodes[parent].key))
+          break;
+        place(node, nodes[parent]);
+        node = parent;
+      }
+      place(node, val);
+    }
+
+    void sift_down(std::size_t node)
+    {
+      Node val = nodes[node];
+      std::size_t size = nodes.size();
+      while (1)
+      {
+        std::size_t child = 2 * node + 1;
+        if (child >= size)
+          break;
+        if (child + 1 < size && nodes[child + 1].key < nodes[child].key)
+          ++child;
+        if (!(nodes[child].key < val.key))
+          break;
+        place(node, nodes[child]);
+        node = child;
+      }
+      place(node, val);
+    }
+  };
+}
+
+#endif /* IndexedHeap_h */
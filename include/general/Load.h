@@ -0,0 +1,246 @@
+//
+// Load.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Loaders of numeric text files
+// Files are memory mapped and split at line boundaries into chunks parsed
+// on separate threads with std::from_chars, writing straight into the output columns
+// Lines are split at each occurrence of delim, ignoring empty entries,
+// and every line after the header must hold exactly the expected number of columns
+// Entries may carry surrounding whitespace and a leading '+', as std::stod allows,
+// and carriage returns of files with DOS line endings are ignored
+// nr_threads = 0 uses all hardware threads; small files are parsed on one thread
+
+#ifndef Load_h
+#define Load_h
+
+#include <algorithm>
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+#include <vector>
+#include "general/MappedFile.h"
+#include "general/Parallel.h"
+#include "general/useful.h"
+
+namespace useful
+{
+  namespace load_text
+  {
+    // Minimum chunk size handed to a thread
+    constexpr std::size_t chunk_min = std::size_t(1) << 20;
+
+    bool is_space(char cc)
+    { return cc == ' ' || cc == '\t' || cc == '\r' || cc == '\n' || cc == '\v' || cc == '\f'; }
+
+    // Parse all of [first, last) as a double, up to surrounding whitespace
+    bool parse(char const* first, char const* last, double& value)
+    {
+      while (first < last && is_space(*first))
+        ++first;
+      while (last > first && is_space(*(last - 1)))
+        --last;
+      if (first < last && *first == '+')
+        ++first;
+      auto result = std::from_chars(first, last, value);
+      return first < last && result.ec == std::errc{} && result.ptr == last;
+    }
+
+    // Position after the first nr_lines lines of [first, last)
+    char const* skip_lines(char const* first, char const* last, std::size_t nr_lines)
+    {
+      for (; nr_lines && first < last; --nr_lines)
+      {
+        auto newline = static_cast<char const*>(std::memchr(first, '\n', std::size_t(last - first)));
+        first = newline ? newline + 1 : last;
+      }
+      return first;
+    }
+
+    // Boundaries of at most nr_chunks chunks of [first, last),
+    // each starting just after a character for which is_boundary holds
+    template <typename Boundary>
+    std::vector<char const*> chunks(char const* first, char const* last, std::size_t nr_chunks,
+                                    Boundary is_boundary)
+    {
+      std::size_t size = std::size_t(last - first);
+      nr_chunks = std::max(std::size_t(1), std::min(nr_chunks, size / chunk_min));
+      std::vector<char const*> boundaries{ first };
+      for (std::size_t cc = 1; cc < nr_chunks; ++cc)
+      {
+        char const* position = std::max(first + cc * (size / nr_chunks), boundaries.back());
+        while (position < last && !is_boundary(*(position - 1)))
+          ++position;
+        boundaries.push_back(position);
+      }
+      boundaries.push_back(last);
+      return boundaries;
+    }
+
+    std::size_t count_lines(char const* first, char const* last)
+    {
+      return std::size_t(std::count(first, last, '\n'))
+        + (first < last && *(last - 1) != '\n');
+    }
+
+    // Columns of the file after header_lines, each of nr_columns entries
+    std::vector<std::vector<double>> columns
+    (std::string const& filename, std::size_t nr_columns, std::size_t header_lines,
+     std::string const& delim, std::size_t nr_threads)
+    {
+      if (delim.empty())
+        throw bad_parameters();
+      MappedFile file{ filename };
+      char const* first = skip_lines(file.data(), file.data() + file.size(), header_lines);
+      char const* last = file.data() + file.size();
+      auto boundaries = chunks(first, last, parallel::nr_threads(nr_threads),
+                               [](char cc) { return cc == '\n'; });
+      std::size_t nr_chunks = boundaries.size() - 1;
+
+      // Each chunk writes its lines from the offset of its first line
+      std::vector<std::size_t> offsets(nr_chunks + 1, 0);
+      parallel::for_each_index(0, nr_chunks, nr_chunks,
+        [&](std::size_t chunk)
+        { offsets[chunk + 1] = count_lines(boundaries[chunk], boundaries[chunk + 1]); });
+      for (std::size_t chunk = 0; chunk < nr_chunks; ++chunk)
+        offsets[chunk + 1] += offsets[chunk];
+      std::vector<std::vector<double>> values(nr_columns, std::vector<double>(offsets.back()));
+
+      // First bad line of each chunk, if any, so that the first in the file is reported
+      std::vector<std::pair<char const*, char const*>> errors(nr_chunks, { nullptr, nullptr });
+      parallel::for_each_index(0, nr_chunks, nr_chunks,
+        [&](std::size_t chunk)
+        {
+          std::size_t row = offsets[chunk];
+          char const* line = boundaries[chunk];
+          char const* end = boundaries[chunk + 1];
+          while (line < end)
+          {
+            auto newline = static_cast<char const*>(std::memchr(line, '\n', std::size_t(end - line)));
+            char const* line_end = newline ? newline : end;
+            std::string_view text{ line, std::size_t(line_end - line) };
+            if (!text.empty() && text.back() == '\r')
+              text.remove_suffix(1);
+            std::size_t column = 0;
+            bool good = 1;
+            for (std::size_t start = 0, stop; good && start < text.size(); start = stop + delim.size())
+            {
+              stop = std::min(text.find(delim, start), text.size());
+              if (stop == start)
+                continue;
+              good = column < nr_columns
+                && parse(line + start, line + stop, values[column][row]);
+              ++column;
+            }
+            if (!good || column != nr_columns)
+            {
+              errors[chunk] = { line, line_end };
+              return;
+            }
+            ++row;
+            line = line_end + 1;
+          }
+        });
+      for (auto const& error : errors)
+        if (error.first)
+          throw parse_error(filename, std::string{ error.first, error.second });
+
+      return values;
+    }
+  }
+
+  // The unnamed std::size_t parameter of load_1, load_2 and load held an estimate
+  // of the number of lines, no longer needed as lines are counted beforehand;
+  // it is kept so that the positional arguments after it keep their meaning
+
+  // Load 1-column file into vector of doubles
+  auto load_1
+  (std::string const& filename, std::size_t /* nr_estimate */ = 0,
+   std::size_t header_lines = 0,
+   std::string const& delim = " ", std::size_t nr_threads = 0)
+  {
+    return std::move(load_text::columns(filename, 1, header_lines, delim, nr_threads)[0]);
+  }
+
+  // Load 2-column file into pair of vectors of doubles
+  auto load_2
+  (std::string const& filename, std::size_t /* nr_estimate */ = 0,
+   std::size_t header_lines = 0, std::string const& delim = " ",
+   std::size_t nr_threads = 0)
+  {
+    auto values = load_text::columns(filename, 2, header_lines, delim, nr_threads);
+    return std::make_pair(std::move(values[0]), std::move(values[1]));
+  }
+
+  // Load file into vector of columns of doubles
+  auto load(std::string const& filename, std::size_t nr_columns,
+            std::size_t /* nr_estimate */ = 0,
+            std::size_t header_lines = 0,
+            std::string const& delim = " ", std::size_t nr_threads = 0)
+  {
+    return load_text::columns(filename, nr_columns, header_lines, delim, nr_threads);
+  }
+
+  // Read whitespace-separated doubles, up to the first entry that is not one
+  auto read(std::string const& filename, std::size_t nr_threads = 0)
+  {
+    MappedFile file{ filename };
+    char const* first = file.data();
+    char const* last = file.data() + file.size();
+    auto boundaries = load_text::chunks(first, last, parallel::nr_threads(nr_threads),
+                                        load_text::is_space);
+    std::size_t nr_chunks = boundaries.size() - 1;
+
+    // Chunks parse independently and are joined up to the first bad entry
+    std::vector<std::vector<double>> values(nr_chunks);
+    std::vector<char> stopped(nr_chunks, 0);
+    parallel::for_each_index(0, nr_chunks, nr_chunks,
+      [&](std::size_t chunk)
+      {
+        char const* position = boundaries[chunk];
+        char const* end = boundaries[chunk + 1];
+        while (1)
+        {
+          while (position < end && load_text::is_space(*position))
+            ++position;
+          if (position == end)
+            return;
+          char const* entry_end = position;
+          while (entry_end < end && !load_text::is_space(*entry_end))
+            ++entry_end;
+          double value;
+          if (!load_text::parse(position, entry_end, value))
+          {
+            stopped[chunk] = 1;
+            return;
+          }
+          values[chunk].push_back(value);
+          position = entry_end;
+        }
+      });
+
+    std::size_t nr_used = 0;
+    std::size_t size = 0;
+    while (nr_used < nr_chunks)
+    {
+      size += values[nr_used].size();
+      if (stopped[nr_used++])
+        break;
+    }
+    std::vector<double> vals = std::move(values[0]);
+    vals.reserve(size);
+    for (std::size_t chunk = 1; chunk < nr_used; ++chunk)
+      vals.insert(vals.end(), values[chunk].begin(), values[chunk].end());
+
+    return vals;
+  }
+}
+
+#endif /* Load_h */
@@ -0,0 +1,101 @@
+//
+// MappedFile.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Read-only memory-mapped file (POSIX)
+
+#ifndef MappedFile_h
+#define MappedFile_h
+
+#include <cstddef>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace useful
+{
+  // The whole file is mapped on construction and unmapped on destruction
+  // Empty files have data() == nullptr
+  class MappedFile
+  {
+  public:
+    MappedFile(std::string const& filename)
+    {
+      int descriptor = ::open(filename.c_str(), O_RDONLY);
+      if (descriptor < 0)
+        throw open_error(filename);
+      struct stat status;
+      if (::fstat(descriptor, &status) < 0)
+      {
+        ::close(descriptor);
+        throw open_error(filename);
+      }
+      file_size = std::size_t(status.st_size);
+      if (file_size)
+      {
+        void* address = ::mmap(nullptr, file_size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (address == MAP_FAILED)
+        {
+          ::close(descriptor);
+          throw open_error(filename);
+        }
+        mapped = static_cast<char const*>(address);
+        ::madvise(address, file_size, MADV_SEQUENTIAL);
+      }
+      ::close(descriptor);
+    }
+
+    MappedFile(MappedFile const&) = delete;
+    MappedFile& operator=(MappedFile const&) = delete;
+
+    MappedFile(MappedFile&& other) noexcept
+    : mapped{ std::exchange(other.mapped, nullptr) }
+    , file_size{ std::exchange(other.file_size, 0) }
+    {}
+
+    MappedFile& operator=(MappedFile&& other) noexcept
+    {
+      if (this != &other)
+      {
+        unmap();
+        mapped = std::exchange(other.mapped, nullptr);
+        file_size = std::exchange(other.file_size, 0);
+      }
+      return *this;
+    }
+
+    ~MappedFile()
+    { unmap(); }
+
+    char const* data() const
+    { return mapped; }
+
+    std::size_t size() const
+    { return file_size; }
+
+  private:
+    char const* mapped{ nullptr };
+    std::size_t file_size{ 0 };
+
+    // Same as useful::open_read_error, as useful.h includes this file through Load.h
+    static std::runtime_error open_error(std::string const& filename)
+    { return std::runtime_error{ "Could not open file " + filename + " for reading" }; }
+
+    void unmap()
+    {
+      if (mapped)
+        ::munmap(const_cast<char*>(mapped), file_size);
+      mapped = nullptr;
+    }
+  };
+}
+
+#endif /* MappedFile_h */
@@ -13,26 +13,84 @@
 //    Some operations involve casting.
 //    The latter are spelled out explicitly for clarity and to avoid warnings
 //    In most cases, the return value type is the type of the first container
+//    std::vector, std::array and std::valarray of doubles (and of std::size_t for sum)
+//    use the dispatched kernels of Simd.h; element-wise results are unchanged,
+//    while sums and dot products of at least details::simd_min elements
+//    are accumulated in several lanes and differ in rounding from a sequential sum
 
 #ifndef Operations_h
 #define Operations_h
 
+#include <array>
 #include <cmath>
 #include <functional>
+#include <type_traits>
+#include <valarray>
+#include <vector>
+#include "general/Simd.h"
 #include "general/useful.h"
 
 namespace operation
 {
+  namespace details
+  {
+    // Contiguous containers of Value handled by the simd kernels
+    template <typename Container, typename Value = double>
+    struct is_simd : std::false_type {};
+    template <typename Value, typename Allocator>
+    struct is_simd<std::vector<Value, Allocator>, Value> : std::true_type {};
+    template <typename Value, std::size_t size>
+    struct is_simd<std::array<Value, size>, Value> : std::true_type {};
+    template <typename Value>
+    struct is_simd<std::valarray<Value>, Value> : std::true_type {};
+    template <typename... Containers>
+    constexpr bool is_simd_v = (is_simd<Containers>::value && ...);
+
+    template <typename Scalar>
+    constexpr bool is_simd_scalar_v = std::is_arithmetic<Scalar>::value;
+
+    // Smallest size for which reductions use the simd kernels,
+    // so that short containers such as reaction rates are summed sequentially as before
+    constexpr std::size_t simd_min = 32;
+
+    template <typename Container>
+    auto data(Container& container)
+    { return container.data(); }
+
+    template <typename Value>
+    Value* data(std::valarray<Value>& container)
+    { return container.size() ? &container[0] : nullptr; }
+
+    template <typename Value>
+    Value const* data(std::valarray<Value> const& container)
+    { return container.size() ? &container[0] : nullptr; }
+  }
+
   // Sum of elements
   template <typename Container>
   auto sum(Container const& input)
   {
+    if constexpr (details::is_simd_v<Container> || details::is_simd<Container, std::size_t>::value)
+      if (input.size() >= details::simd_min)
+        return simd::sum(details::data(input), input.size());
     typename Container::value_type output{};
     for (auto const& val : input)
       output += val;
     return output;
   }
 
+  // Sum of elements, pairwise over blocks for containers of doubles handled by the simd kernels,
+  // with rounding error growing as the logarithm rather than linearly in the number of elements
+  // The result depends only on the values, not on the instruction set; otherwise as sum
+  template <typename Container>
+  auto sum_pairwise(Container const& input)
+  {
+    if constexpr (details::is_simd_v<Container>)
+      return simd::sum_pairwise(details::data(input), input.size());
+    else
+      return sum(input);
+  }
+
   // Product of elements
   template <typename Container>
   auto prod(Container const& input)
@@ -47,7 +105,9 @@ namespace operation
   template <typename Container, typename Scalar, typename Container_out>
   void plus_scalar(Container const& input, Scalar cc, Container_out& output)
   {
-    if constexpr (useful::has_plus_v<Container, Scalar>)
+    if constexpr (details::is_simd_v<Container, Container_out> && details::is_simd_scalar_v<Scalar>)
+      simd::plus_scalar(details::data(input), double(cc), details::data(output), output.size());
+    else if constexpr (useful::has_plus_v<Container, Scalar>)
       output = input + cc;
     else
     {
@@ -78,7 +138,9 @@ namespace operation
   template <typename Container_1, typename Container_2, typename Container_out>
   void plus(Container_1 const& input_1, Container_2 const& input_2, Container_out& output)
   {
-    if constexpr (useful::has_plus_v<Container_1, Container_2>)
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out>)
+      simd::plus(details::data(input_1), details::data(input_2), details::data(output), output.size());
+    else if constexpr (useful::has_plus_v<Container_1, Container_2>)
       output = input_1 + input_2;
     else
     {
@@ -109,7 +171,9 @@ namespace operation
   template <typename Container, typename Scalar, typename Container_out>
   void minus_scalar(Container const& input, Scalar cc, Container_out& output)
   {
-    if constexpr (useful::has_minus_v<Container, Scalar>)
+    if constexpr (details::is_simd_v<Container, Container_out> && details::is_simd_scalar_v<Scalar>)
+      simd::minus_scalar(details::data(input), double(cc), details::data(output), output.size());
+    else if constexpr (useful::has_minus_v<Container, Scalar>)
       output = input - cc;
     else
     {
@@ -140,7 +204,9 @@ namespace operation
   template <typename Container, typename Scalar, typename Container_out>
   void scalar_minus(Scalar cc, Container const& input, Container_out& output)
   {
-    if constexpr (useful::has_minus_v<Container, Scalar>)
+    if constexpr (details::is_simd_v<Container, Container_out> && details::is_simd_scalar_v<Scalar>)
+      simd::scalar_minus(double(cc), details::data(input), details::data(output), output.size());
+    else if constexpr (useful::has_minus_v<Container, Scalar>)
       output = cc - input;
     else
     {
@@ -158,7 +224,7 @@ namespace operation
     else
     {
       Container output(input.size());
-      scalar_minus(cc, input, input);
+      scalar_minus(cc, input, output);
       return output;
     }
   }
@@ -171,7 +237,9 @@ namespace operation
   template <typename Container_1, typename Container_2, typename Container_out>
   void minus(Container_1 const& input_1, Container_2 const& input_2, Container_out& output)
   {
-    if constexpr (useful::has_minus_v<Container_1, Container_2>)
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out>)
+      simd::minus(details::data(input_1), details::data(input_2), details::data(output), output.size());
+    else if constexpr (useful::has_minus_v<Container_1, Container_2>)
       output = input_1 - input_2;
     else
     {
@@ -202,7 +270,9 @@ namespace operation
   template <typename Container, typename Scalar, typename Container_out>
   void times_scalar(Scalar lambda, Container const& input, Container_out& output)
   {
-    if constexpr (useful::has_multiplies_v<Scalar, Container>)
+    if constexpr (details::is_simd_v<Container, Container_out> && details::is_simd_scalar_v<Scalar>)
+      simd::times_scalar(double(lambda), details::data(input), details::data(output), output.size());
+    else if constexpr (useful::has_multiplies_v<Scalar, Container>)
       output = lambda*input;
     else
     {
@@ -233,7 +303,9 @@ namespace operation
   template <typename Container_1, typename Container_2, typename Container_out>
   void times(Container_1 const& input_1, Container_2 const& input_2, Container_out& output)
   {
-    if constexpr (useful::has_multiplies_v<Container_1, Container_2>)
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out>)
+      simd::times(details::data(input_1), details::data(input_2), details::data(output), output.size());
+    else if constexpr (useful::has_multiplies_v<Container_1, Container_2>)
       output = input_1*input_2;
     else
     {
@@ -265,7 +337,9 @@ namespace operation
   template <typename Container, typename Scalar, typename Container_out>
   void div_scalar(Container const& input, Scalar lambda, Container_out& output)
   {
-    if constexpr (useful::has_divides_v<Container, Scalar>)
+    if constexpr (details::is_simd_v<Container, Container_out> && details::is_simd_scalar_v<Scalar>)
+      simd::div_scalar(details::data(input), double(lambda), details::data(output), output.size());
+    else if constexpr (useful::has_divides_v<Container, Scalar>)
       output = input/lambda;
     else
     {
@@ -297,7 +371,9 @@ namespace operation
   template <typename Container_1, typename Container_2, typename Container_out>
   void div(Container_1 const& input_1, Container_2 const& input_2, Container_out& output)
   {
-    if constexpr (useful::has_divides_v<Container_1, Container_2>)
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out>)
+      simd::div(details::data(input_1), details::data(input_2), details::data(output), output.size());
+    else if constexpr (useful::has_divides_v<Container_1, Container_2>)
       output = input_1/input_2;
     else
     {
@@ -334,7 +410,11 @@ namespace operation
    Type_2 lambda_2, Container_2 const& input_2,
    Container_out& output)
   {
-    if constexpr (useful::has_multiplies_v<Type_1, Container_1>
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out>
+                  && details::is_simd_scalar_v<Type_1> && details::is_simd_scalar_v<Type_2>)
+      simd::linear(double(lambda_1), details::data(input_1), double(lambda_2), details::data(input_2),
+                   details::data(output), output.size());
+    else if constexpr (useful::has_multiplies_v<Type_1, Container_1>
                   && useful::has_multiplies_v<Type_2, Container_2>
                   && useful::has_plus_v<Container_1, Container_2>)
       output = lambda_1*input_1 + lambda_2*input_2;
@@ -379,7 +459,10 @@ namespace operation
   (Type lambda, Container_1 const& input_1,
    Container_2 const& input_2, Container_out& output)
   {
-    if constexpr (useful::has_multiplies_v<Type, Container_1>
+    if constexpr (details::is_simd_v<Container_1, Container_2, Container_out> && details::is_simd_scalar_v<Type>)
+      simd::linear(double(lambda), details::data(input_1), details::data(input_2),
+                   details::data(output), output.size());
+    else if constexpr (useful::has_multiplies_v<Type, Container_1>
                   && useful::has_plus_v<Container_1, Container_2>)
       output = lambda*input_1 + input_2;
     else
@@ -400,8 +483,8 @@ namespace operation
       return lambda*input_1 + input_2;
     else
     {
-      Container_1 output;
-      LinearOp(lambda, input_1, input_2, output);
+      Container_1 output(input_1.size());
+      linearOp(lambda, input_1, input_2, output);
 
       return output;
     }
@@ -411,7 +494,7 @@ namespace operation
   typename Container_2>
   void linearOp_InPlace
   (Type lambda, Container_1& input_1, Container_2 const& input_2)
-  { LinearOp(lambda, input_1, input_2, input_1); }
+  { linearOp(lambda, input_1, input_2, input_1); }
 
   // Element-wise square
   template <typename Container, typename Container_out>
@@ -519,6 +602,9 @@ namespace operation
   template <typename Container>
   auto abs_sq(Container const& input)
   {
+    if constexpr (details::is_simd_v<Container>)
+      if (input.size() >= details::simd_min)
+        return simd::dot(details::data(input), details::data(input), input.size());
     if constexpr (useful::can_call_abs_v<Container>)
     {
       auto abs = std::abs(input);
@@ -569,6 +655,9 @@ namespace operation
   template <typename Container>
   auto dot(Container const& input_1, Container const& input_2)
   {
+    if constexpr (details::is_simd_v<Container>)
+      if (input_1.size() >= details::simd_min)
+        return simd::dot(details::data(input_1), details::data(input_2), input_1.size());
     typename Container::value_type result{};
     for(size_t ii = 0; ii < input_1.size(); ++ii)
       result += input_1[ii] * input_2[ii];
@@ -582,14 +671,14 @@ namespace operation
   {
     std::size_t counter = 0;
     for (auto const& vec : input_1)
-      output[counter++] = Dot(vec, input_2);
+      output[counter++] = dot(vec, input_2);
   }
 
   template <typename Container_outer, typename Container_inner>
   auto dot(Container_outer const& input_1, Container_inner const& input_2)
   {
     Container_inner output(input_2.size());
-    Dot(input_1, input_2, output);
+    dot(input_1, input_2, output);
 
     return output;
   }
@@ -0,0 +1,78 @@
+//
+// Parallel.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Simple thread pool helpers for independent tasks
+
+#ifndef Parallel_h
+#define Parallel_h
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace parallel
+{
+  // Number of threads to use, with 0 meaning all hardware threads
+  std::size_t nr_threads(std::size_t requested = 0)
+  {
+    if (requested)
+      return requested;
+    return std::max(std::size_t(std::thread::hardware_concurrency()), std::size_t(1));
+  }
+
+  // Call task(index) for each index in [begin, end) using nr_threads threads
+  // Indices are handed out dynamically, so tasks must be independent
+  // The first exception thrown by a task is rethrown after all threads finish
+  template <typename Task>
+  void for_each_index(std::size_t begin, std::size_t end, std::size_t nr_threads, Task task)
+  {
+    if (begin >= end)
+      return;
+    nr_threads = std::min(std::max(nr_threads, std::size_t(1)), end - begin);
+
+    std::atomic<std::size_t> next{ begin };
+    std::exception_ptr exception;
+    std::mutex exception_mutex;
+    auto worker = [&]()
+    {
+      for (std::size_t index = next++; index < end; index = next++)
+      {
+        try
+        { task(index); }
+        catch (...)
+        {
+          std::lock_guard<std::mutex> lock{ exception_mutex };
+          if (!exception)
+            exception = std::current_exception();
+          next = end;
+        }
+      }
+    };
+
+    if (nr_threads == 1)
+      worker();
+    else
+    {
+      std::vector<std::thread> threads;
+      threads.reserve(nr_threads - 1);
+      for (std::size_t tt = 0; tt < nr_threads - 1; ++tt)
+        threads.emplace_back(worker);
+      worker();
+      for (auto& thread : threads)
+        thread.join();
+    }
+
+    if (exception)
+      std::rethrow_exception(exception);
+  }
+}
+
+#endif /* Parallel_h */
@@ -0,0 +1,130 @@
+//
+// Quadrature.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Numerical quadrature rules and numerical inversion of Laplace transforms
+
+#ifndef Quadrature_h
+#define Quadrature_h
+
+#include <cmath>
+#include <complex>
+#include <stdexcept>
+#include <vector>
+#include "Constants.h"
+
+namespace quadrature
+{
+  // Nodes and weights, so that the integral of f is the sum of weights[ii] * f(nodes[ii])
+  struct Rule
+  {
+    std::vector<double> nodes;
+    std::vector<double> weights;
+  };
+
+  // Gauss-Legendre rule with nr_nodes nodes on [x_L, x_R]
+  // Nodes are roots of the Legendre polynomial, found by Newton iteration
+  // from the Chebyshev-like initial guesses, and exclude the endpoints
+  Rule gauss_legendre(std::size_t nr_nodes, double x_L = -1., double x_R = 1.)
+  {
+    if (nr_nodes == 0)
+      throw std::invalid_argument{ "gauss_legendre: Inappropriate parameters" };
+    Rule rule{ std::vector<double>(nr_nodes), std::vector<double>(nr_nodes) };
+    double center = (x_R + x_L) / 2.;
+    double half_width = (x_R - x_L) / 2.;
+    for (std::size_t ii = 0; ii < (nr_nodes + 1) / 2; ++ii)
+    {
+      double xx = std::cos(constants::pi * (double(ii) + 0.75) / (double(nr_nodes) + 0.5));
+      double derivative = 1.;
+      for (std::size_t iteration = 0; iteration < 100; ++iteration)
+      {
+        // Legendre polynomial of degree nr_nodes at xx by the three-term recurrence
+        double poly = 1.;
+        double poly_previous = 0.;
+        for (std::size_t degree = 1; degree <= nr_nodes; ++degree)
+        {
+          double poly_before = poly_previous;
+          poly_previous = poly;
+          poly = ((2. * double(degree) - 1.) * xx * poly_previous
+                  - (double(degree) - 1.) * poly_before) / double(degree);
+        }
+        derivative = double(nr_nodes) * (xx * poly - poly_previous) / (xx * xx - 1.);
+        double step = poly / derivative;
+        xx -= step;
+        if (std::abs(step) < 1.e-15)
+          break;
+      }
+      double weight = 2. / ((1. - xx * xx) * derivative * derivative);
+      rule.nodes[ii] = center - half_width * xx;
+      rule.nodes[nr_nodes - 1 - ii] = center + half_width * xx;
+      rule.weights[ii] = half_width * weight;
+      rule.weights[nr_nodes - 1 - ii] = half_width * weight;
+    }
+    return rule;
+  }
+
+  // Inverse Laplace transform at time > 0 by the fixed Talbot method
+  // (Abate and Valko, Int. J. Numer. Meth. Eng. 60, 2004)
+  // Transform must implement std::complex<double> operator()(std::complex<double>),
+  // the Laplace transform, with singularities only on or near the negative real axis
+  // Relative accuracy improves with nr_nodes up to about 20 in double precision,
+  // beyond which roundoff dominates
+  template <typename Transform>
+  double invert_laplace(Transform&& transform, double time, std::size_t nr_nodes = 20)
+  {
+    if (!(time > 0.) || nr_nodes < 2)
+      throw std::invalid_argument{ "invert_laplace: Inappropriate parameters" };
+    double nodes = double(nr_nodes);
+    double rr = 2. * nodes / (5. * time);
+    double sum = 0.5 * std::real(transform(std::complex<double>{ rr })) * std::exp(rr * time);
+    for (std::size_t kk = 1; kk < nr_nodes; ++kk)
+    {
+      double theta = constants::pi * double(kk) / nodes;
+      double cotangent = std::cos(theta) / std::sin(theta);
+      std::complex<double> ss{ rr * theta * cotangent, rr * theta };
+      double sigma = theta + (theta * cotangent - 1.) * cotangent;
+      sum += std::real(std::exp(ss * time) * transform(ss) * std::complex<double>{ 1., sigma });
+    }
+    return rr / nodes * sum;
+  }
+
+  // Inverse Laplace transform at time > 0 by the Euler method of Abate and Whitt
+  // (ORSA J. Comput. 7, 1995), the trapezoidal rule on the Bromwich line Re(s) = A / (2 time)
+  // with Euler summation of the last nr_averaged + 1 partial sums
+  // Only evaluates the transform in the right half-plane, so it suits transforms that
+  // grow without bound elsewhere, such as exp(-phi(s)) for Laplace exponents phi,
+  // and distribution functions, with a discretization error about exp(-A) times their size
+  template <typename Transform>
+  double invert_laplace_euler
+  (Transform&& transform, double time, std::size_t nr_terms = 15, std::size_t nr_averaged = 11,
+   double aa = 18.4)
+  {
+    if (!(time > 0.))
+      throw std::invalid_argument{ "invert_laplace_euler: Inappropriate parameters" };
+    double real = aa / (2. * time);
+    double imaginary = constants::pi / time;
+    double factor = std::exp(aa / 2.) / time;
+    double partial = 0.5 * std::real(transform(std::complex<double>{ real }));
+    for (std::size_t kk = 1; kk <= nr_terms; ++kk)
+      partial += (kk % 2 ? -1. : 1.)
+        * std::real(transform(std::complex<double>{ real, imaginary * double(kk) }));
+    // Binomial average of partial sums nr_terms to nr_terms + nr_averaged
+    double binomial = 1.;
+    double average = partial;
+    for (std::size_t jj = 1; jj <= nr_averaged; ++jj)
+    {
+      std::size_t kk = nr_terms + jj;
+      partial += (kk % 2 ? -1. : 1.)
+        * std::real(transform(std::complex<double>{ real, imaginary * double(kk) }));
+      binomial *= double(nr_averaged - jj + 1) / double(jj);
+      average += binomial * partial;
+    }
+    return factor * average / std::pow(2., double(nr_averaged));
+  }
+}
+
+#endif /* Quadrature_h */
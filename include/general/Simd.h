@@ -0,0 +1,252 @@
+//
+// Simd.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Branch-free numerical kernels written so that the compiler
+// auto-vectorizes loops over contiguous arrays (no intrinsics)
+// GCC only if-converts the selects when compiled with -fno-trapping-math
+// Assumes IEEE-754 doubles and the default round-to-nearest mode
+// Kernels marked SIMD_DISPATCH are compiled for AVX-512, AVX2 and the baseline (SSE2 on x86-64),
+// the best supported by the machine being chosen at load time
+// Reductions accumulate in a fixed number of lanes combined in a fixed order,
+// so that results do not depend on the instruction set, but differ in rounding
+// from a sequential sum
+// Dispatched kernels never fuse a multiplication and an addition into an FMA,
+// which only the AVX-512 build could use, so that every build rounds alike
+
+#ifndef Simd_h
+#define Simd_h
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) && defined(__has_attribute)
+#if __has_attribute(target_clones)
+#define SIMD_DISPATCH __attribute__((target_clones("avx512f", "avx2", "default")))
+#endif
+#endif
+#ifndef SIMD_DISPATCH
+#define SIMD_DISPATCH
+#endif
+
+// Clang contracts within an expression unless told otherwise inside the function body,
+// GCC across expressions unless the kernels are compiled with fp-contract=off below
+#if defined(__clang__)
+#define SIMD_NO_CONTRACT _Pragma("clang fp contract(off)")
+#else
+#define SIMD_NO_CONTRACT
+#endif
+
+namespace simd
+{
+  // Exponential, relative error within a few ulp
+  // Arguments below -708 give 0, arguments above 709 are clamped
+  // Range reduction x = n ln 2 + r, |r| <= ln 2 / 2, with a two-term ln 2,
+  // then a degree-12 Taylor polynomial for e^r and scaling by 2^n
+  // built directly in the exponent bits
+  inline double exp(double xx)
+  {
+    constexpr double log2e = 1.4426950408889634;
+    constexpr double ln2_hi = 6.93147180369123816490e-01;
+    constexpr double ln2_lo = 1.90821492927058770002e-10;
+    constexpr double shift = 0x1.8p52;
+
+    double clamped = xx < -708. ? -708. : xx;
+    clamped = clamped > 709. ? 709. : clamped;
+    double kk = clamped * log2e + shift;
+    double nn = kk - shift;
+    double rr = clamped - nn * ln2_hi;
+    rr = rr - nn * ln2_lo;
+
+    double pp = 1. / 479001600.;
+    pp = pp * rr + 1. / 39916800.;
+    pp = pp * rr + 1. / 3628800.;
+    pp = pp * rr + 1. / 362880.;
+    pp = pp * rr + 1. / 40320.;
+    pp = pp * rr + 1. / 5040.;
+    pp = pp * rr + 1. / 720.;
+    pp = pp * rr + 1. / 120.;
+    pp = pp * rr + 1. / 24.;
+    pp = pp * rr + 1. / 6.;
+    pp = pp * rr + 0.5;
+    pp = pp * rr + 1.;
+    pp = pp * rr + 1.;
+
+    // The low mantissa bits of kk hold n in two's complement
+    std::uint64_t bits;
+    std::memcpy(&bits, &kk, sizeof bits);
+    bits = (bits << 52) + 0x3ff0000000000000ull;
+    double scale;
+    std::memcpy(&scale, &bits, sizeof scale);
+
+    // Flush underflow by masking rather than branching
+    return pp * scale * double(xx >= -708.);
+  }
+
+  // output[ii] = exp(input[ii]) for ii in [0, nr_values)
+  // input and output may be the same array
+  inline void exp(double const* input, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = exp(input[ii]);
+  }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC push_options
+#pragma GCC optimize("fp-contract=off")
+#endif
+
+  namespace lanes
+  {
+    // Number of partial sums of reductions, enough to fill an AVX-512 register
+    constexpr std::size_t width = 8;
+
+    // Sum of the values into width lanes, value ii going to lane ii % width,
+    // and of the lanes as a balanced tree
+    template <typename Value, typename Term>
+    inline Value reduce(std::size_t nr_values, Term term)
+    {
+      SIMD_NO_CONTRACT
+      Value partial[width] = {};
+      std::size_t ii = 0;
+      for (; ii + width <= nr_values; ii += width)
+        for (std::size_t lane = 0; lane < width; ++lane)
+          partial[lane] += term(ii + lane);
+      for (std::size_t lane = 0; ii < nr_values; ++ii, ++lane)
+        partial[lane] += term(ii);
+      return ((partial[0] + partial[1]) + (partial[2] + partial[3]))
+        + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+    }
+  }
+
+  // Sum of input[ii] for ii in [0, nr_values)
+  SIMD_DISPATCH inline double sum(double const* input, std::size_t nr_values)
+  { return lanes::reduce<double>(nr_values, [input](std::size_t ii) { return input[ii]; }); }
+
+  SIMD_DISPATCH inline std::size_t sum(std::size_t const* input, std::size_t nr_values)
+  { return lanes::reduce<std::size_t>(nr_values, [input](std::size_t ii) { return input[ii]; }); }
+
+  // Sum as sum, over blocks of pairwise_block values then pairwise over blocks,
+  // with error growing as the logarithm of nr_values rather than linearly
+  constexpr std::size_t pairwise_block = 1024;
+
+  SIMD_DISPATCH inline double sum_pairwise(double const* input, std::size_t nr_values)
+  {
+    // Pending subtotals, the one at level ll covering 2^ll blocks, merged as a binary counter
+    double subtotals[64];
+    std::size_t levels[64];
+    std::size_t nr_pending = 0;
+    for (std::size_t first = 0; first < nr_values; first += pairwise_block)
+    {
+      std::size_t size = nr_values - first < pairwise_block ? nr_values - first : pairwise_block;
+      double subtotal = lanes::reduce<double>(size,
+        [input, first](std::size_t ii) { return input[first + ii]; });
+      std::size_t level = 0;
+      while (nr_pending && levels[nr_pending - 1] == level)
+      {
+        subtotal = subtotals[--nr_pending] + subtotal;
+        ++level;
+      }
+      subtotals[nr_pending] = subtotal;
+      levels[nr_pending++] = level;
+    }
+    double total = 0.;
+    while (nr_pending)
+      total = subtotals[--nr_pending] + total;
+    return total;
+  }
+
+  // Sum of input_1[ii] * input_2[ii] for ii in [0, nr_values)
+  SIMD_DISPATCH inline double dot(double const* input_1, double const* input_2, std::size_t nr_values)
+  {
+    return lanes::reduce<double>(nr_values,
+      [input_1, input_2](std::size_t ii) { SIMD_NO_CONTRACT return input_1[ii] * input_2[ii]; });
+  }
+
+  // Element-wise operations, output[ii] = op(input_1[ii], input_2[ii]) or op(input[ii], cc)
+  // for ii in [0, nr_values), computed exactly as the scalar expression
+  // Outputs may be the same array as an input
+  SIMD_DISPATCH inline void plus(double const* input_1, double const* input_2, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input_1[ii] + input_2[ii];
+  }
+
+  SIMD_DISPATCH inline void minus(double const* input_1, double const* input_2, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input_1[ii] - input_2[ii];
+  }
+
+  SIMD_DISPATCH inline void times(double const* input_1, double const* input_2, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input_1[ii] * input_2[ii];
+  }
+
+  SIMD_DISPATCH inline void div(double const* input_1, double const* input_2, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input_1[ii] / input_2[ii];
+  }
+
+  SIMD_DISPATCH inline void plus_scalar(double const* input, double cc, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input[ii] + cc;
+  }
+
+  SIMD_DISPATCH inline void minus_scalar(double const* input, double cc, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input[ii] - cc;
+  }
+
+  SIMD_DISPATCH inline void scalar_minus(double cc, double const* input, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = cc - input[ii];
+  }
+
+  SIMD_DISPATCH inline void times_scalar(double cc, double const* input, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = cc * input[ii];
+  }
+
+  SIMD_DISPATCH inline void div_scalar(double const* input, double cc, double* output, std::size_t nr_values)
+  {
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = input[ii] / cc;
+  }
+
+  // output[ii] = lambda_1 * input_1[ii] + lambda_2 * input_2[ii]
+  SIMD_DISPATCH inline void linear(double lambda_1, double const* input_1, double lambda_2, double const* input_2,
+                                   double* output, std::size_t nr_values)
+  {
+    SIMD_NO_CONTRACT
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = lambda_1 * input_1[ii] + lambda_2 * input_2[ii];
+  }
+
+  // output[ii] = lambda * input_1[ii] + input_2[ii]
+  SIMD_DISPATCH inline void linear(double lambda, double const* input_1, double const* input_2,
+                                   double* output, std::size_t nr_values)
+  {
+    SIMD_NO_CONTRACT
+    for (std::size_t ii = 0; ii < nr_values; ++ii)
+      output[ii] = lambda * input_1[ii] + input_2[ii];
+  }
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC pop_options
+#endif
+}
+
+#endif /* Simd_h */
@@ -0,0 +1,181 @@
+//
+// Statistics.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Online mean and variance estimates and convergence checks
+// Accumulators are updated one sample at a time (Welford) and can be merged
+// (Chan et al.), so partial results from threads or shards combine exactly
+// Weighted accumulators handle importance-sampled samples
+
+#ifndef Statistics_h
+#define Statistics_h
+
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <vector>
+
+namespace statistics
+{
+  class Welford
+  {
+  public:
+    void add(double val)
+    {
+      ++nr_samples;
+      double delta = val - mean_val;
+      mean_val += delta / double(nr_samples);
+      sum_squares += delta * (val - mean_val);
+    }
+
+    void merge(Welford const& other)
+    {
+      if (!other.nr_samples)
+        return;
+      std::size_t nr_total = nr_samples + other.nr_samples;
+      double delta = other.mean_val - mean_val;
+      mean_val += delta * double(other.nr_samples) / double(nr_total);
+      sum_squares += other.sum_squares
+        + delta * delta * double(nr_samples) * double(other.nr_samples) / double(nr_total);
+      nr_samples = nr_total;
+    }
+
+    std::size_t size() const
+    { return nr_samples; }
+
+    double mean() const
+    { return mean_val; }
+
+    // Unbiased sample variance, zero for fewer than two samples
+    double variance() const
+    { return nr_samples > 1 ? sum_squares / double(nr_samples - 1) : 0.; }
+
+    // Standard error of the mean
+    double standard_error() const
+    { return nr_samples > 1 ? std::sqrt(variance() / double(nr_samples)) : 0.; }
+
+    // Standard error relative to the mean, zero if both vanish
+    double relative_error() const
+    {
+      double error = standard_error();
+      if (error == 0.)
+        return nr_samples > 1 ? 0. : HUGE_VAL;
+      return error / std::abs(mean_val);
+    }
+
+    // Set from stored values, e.g. read back from a file
+    void set(std::size_t nr_samples, double mean, double variance)
+    {
+      this->nr_samples = nr_samples;
+      mean_val = mean;
+      sum_squares = nr_samples > 1 ? variance * double(nr_samples - 1) : 0.;
+    }
+
+  private:
+    std::size_t nr_samples{ 0 };
+    double mean_val{ 0. };
+    double sum_squares{ 0. };    // Sum of squared deviations from the mean
+  };
+
+  // Importance-sampling estimates from samples with likelihood-ratio weights,
+  // i.e. of the mean under the target law of samples drawn under a biased law
+  // The estimate is the plain mean of weight * value, unbiased for exact weights,
+  // with the effective sample size (sum of weights)^2 / (sum of squared weights)
+  // as a diagnostic of weight degeneracy
+  class Weighted
+  {
+  public:
+    void add(double val, double weight)
+    {
+      products.add(weight * val);
+      sum_weights += weight;
+      sum_weights_squared += weight * weight;
+      sum_weighted_values += weight * val;
+    }
+
+    void merge(Weighted const& other)
+    {
+      products.merge(other.products);
+      sum_weights += other.sum_weights;
+      sum_weights_squared += other.sum_weights_squared;
+      sum_weighted_values += other.sum_weighted_values;
+    }
+
+    std::size_t size() const
+    { return products.size(); }
+
+    double mean() const
+    { return products.mean(); }
+
+    double standard_error() const
+    { return products.standard_error(); }
+
+    // Accumulator of weight * value
+    Welford const& weighted() const
+    { return products; }
+
+    // Self-normalized estimate, sum of weight * value over sum of weights,
+    // biased but often of lower variance when weights are far from one
+    double mean_normalized() const
+    { return sum_weights > 0. ? sum_weighted_values / sum_weights : 0.; }
+
+    double effective_size() const
+    { return sum_weights_squared > 0. ? sum_weights * sum_weights / sum_weights_squared : 0.; }
+
+  private:
+    Welford products;
+    double sum_weights{ 0. };
+    double sum_weights_squared{ 0. };
+    double sum_weighted_values{ 0. };
+  };
+
+  // True if all accumulators have at least min_samples samples
+  // and relative standard error at most tolerance
+  inline bool converged(std::vector<Welford> const& accumulators, double tolerance,
+                        std::size_t min_samples = 10)
+  {
+    for (auto const& accumulator : accumulators)
+      if (accumulator.size() < min_samples || accumulator.relative_error() > tolerance)
+        return 0;
+    return 1;
+  }
+
+  // Stopping rule for adding samples in rounds: stop once converged
+  // to a relative tolerance or after a wall-clock time budget in seconds,
+  // measured with a monotonic clock so that threads do not consume it faster
+  // A zero tolerance or budget disables that criterion
+  class Stopping
+  {
+  public:
+    Stopping(double tolerance = 0., double budget = 0.)
+    : tolerance{ tolerance }
+    , budget{ budget }
+    , start{ std::chrono::steady_clock::now() }
+    {}
+
+    bool enabled() const
+    { return tolerance > 0. || budget > 0.; }
+
+    double elapsed_time() const
+    { return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count(); }
+
+    bool operator()(std::vector<Welford> const& accumulators) const
+    {
+      if (tolerance > 0. && converged(accumulators, tolerance))
+        return 1;
+      return budget > 0. && elapsed_time() >= budget;
+    }
+
+    const double tolerance;
+    const double budget;
+
+  private:
+    const std::chrono::steady_clock::time_point start;
+  };
+}
+
+#endif /* Statistics_h */
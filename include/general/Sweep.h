@@ -0,0 +1,196 @@
+//
+// Sweep.h
+// general
+//
+// Created by Tomas Aquino on 10/18/26.
+// Copyright (c) 2026 Tomas Aquino. All rights reserved.
+//
+
+// Parameter sweeps run in a single process
+// A sweep file holds one parameter set per line, values separated by whitespace,
+// in the same order as the command line parameters of the program
+// Empty lines and lines starting with # are ignored
+// A value may also be a list, v1,v2,v3, or an evenly spaced grid, min:max:nr,
+// and a line then stands for all combinations of its values
+// Programs running a sweep tag each output filename with the index of its point,
+// since rounded parameters in filenames may coincide for distinct points
+
+#ifndef Sweep_h
+#define Sweep_h
+
+#include <algorithm>
+#include <exception>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <numeric>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "general/Parallel.h"
+#include "general/useful.h"
+
+namespace sweep
+{
+  // Values a single sweep-file entry stands for
+  std::vector<std::string> expand(std::string const& entry)
+  {
+    if (entry.find(',') != std::string::npos)
+      return useful::split(entry, ",");
+    if (entry.find(':') != std::string::npos)
+    {
+      auto bounds = useful::split(entry, ":");
+      if (bounds.size() != 3)
+        throw useful::bad_parameters();
+      double min = std::stod(bounds[0]);
+      double max = std::stod(bounds[1]);
+      std::size_t nr_values = std::stoul(bounds[2]);
+      if (nr_values == 0)
+        throw useful::bad_parameters();
+      std::vector<std::string> values;
+      for (std::size_t ii = 0; ii < nr_values; ++ii)
+      {
+        std::ostringstream value;
+        value.precision(17);
+        value << (nr_values == 1 ? min : min + (max - min) * ii / (nr_values - 1));
+        values.push_back(value.str());
+      }
+      return values;
+    }
+    return { entry };
+  }
+
+  // Parameter sets in filename, each with nr_values values
+  std::vector<std::vector<std::string>> load(std::string const& filename, std::size_t nr_values)
+  {
+    std::ifstream file{ filename };
+    if (!file.is_open())
+      throw useful::open_read_error(filename);
+
+    std::vector<std::vector<std::string>> points;
+    std::string line;
+    while (std::getline(file, line))
+    {
+      std::size_t start = line.find_first_not_of(" \t\r");
+      if (start == std::string::npos || line[start] == '#')
+        continue;
+      std::istringstream stream{ line };
+      std::vector<std::vector<std::string>> entries;
+      std::string entry;
+      while (stream >> entry)
+        entries.push_back(expand(entry));
+      // A list of separators only, e.g. ",", stands for no values
+      if (entries.size() != nr_values
+          || std::any_of(entries.begin(), entries.end(),
+                         [](auto const& values) { return values.empty(); }))
+        throw useful::parse_error(filename, line);
+
+      // All combinations, last entry varying fastest
+      std::vector<std::size_t> index(nr_values, 0);
+      while (1)
+      {
+        std::vector<std::string> point;
+        for (std::size_t vv = 0; vv < nr_values; ++vv)
+          point.push_back(entries[vv][index[vv]]);
+        points.push_back(point);
+        std::size_t vv = nr_values;
+        while (vv > 0 && ++index[vv - 1] == entries[vv - 1].size())
+          index[--vv] = 0;
+        if (vv == 0)
+          break;
+      }
+    }
+    return points;
+  }
+
+  // Threads of a sweep, shared by the points it is running
+  // Each running point holds one thread; once no point is left to start,
+  // the threads of finished points are released and shared evenly
+  // among the points still running, which read available() as they go
+  class Threads
+  {
+  public:
+    Threads(std::size_t nr_threads, std::size_t nr_points)
+    : nr_threads{ std::max(nr_threads, std::size_t(1)) }
+    , nr_unstarted{ nr_points }
+    {}
+
+    // Threads a running point may use now, at least its own
+    std::size_t available() const
+    {
+      std::lock_guard<std::mutex> lock{ mutex };
+      if (nr_unstarted || nr_running == 0 || nr_running >= nr_threads)
+        return 1;
+      return 1 + (nr_threads - nr_running) / nr_running;
+    }
+
+    void start()
+    {
+      std::lock_guard<std::mutex> lock{ mutex };
+      --nr_unstarted;
+      ++nr_running;
+    }
+
+    void finish()
+    {
+      std::lock_guard<std::mutex> lock{ mutex };
+      --nr_running;
+    }
+
+  private:
+    const std::size_t nr_threads;
+    std::size_t nr_unstarted;
+    std::size_t nr_running{ 0 };
+    mutable std::mutex mutex;
+  };
+
+  // Call task(point, threads) for each point in [0, costs.size()) on nr_threads threads,
+  // longest estimated cost first, so that long points do not form the tail
+  // Points are scheduled statically, one per thread, but a point may run its own work
+  // on threads.available() threads, which grows as other points finish
+  // A failing point is reported and does not stop the others
+  // Returns the number of failed points
+  template <typename Task>
+  std::size_t run(std::vector<double> const& costs, std::size_t nr_threads, Task task)
+  {
+    std::mutex output_mutex;
+    std::vector<std::size_t> order(costs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+      [&costs](std::size_t left, std::size_t right)
+      { return costs[left] > costs[right]; });
+
+    Threads threads{ nr_threads, costs.size() };
+    std::vector<char> failed(costs.size(), 0);
+    auto fail = [&](std::size_t point, std::string const& what)
+    {
+      failed[point] = 1;
+      std::lock_guard<std::mutex> lock{ output_mutex };
+      std::cerr << "point " << point << " failed: " << what << std::endl;
+    };
+    parallel::for_each_index(0, order.size(), nr_threads,
+      [&](std::size_t index)
+      {
+        std::size_t point = order[index];
+        threads.start();
+        try
+        {
+          task(point, threads);
+          std::lock_guard<std::mutex> lock{ output_mutex };
+          std::cout << "point " << point << " done" << std::endl;
+        }
+        catch (std::exception const& exception)
+        { fail(point, exception.what()); }
+        catch (...)
+        { fail(point, "unknown exception"); }
+        threads.finish();
+      });
+    return std::size_t(std::count(failed.begin(), failed.end(), 1));
+  }
+
+  // Filename tag of point, unique within a sweep
+  std::string filename_suffix(std::size_t point)
+  { return "_point_" + std::to_string(point); }
+}
+
+#endif /* Sweep_h */
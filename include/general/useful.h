@@ -17,9 +17,11 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <sstream>
 #include <stdexcept>
 #include <string>
 #include <type_traits>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -125,95 +127,39 @@ namespace useful
     return std::invalid_argument{ "Inappropriate parameters" };
   }
   
-  //Load 1-column file into vectors of doubles
-  auto load_1
-  (std::string const& filename, std::size_t nr_estimate = 0,
-   std::size_t header_lines = 0,
-   std::string const& delim = " ")
-  {
-    using Value = double;
-    using Container = std::vector<Value>;
-    Container values;
-    values.reserve(nr_estimate);
-    
-    std::ifstream file(filename);
-    std::string line;
-    for (std::size_t ll = 0; ll < header_lines; ++ll)
-      getline(file, line);
-    
-    while (getline(file, line))
-    {
-      std::vector<std::string> split_line = split(line, delim);
-      if (split_line.size() != 1)
-        throw parse_error(filename, line);
-      values.push_back(std::stod(split_line[0]));
-    }
-    file.close();
-    
-    return values;
-  }
+  // Optional command line arguments of the form name=value
+  using Options = std::unordered_map<std::string, std::string>;
   
-  //Load 2-column file into pair of vectors of doubles
-  auto load_2
- (std::string const& filename, std::size_t nr_estimate = 0,
-  std::size_t header_lines = 0, std::string const& delim = " ")
-  {
-    using Value = double;
-    using Container = std::vector<Value>;
-    std::pair<Container, Container> values;
-    values.first.reserve(nr_estimate);
-    values.second.reserve(nr_estimate);
-    
-    std::ifstream file(filename);
-    if (!file.is_open())
-      throw useful::open_read_error(filename);
-    std::string line;
-    for (std::size_t ll = 0; ll < header_lines; ++ll)
-      getline(file, line);
-    
-    while (getline(file, line))
+  bool is_option(std::string const& arg)
+  { return arg.find('=') != std::string::npos; }
+  
+  // Parse name=value arguments from argv[first] on
+  Options parse_options(int argc, const char* argv[], std::size_t first)
+  {
+    Options options;
+    for (std::size_t aa = first; aa < std::size_t(argc); ++aa)
     {
-      std::vector<std::string> split_line = split(line, delim);
-      if (split_line.size() != 2)
-        throw parse_error(filename, line);
-      
-      values.first.push_back(std::stod(split_line[0]));
-      values.second.push_back(std::stod(split_line[1]));
+      std::string arg{ argv[aa] };
+      std::size_t position = arg.find('=');
+      if (position == std::string::npos || position == 0)
+        throw bad_parameters();
+      options[arg.substr(0, position)] = arg.substr(position + 1);
     }
-    file.close();
-    
-    return values;
+    return options;
   }
   
-  //Load file into vector of vectors of doubles
-  auto load(std::string const& filename, std::size_t nr_columns,
-            std::size_t nr_estimate = 0,
-              std::size_t header_lines = 0,
-              std::string const& delim = " ")
-  {
-    using Value = double;
-    using Container = std::vector<Value>;
-    std::vector<Container> values(nr_columns);
-    for (auto& val : values)
-      val.reserve(nr_estimate);
-    
-    std::ifstream file(filename);
-    std::string line;
-    for (std::size_t ll = 0; ll < header_lines; ++ll)
-      getline(file, line);
-    
-    while (getline(file, line))
-    {
-      std::vector<std::string> split_line = split(line, delim);
-      if (split_line.size() != nr_columns)
-        throw parse_error(filename, line);
-      
-      for (std::size_t cc = 0; cc < nr_columns; ++cc)
-        values[cc].push_back(std::stod(split_line[cc]));
-    }
-    file.close();
-    
-    return values;
+  // Value of option name, or default_value if not given
+  template <typename Value>
+  Value option(Options const& options, std::string const& name, Value default_value)
+  {
+    auto it = options.find(name);
+    if (it == options.end())
+      return default_value;
+    std::istringstream stream{ it->second };
+    Value value;
+    if (!(stream >> value))
+      throw bad_parameters();
+    return value;
   }
   
   // From Anton Dyachenko's answer here:
@@ -340,21 +286,6 @@ namespace useful
     }
   }
   
-  auto read
-  (std::string const& filename)
-  {
-    std::ifstream file{ filename };
-    if (!file.is_open())
-      throw useful::open_read_error(filename);
-    std::vector<double> vals;
-    double val;
-    while(file >> val)
-      vals.push_back(val);
-    file.close();
-
-    return vals;
-  }
-  
   struct DoNothing
   {
     template <typename ...Args>
@@ -634,4 +565,8 @@ namespace useful
   { using type = indices<>; };
 }
 
+// Loaders of numeric text files, useful::load_1, load_2, load and read,
+// defined apart as they build on MappedFile and Parallel
+#include "general/Load.h"
+
 #endif /* USEFUL_H_ */
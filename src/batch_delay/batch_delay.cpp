@@ -5,19 +5,56 @@
 //  Copyright © 2017 Tomas Aquino. All rights reserved.
 //
 
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
+#include "general/Columnar.h"
 #include "general/Constants.h"
 #include "general/Operations.h"
 #include "general/Ranges.h"
+#include "general/Statistics.h"
 #include "general/useful.h"
 #include "Stochastic/Reaction.h"
 #include "Stochastic/Stoichiometry.h"
+#include "Stochastic/Gillespie/EventLog.h"
 #include "Stochastic/Gillespie/Gillespie_Stoichiometric.h"
+#include "Stochastic/Gillespie/Gillespie_Weighted.h"
+#include "Stochastic/Gillespie/MeanField.h"
 
 int main(int argc, const char * argv[])
 {
+  //  Options (name=value):
+  //  format = 0 for text, 1 for columnar binary (.col)
+  //  tolerance = target relative standard error at all measures, to stop early [0, off]
+  //  budget = wall-clock time budget in seconds, to stop early [0, off]
+  //  seed = base seed keying each ensemble's random numbers to its index,
+  //         for common random numbers across parameter values [0, off]
+  //  tilt = factor multiplying the reaction propensity, for importance sampling [1, off]
+  //  tilt_delay = factor multiplying the rate of delay events, for importance sampling [1, off]
+  //  With importance sampling, averages are of weight * particles and the effective
+  //  sample size at each measure is also output; tilt < 1 and tilt_delay > 1
+  //  favor late survivors
+  //  meanfield = 1 to solve the mean-field limit instead of simulating, with zero errors,
+  //              written with _MeanField appended to the file name [0]
+  //  panels = number of quadrature panels per half measure time of the mean-field solver [32]
+  //  record = number of leading ensembles whose every reaction is logged, without importance
+  //           sampling, to the file name with _events.bin appended (see EventLog.h) [0]
+  useful::Options options = useful::parse_options(argc, argv, 1);
+  std::size_t format = useful::option<std::size_t>(options, "format", 0);
+  statistics::Stopping stopping{ useful::option<double>(options, "tolerance", 0.),
+                                 useful::option<double>(options, "budget", 0.) };
+  std::uint64_t seed = useful::option<std::uint64_t>(options, "seed", 0);
+  double tilt = useful::option<double>(options, "tilt", 1.);
+  double tilt_delay = useful::option<double>(options, "tilt_delay", 1.);
+  bool meanfield = useful::option<bool>(options, "meanfield", 0);
+  bool weighted = !meanfield && (tilt != 1. || tilt_delay != 1.);
+  std::size_t nr_panels = useful::option<std::size_t>(options, "panels", 32);
+  std::size_t nr_record = weighted || meanfield ? 0 : useful::option<std::size_t>(options, "record", 0);
+  if (!(tilt > 0.) || !(tilt_delay > 0.) || nr_panels == 0)
+    throw useful::bad_parameters();
+
   //  Initial particle numbers of each species type
   std::vector<std::size_t> particles_initial{ 100000, 100000 };
   
@@ -33,53 +70,122 @@ int main(int argc, const char * argv[])
                                                      std::cos(constants::pi*delay_exponent/2.)*
                                                       delay_characteristic_time,
                                                      1./delay_exponent);
-  using NumberProcess = stochastic::NumberProcess_Poisson;
+  using NumberProcess = stochastic::NumberProcess_Poisson<>;
   using Delay = stochastic::DelayTime_CompoundSkewedLevyStable<NumberProcess>;
 
   //  Max simulation time
   double time_max = 1e5;
 
-  //  Nr of ensembles to average over
-  std::size_t nr_ensembles = 100;
+  //  Nr of ensembles to average over, at most if stopping early, none for the mean field
+  std::size_t nr_ensembles = meanfield ? 0 : 100;
 
   //  Prepare stuff for data
   double time_min = 1e-2;
   std::size_t nr_measures = 30;
   std::vector< double > measure_times = range::logspace<std::vector<double>>
     (time_min, time_max, nr_measures);
-  std::vector< double > concentration(nr_measures);
+  std::vector<statistics::Welford> statistics_concentration(nr_measures);
+  std::vector<statistics::Weighted> statistics_weighted(nr_measures);
 
-  //  Make Gillespie simulator
+  //  Make Gillespie simulators
+  Delay delay{ delay_rate, delay_exponent, delay_characteristic_time_scaled };
   auto gillespie = gillespie::make_Gillespie_MassAction_Delay(
-                           particles_initial,
-                           Delay{
-                            delay_rate,
-                            delay_exponent, delay_characteristic_time_scaled },
-                           stoichiometry_1);
-  
+                           particles_initial, delay, stoichiometry_1);
+  auto gillespie_weighted = gillespie::make_Gillespie_MassAction_Weighted(
+                           particles_initial, { stoichiometry_1 }, delay,
+                           gillespie::Tilting_Constant{ { tilt }, tilt_delay });
+
+  //  Event log of the recorded ensembles
+  std::string output_dir = "../output";
+  std::string filename{ "Data_Gillespie_Delay_Example_CompoundStable" };
+  std::unique_ptr<gillespie::EventLog_Writer> event_log;
+  if (nr_record)
+    event_log = std::make_unique<gillespie::EventLog_Writer>(
+      output_dir + "/" + filename + "_events.bin", gillespie);
+
+  //  Mean-field limit, as a single deterministic ensemble
+  std::size_t nr_ensembles_run = 0;
+  if (meanfield)
+  {
+    std::vector<double> concentrations_initial(particles_initial.begin(), particles_initial.end());
+    auto meanfield_solver = gillespie::make_MeanField_MassAction_Delay(
+      concentrations_initial, { stoichiometry_1 }, delay, nr_panels);
+    meanfield_solver.observe(measure_times, [&](std::size_t measure, auto const& concentrations)
+    { statistics_concentration[measure].add(concentrations[0]); });
+    nr_ensembles_run = 1;
+  }
+
   //  Run each ensemble of particles
   //  Measure number concentration over time of species 0
   for (std::size_t ensemble = 0; ensemble < nr_ensembles; ++ensemble)
   {
     std::cout << "ensemble = " << ensemble << "\n";
-    gillespie.set(particles_initial);
-    double particles = 0.;
-    for (std::size_t measure = 0; measure < nr_measures; ++measure)
+    if (weighted)
+    {
+      gillespie_weighted.set(particles_initial);
+      if (seed)
+        gillespie_weighted.seed(stochastic::seed_realization(seed, ensemble));
+      gillespie_weighted.observe(measure_times, [&](std::size_t measure, auto const& state)
+      {
+        statistics_weighted[measure].add(double(state.particles(0)), state.weight());
+        statistics_concentration[measure] = statistics_weighted[measure].weighted();
+      });
+    }
+    else
     {
-      std::cout << "\ttime = " << gillespie.time() << "\n";
-      while (gillespie.time() < measure_times[ measure ])
+      gillespie.set(particles_initial);
+      if (seed)
+        gillespie.seed(stochastic::seed_realization(seed, ensemble));
+      auto observer = [&](std::size_t measure, auto const& state)
+      { statistics_concentration[measure].add(double(state.particles(0))); };
+      if (ensemble < nr_record)
       {
-        particles = gillespie.particles(0);
-        gillespie.evolve();
+        event_log->begin(ensemble, particles_initial, gillespie.time());
+        gillespie.observe(measure_times, observer, *event_log);
       }
-      concentration[measure] += particles;
+      else
+        gillespie.observe(measure_times, observer);
     }
+    ++nr_ensembles_run;
+    if (stopping.enabled() && stopping(statistics_concentration))
+      break;
+  }
+  if (event_log)
+    event_log->close();
+  std::vector<double> concentration(nr_measures);
+  std::vector<double> error(nr_measures);
+  std::vector<double> effective_size(nr_measures);
+  for (std::size_t measure = 0; measure < nr_measures; ++measure)
+  {
+    concentration[measure] = statistics_concentration[measure].mean();
+    error[measure] = statistics_concentration[measure].standard_error();
+    effective_size[measure] = statistics_weighted[measure].effective_size();
   }
-  operation::div_scalar_InPlace(concentration, nr_ensembles);
 
   //  Output
-  std::string output_dir = "../output";
-  std::string filename{ "Data_Gillespie_Delay_Example_CompoundStable.dat" };
+  if (meanfield)
+    filename += "_MeanField";
+  if (format == 1)
+  {
+    columnar::Table table;
+    table.attribute("model", "Gillespie_Delay_Example_CompoundStable");
+    table.attribute("particles_initial", particles_initial[0]);
+    table.attribute("delay_exponent", delay_exponent);
+    table.attribute("delay_characteristic_time", delay_characteristic_time);
+    table.attribute("nr_ensembles", nr_ensembles_run);
+    table.attribute("tilt", tilt);
+    table.attribute("tilt_delay", tilt_delay);
+    if (meanfield)
+      table.attribute("panels", nr_panels);
+    table.column("time", measure_times);
+    table.column("particles", concentration);
+    table.column("particles_se", error);
+    if (weighted)
+      table.column("effective_size", effective_size);
+    table.write(output_dir + "/" + filename + ".col");
+    return 0;
+  }
+  filename += ".dat";
   std::ofstream output{ output_dir + "/" + filename };
   if (!output.is_open())
     throw useful::open_write_error(filename);
@@ -90,6 +196,15 @@ int main(int argc, const char * argv[])
   output << double(particles_initial[0]) << "\t";
   useful::print(output, concentration);
   output << "\n";
+  output << 0. << "\t";
+  useful::print(output, error);
+  output << "\n";
+  if (weighted)
+  {
+    output << double(nr_ensembles_run) << "\t";
+    useful::print(output, effective_size);
+    output << "\n";
+  }
   output.close();
   
   return 0;
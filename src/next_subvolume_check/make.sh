@@ -0,0 +1,3 @@
+#!/bin/bash
+make next_subvolume_check
+mv next_subvolume_check ../../bin/next_subvolume_check
@@ -0,0 +1,137 @@
+//
+//  next_subvolume_check.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Check NextSubvolume against known limits: a single subvolume is well mixed,
+//  so its mean particle numbers must agree with Gillespie for the same reactions,
+//  with and without delays; pure diffusion on a grid must spread with variance 2 D t;
+//  and particle numbers beyond 32 bits must throw rather than wrap
+//  Statistical checks pass within 4 standard errors, with fixed seeds
+//  Prints each result and returns 1 if any check fails
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "general/Statistics.h"
+#include "Stochastic/Gillespie/DelayTime.h"
+#include "Stochastic/Gillespie/Gillespie_Stoichiometric.h"
+#include "Stochastic/Gillespie/NextSubvolume.h"
+#include "Stochastic/Stoichiometry.h"
+
+int main(int argc, const char * argv[])
+{
+  using stochastic::Stoichiometry;
+  std::size_t nr_failures = 0;
+  auto check = [&](bool good, std::string const& name, double value, double reference)
+  {
+    std::cout << (good ? "ok       : " : "mismatch : ") << name
+              << " = " << value << ", expected " << reference << "\n";
+    nr_failures += !good;
+  };
+  //  Means of two independent samples agree within 4 standard errors of their difference
+  auto agree = [](statistics::Welford const& sample_1, statistics::Welford const& sample_2)
+  {
+    double error = std::sqrt(sample_1.standard_error() * sample_1.standard_error()
+                             + sample_2.standard_error() * sample_2.standard_error());
+    return std::abs(sample_1.mean() - sample_2.mean()) <= 4. * error;
+  };
+
+  //  A + B <-> C in one subvolume of unit volume against well-mixed Gillespie,
+  //  with a reactant of each reaction tracked at several times
+  std::size_t nr_realizations = 2000;
+  std::vector<double> times{ 0.1, 0.5, 2. };
+  Stoichiometry forward{ 0.01, { { 0, 1 }, { 1, 1 } }, { { 2, 1 } } };
+  Stoichiometry backward{ 0.5, { { 2, 1 } }, { { 0, 1 }, { 1, 1 } } };
+  auto well_mixed = [&](auto delay_time, std::string const& name)
+  {
+    std::vector<statistics::Welford> subvolume(2 * times.size());
+    std::vector<statistics::Welford> gillespie(2 * times.size());
+    for (std::size_t realization = 0; realization < nr_realizations; ++realization)
+    {
+      gillespie::NextSubvolume<decltype(delay_time)> engine{
+        { 1 }, 1., { 0., 0., 0. }, { forward, backward }, delay_time };
+      engine.seed(stochastic::seed_realization(1, realization));
+      engine.set({ 100, 80, 0 }, 0.);
+      engine.observe(times, [&](std::size_t index, auto const& state)
+      {
+        subvolume[2 * index].add(state.particles(0, 0));
+        subvolume[2 * index + 1].add(state.particles(0, 2));
+      });
+
+      auto reference = gillespie::make_Gillespie_MassAction_Delay(
+        std::vector<std::size_t>{ 100, 80, 0 }, 0., delay_time, forward, backward);
+      reference.seed(stochastic::seed_realization(2, realization));
+      for (std::size_t index = 0; index < times.size(); ++index)
+      {
+        reference.advance(times[index]);
+        gillespie[2 * index].add(double(reference.particles(0)));
+        gillespie[2 * index + 1].add(double(reference.particles(2)));
+      }
+    }
+    for (std::size_t index = 0; index < times.size(); ++index)
+      for (std::size_t species = 0; species < 2; ++species)
+        check(agree(subvolume[2 * index + species], gillespie[2 * index + species]),
+              name + ", mean " + (species ? "C" : "A") + "(" + std::to_string(times[index]) + ")",
+              subvolume[2 * index + species].mean(), gillespie[2 * index + species].mean());
+  };
+  well_mixed(stochastic::DelayTime_NoDelay{}, "well mixed");
+  well_mixed(stochastic::DelayTime_Exponential<>{ 0.2 }, "well mixed, exponential delay");
+
+  //  Diffusion from the center of a 1d grid, far from the boundaries,
+  //  jumps of the spacing h at rate 2 D / h^2 give variance 2 D t
+  {
+    std::size_t nr_cells = 201;
+    std::size_t center = 100;
+    double spacing = 0.1;
+    double diffusivity = 1.;
+    double time = 1.;
+    std::uint32_t nr_particles = 10000;
+    gillespie::NextSubvolume<> engine{ { nr_cells }, spacing, { diffusivity }, {} };
+    engine.seed(3);
+    engine.set(center, 0, nr_particles);
+    engine.advance(time);
+    statistics::Welford positions;
+    for (std::size_t cell = 0; cell < nr_cells; ++cell)
+      for (std::uint32_t particle = 0; particle < engine.particles(cell, 0); ++particle)
+        positions.add((double(cell) - double(center)) * spacing);
+    double variance = 2. * diffusivity * time;
+    check(engine.total(0) == nr_particles, "diffusion, particles conserved",
+          double(engine.total(0)), double(nr_particles));
+    check(std::abs(positions.mean()) <= 4. * std::sqrt(variance / nr_particles),
+          "diffusion, mean position", positions.mean(), 0.);
+    check(std::abs(positions.variance() - variance) <= 4. * variance * std::sqrt(2. / nr_particles),
+          "diffusion, variance", positions.variance(), variance);
+  }
+
+  //  Adding past the 32-bit particle range throws and leaves the count unchanged
+  {
+    gillespie::NextSubvolume<> engine{ { 2 }, 1., { 0. }, {} };
+    engine.set(0, 0, 4000000000u);
+    bool thrown = 0;
+    try
+    {
+      engine.add(0, 0, 400000000u);
+    }
+    catch (std::overflow_error const& error)
+    {
+      thrown = 1;
+      std::cout << "           " << error.what() << "\n";
+    }
+    check(thrown && engine.particles(0, 0) == 4000000000u, "overflow throws, particles",
+          double(engine.particles(0, 0)), 4.e9);
+  }
+
+  if (nr_failures)
+  {
+    std::cout << nr_failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}
@@ -0,0 +1,3 @@
+#!/bin/bash
+make rosenbrock_check
+mv rosenbrock_check ../../bin/rosenbrock_check
@@ -0,0 +1,97 @@
+//
+//  rosenbrock_check.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Check Reaction_concentration_MassAction_Rosenbrock against known solutions:
+//  the closed form of A + B -> 0, the stiff Robertson problem, a reactant
+//  listed with coefficient zero, and a network blowing up in finite time,
+//  which must throw rather than loop
+//  Prints each result and returns 1 if any check fails
+
+#include <cmath>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "Stochastic/Reaction.h"
+#include "Stochastic/Stoichiometry.h"
+
+int main(int argc, const char * argv[])
+{
+  using Reactor = stochastic::Reaction_concentration_MassAction_Rosenbrock;
+  using stochastic::Stoichiometry;
+  std::size_t nr_failures = 0;
+  auto check = [&](bool good, std::string const& name, double value, double reference)
+  {
+    std::cout << (good ? "ok       : " : "mismatch : ") << name
+              << " = " << value << ", expected " << reference << "\n";
+    nr_failures += !good;
+  };
+  auto close = [](double value, double reference, double tolerance)
+  { return std::abs(value - reference) <= tolerance * std::abs(reference); };
+
+  //  A + B -> 0, a(t) = (a0 - b0) / (1 - (b0 / a0) exp(-k (a0 - b0) t))
+  {
+    double rate = 2.;
+    double a0 = 1.;
+    double b0 = 0.5;
+    Reactor reactor{ { Stoichiometry{ rate, { { 0, 1 }, { 1, 1 } }, {} } }, { a0, b0 } };
+    for (double time : { 0.1, 1., 10., 100. })
+    {
+      reactor.evolve(time);
+      double exact = (a0 - b0) / (1. - b0 / a0 * std::exp(-rate * (a0 - b0) * time));
+      check(close(reactor.mass(0), exact, 1.e-5), "A + B -> 0, a(" + std::to_string(time) + ")",
+            reactor.mass(0), exact);
+    }
+  }
+
+  //  Robertson problem, with rate 6e7 for 2B -> B + C under the coefficient-factorial convention
+  //  Reference values at t = 40 from Hairer and Wanner
+  {
+    Reactor reactor{ { Stoichiometry{ 0.04, { { 0, 1 } }, { { 1, 1 } } },
+                       Stoichiometry{ 1.e4, { { 1, 1 }, { 2, 1 } }, { { 0, 1 }, { 2, 1 } } },
+                       Stoichiometry{ 6.e7, { { 1, 2 } }, { { 1, 1 }, { 2, 1 } } } },
+                     { 1., 0., 0. }, 1.e-6, 1.e-12 };
+    reactor.evolve(40.);
+    std::vector<double> reference{ 0.7158270687, 9.185534764e-6, 0.2841637457 };
+    for (std::size_t type = 0; type < 3; ++type)
+      check(close(reactor.mass(type), reference[type], 1.e-4),
+            "Robertson, y" + std::to_string(type + 1) + "(40)", reactor.mass(type), reference[type]);
+    std::cout << "           Robertson steps : " << reactor.steps() << "\n";
+  }
+
+  //  A + 0 C -> B, a reactant with coefficient zero does not change the rate, a(t) = exp(-t)
+  {
+    Reactor reactor{ { Stoichiometry{ 1., { { 0, 1 }, { 2, 0 } }, { { 1, 1 } } } }, { 1., 0., 1. }, 1.e-8 };
+    reactor.evolve(5.);
+    check(close(reactor.mass(0), std::exp(-5.), 1.e-4), "A + 0 C -> B, a(5)",
+          reactor.mass(0), std::exp(-5.));
+  }
+
+  //  2A -> 3A, da/dt = a^2 blows up at t = 1
+  {
+    Reactor reactor{ { Stoichiometry{ 2., { { 0, 2 } }, { { 0, 3 } } } }, std::vector<double>{ 1. } };
+    bool thrown = 0;
+    try
+    {
+      reactor.evolve(2.);
+    }
+    catch (std::runtime_error const& error)
+    {
+      thrown = 1;
+      std::cout << "           " << error.what() << "\n";
+    }
+    check(thrown && reactor.time() < 1., "2A -> 3A throws before blow-up, time", reactor.time(), 1.);
+  }
+
+  if (nr_failures)
+  {
+    std::cout << nr_failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}
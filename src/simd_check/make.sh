@@ -0,0 +1,3 @@
+#!/bin/bash
+make simd_check
+mv simd_check ../../bin/simd_check
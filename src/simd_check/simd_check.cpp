@@ -0,0 +1,278 @@
+//
+//  simd_check.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Check every build of the dispatched kernels in general/Simd.h against scalar loops
+//  Element-wise kernels must match the plain loop bit for bit, and reductions the
+//  same lane-wise sum evaluated one value at a time, on every instruction set
+//  the machine supports; prints each mismatch and returns 1 if there is any
+//  The builds are reached through the symbols GCC gives target_clones versions,
+//  so this check needs GCC on x86-64
+//  Built with the flags of the other drivers, whose default -ffp-contract=fast would let
+//  the AVX-512 build fuse products and sums; the references are compiled for the
+//  baseline instruction set, which has no FMA
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "general/Operations.h"
+#include "general/Simd.h"
+
+#if !defined(__x86_64__) || !defined(__GNUC__) || defined(__clang__)
+#error "simd_check requires GCC on x86-64"
+#endif
+
+using Reduce = double(double const*, std::size_t);
+using ReduceSize = std::size_t(std::size_t const*, std::size_t);
+using Dot = double(double const*, double const*, std::size_t);
+using Binary = void(double const*, double const*, double*, std::size_t);
+using BinaryScalar = void(double const*, double, double*, std::size_t);
+using ScalarBinary = void(double, double const*, double*, std::size_t);
+using Linear = void(double, double const*, double, double const*, double*, std::size_t);
+using LinearAxpy = void(double, double const*, double const*, double*, std::size_t);
+
+//  The target_clones builds of a kernel, by mangled name
+#define SIMD_CLONES(Type, name, mangled) \
+  extern "C" Type name##_avx512f __asm__(mangled ".avx512f"); \
+  extern "C" Type name##_avx2 __asm__(mangled ".avx2"); \
+  extern "C" Type name##_default __asm__(mangled ".default");
+
+SIMD_CLONES(Reduce, sum, "_ZN4simd3sumEPKdm")
+SIMD_CLONES(ReduceSize, sum_size, "_ZN4simd3sumEPKmm")
+SIMD_CLONES(Reduce, sum_pairwise, "_ZN4simd12sum_pairwiseEPKdm")
+SIMD_CLONES(Dot, dot, "_ZN4simd3dotEPKdS1_m")
+SIMD_CLONES(Binary, plus, "_ZN4simd4plusEPKdS1_Pdm")
+SIMD_CLONES(Binary, minus, "_ZN4simd5minusEPKdS1_Pdm")
+SIMD_CLONES(Binary, times, "_ZN4simd5timesEPKdS1_Pdm")
+SIMD_CLONES(Binary, div, "_ZN4simd3divEPKdS1_Pdm")
+SIMD_CLONES(BinaryScalar, plus_scalar, "_ZN4simd11plus_scalarEPKddPdm")
+SIMD_CLONES(BinaryScalar, minus_scalar, "_ZN4simd12minus_scalarEPKddPdm")
+SIMD_CLONES(BinaryScalar, div_scalar, "_ZN4simd10div_scalarEPKddPdm")
+SIMD_CLONES(ScalarBinary, scalar_minus, "_ZN4simd12scalar_minusEdPKdPdm")
+SIMD_CLONES(ScalarBinary, times_scalar, "_ZN4simd12times_scalarEdPKdPdm")
+SIMD_CLONES(Linear, linear, "_ZN4simd6linearEdPKddS1_Pdm")
+SIMD_CLONES(LinearAxpy, linear_axpy, "_ZN4simd6linearEdPKdS1_Pdm")
+
+//  Instruction sets supported by this machine, with the index of their build
+struct Isa
+{
+  std::string name;
+  std::size_t index;
+};
+
+std::vector<Isa> supported()
+{
+  __builtin_cpu_init();
+  std::vector<Isa> isas{ { "default", 0 } };
+  if (__builtin_cpu_supports("avx2"))
+    isas.push_back({ "avx2", 1 });
+  if (__builtin_cpu_supports("avx512f"))
+    isas.push_back({ "avx512f", 2 });
+  return isas;
+}
+
+//  Lane-wise sum of term(ii) as in simd::lanes::reduce, one value at a time
+template <typename Value, typename Term>
+Value reduce_reference(std::size_t nr_values, Term term)
+{
+  Value partial[8] = {};
+  for (std::size_t ii = 0; ii < nr_values; ++ii)
+  {
+    Value value = term(ii);
+    partial[ii % 8] = partial[ii % 8] + value;
+  }
+  return ((partial[0] + partial[1]) + (partial[2] + partial[3]))
+    + ((partial[4] + partial[5]) + (partial[6] + partial[7]));
+}
+
+//  Pairwise sum over blocks as in simd::sum_pairwise, recursively
+double sum_pairwise_reference(double const* input, std::size_t nr_blocks, std::size_t nr_values)
+{
+  if (nr_blocks == 1)
+    return reduce_reference<double>(nr_values, [input](std::size_t ii) { return input[ii]; });
+  std::size_t half = std::size_t(1);
+  while (2 * half < nr_blocks)
+    half *= 2;
+  std::size_t nr_first = half * simd::pairwise_block;
+  return sum_pairwise_reference(input, half, nr_first)
+    + sum_pairwise_reference(input + nr_first, nr_blocks - half, nr_values - nr_first);
+}
+
+bool same(double val_1, double val_2)
+{ return std::memcmp(&val_1, &val_2, sizeof(double)) == 0; }
+
+bool same(std::vector<double> const& vec_1, std::vector<double> const& vec_2)
+{
+  return vec_1.size() == vec_2.size()
+    && std::memcmp(vec_1.data(), vec_2.data(), vec_1.size() * sizeof(double)) == 0;
+}
+
+int main(int argc, const char * argv[])
+{
+  std::mt19937_64 rng{ 1 };
+  std::uniform_real_distribution<double> mantissa{ -1., 1. };
+  std::uniform_int_distribution<int> exponent{ -20, 20 };
+  std::uniform_int_distribution<std::size_t> integer{ 0, std::size_t(1) << 40 };
+  double lambda_1 = 0.1;
+  double lambda_2 = -1. / 3.;
+
+  std::vector<std::size_t> sizes;
+  for (std::size_t size = 0; size <= 70; ++size)
+    sizes.push_back(size);
+  for (std::size_t size : { 1023, 1024, 1025, 3000, 4096, 5000, 100003 })
+    sizes.push_back(size);
+
+  std::size_t nr_failures = 0;
+  auto check = [&](bool good, std::string const& kernel, Isa const& isa, std::size_t size)
+  {
+    if (good)
+      return;
+    std::cout << "mismatch : " << kernel << " [" << isa.name << "], size " << size << "\n";
+    ++nr_failures;
+  };
+
+  std::vector<Isa> isas = supported();
+  for (std::size_t size : sizes)
+  {
+    std::vector<double> input_1(size), input_2(size);
+    std::vector<std::size_t> input_size(size);
+    for (std::size_t ii = 0; ii < size; ++ii)
+    {
+      input_1[ii] = std::ldexp(mantissa(rng), exponent(rng));
+      input_2[ii] = std::ldexp(mantissa(rng), exponent(rng));
+      input_size[ii] = integer(rng);
+    }
+    double const* in_1 = input_1.data();
+    double const* in_2 = input_2.data();
+
+    //  Scalar references
+    std::vector<double> ref_plus(size), ref_minus(size), ref_times(size), ref_div(size);
+    std::vector<double> ref_plus_scalar(size), ref_minus_scalar(size), ref_div_scalar(size);
+    std::vector<double> ref_scalar_minus(size), ref_times_scalar(size);
+    std::vector<double> ref_linear(size), ref_linear_axpy(size);
+    for (std::size_t ii = 0; ii < size; ++ii)
+    {
+      ref_plus[ii] = input_1[ii] + input_2[ii];
+      ref_minus[ii] = input_1[ii] - input_2[ii];
+      ref_times[ii] = input_1[ii] * input_2[ii];
+      ref_div[ii] = input_1[ii] / input_2[ii];
+      ref_plus_scalar[ii] = input_1[ii] + lambda_1;
+      ref_minus_scalar[ii] = input_1[ii] - lambda_1;
+      ref_div_scalar[ii] = input_1[ii] / lambda_2;
+      ref_scalar_minus[ii] = lambda_1 - input_1[ii];
+      ref_times_scalar[ii] = lambda_2 * input_1[ii];
+      double product_1 = lambda_1 * input_1[ii];
+      double product_2 = lambda_2 * input_2[ii];
+      ref_linear[ii] = product_1 + product_2;
+      ref_linear_axpy[ii] = product_1 + input_2[ii];
+    }
+    double ref_sum = reduce_reference<double>(size, [in_1](std::size_t ii) { return in_1[ii]; });
+    std::size_t ref_sum_size = reduce_reference<std::size_t>(size,
+      [&input_size](std::size_t ii) { return input_size[ii]; });
+    double ref_dot = reduce_reference<double>(size,
+      [in_1, in_2](std::size_t ii) { double product = in_1[ii] * in_2[ii]; return product; });
+    std::size_t nr_blocks = (size + simd::pairwise_block - 1) / simd::pairwise_block;
+    double ref_sum_pairwise = size ? sum_pairwise_reference(in_1, nr_blocks, size) : 0.;
+
+    //  Each build, and the dispatched kernel
+    Reduce* sums[] = { sum_default, sum_avx2, sum_avx512f };
+    ReduceSize* sums_size[] = { sum_size_default, sum_size_avx2, sum_size_avx512f };
+    Reduce* sums_pairwise[] = { sum_pairwise_default, sum_pairwise_avx2, sum_pairwise_avx512f };
+    Dot* dots[] = { dot_default, dot_avx2, dot_avx512f };
+    Binary* pluses[] = { plus_default, plus_avx2, plus_avx512f };
+    Binary* minuses[] = { minus_default, minus_avx2, minus_avx512f };
+    Binary* timeses[] = { times_default, times_avx2, times_avx512f };
+    Binary* divs[] = { div_default, div_avx2, div_avx512f };
+    BinaryScalar* plus_scalars[] = { plus_scalar_default, plus_scalar_avx2, plus_scalar_avx512f };
+    BinaryScalar* minus_scalars[] = { minus_scalar_default, minus_scalar_avx2, minus_scalar_avx512f };
+    BinaryScalar* div_scalars[] = { div_scalar_default, div_scalar_avx2, div_scalar_avx512f };
+    ScalarBinary* scalar_minuses[] = { scalar_minus_default, scalar_minus_avx2, scalar_minus_avx512f };
+    ScalarBinary* times_scalars[] = { times_scalar_default, times_scalar_avx2, times_scalar_avx512f };
+    Linear* linears[] = { linear_default, linear_avx2, linear_avx512f };
+    LinearAxpy* linears_axpy[] = { linear_axpy_default, linear_axpy_avx2, linear_axpy_avx512f };
+
+    std::vector<Isa> builds = isas;
+    builds.push_back({ "dispatched", 3 });
+    for (auto const& isa : builds)
+    {
+      std::size_t ii = isa.index;
+      bool dispatched = ii == 3;
+      std::vector<double> output(size);
+      double* out = output.data();
+
+      check(same(dispatched ? simd::sum(in_1, size) : sums[ii](in_1, size), ref_sum),
+        "sum", isa, size);
+      check((dispatched ? simd::sum(input_size.data(), size) : sums_size[ii](input_size.data(), size))
+        == ref_sum_size, "sum (std::size_t)", isa, size);
+      check(same(dispatched ? simd::sum_pairwise(in_1, size) : sums_pairwise[ii](in_1, size),
+        ref_sum_pairwise), "sum_pairwise", isa, size);
+      check(same(dispatched ? simd::dot(in_1, in_2, size) : dots[ii](in_1, in_2, size), ref_dot),
+        "dot", isa, size);
+
+      dispatched ? simd::plus(in_1, in_2, out, size) : pluses[ii](in_1, in_2, out, size);
+      check(same(output, ref_plus), "plus", isa, size);
+      dispatched ? simd::minus(in_1, in_2, out, size) : minuses[ii](in_1, in_2, out, size);
+      check(same(output, ref_minus), "minus", isa, size);
+      dispatched ? simd::times(in_1, in_2, out, size) : timeses[ii](in_1, in_2, out, size);
+      check(same(output, ref_times), "times", isa, size);
+      dispatched ? simd::div(in_1, in_2, out, size) : divs[ii](in_1, in_2, out, size);
+      check(same(output, ref_div), "div", isa, size);
+      dispatched ? simd::plus_scalar(in_1, lambda_1, out, size)
+        : plus_scalars[ii](in_1, lambda_1, out, size);
+      check(same(output, ref_plus_scalar), "plus_scalar", isa, size);
+      dispatched ? simd::minus_scalar(in_1, lambda_1, out, size)
+        : minus_scalars[ii](in_1, lambda_1, out, size);
+      check(same(output, ref_minus_scalar), "minus_scalar", isa, size);
+      dispatched ? simd::div_scalar(in_1, lambda_2, out, size)
+        : div_scalars[ii](in_1, lambda_2, out, size);
+      check(same(output, ref_div_scalar), "div_scalar", isa, size);
+      dispatched ? simd::scalar_minus(lambda_1, in_1, out, size)
+        : scalar_minuses[ii](lambda_1, in_1, out, size);
+      check(same(output, ref_scalar_minus), "scalar_minus", isa, size);
+      dispatched ? simd::times_scalar(lambda_2, in_1, out, size)
+        : times_scalars[ii](lambda_2, in_1, out, size);
+      check(same(output, ref_times_scalar), "times_scalar", isa, size);
+      dispatched ? simd::linear(lambda_1, in_1, lambda_2, in_2, out, size)
+        : linears[ii](lambda_1, in_1, lambda_2, in_2, out, size);
+      check(same(output, ref_linear), "linear", isa, size);
+      dispatched ? simd::linear(lambda_1, in_1, in_2, out, size)
+        : linears_axpy[ii](lambda_1, in_1, in_2, out, size);
+      check(same(output, ref_linear_axpy), "linear (lambda*x + y)", isa, size);
+    }
+
+    //  Container front ends
+    Isa front{ "operation", 0 };
+    std::vector<double> output(size);
+    operation::linearOp(lambda_1, input_1, lambda_2, input_2, output);
+    check(same(output, ref_linear), "operation::linearOp", front, size);
+    operation::times_scalar(lambda_2, input_1, output);
+    check(same(output, ref_times_scalar), "operation::times_scalar", front, size);
+    output = input_1;
+    operation::div_scalar_InPlace(output, lambda_2);
+    check(same(output, ref_div_scalar), "operation::div_scalar_InPlace", front, size);
+    if (size >= operation::details::simd_min)
+    {
+      check(same(operation::sum(input_1), ref_sum), "operation::sum", front, size);
+      check(same(operation::dot(input_1, input_2), ref_dot), "operation::dot", front, size);
+    }
+  }
+
+  std::cout << "instruction sets :";
+  for (auto const& isa : isas)
+    std::cout << " " << isa.name;
+  std::cout << "\n";
+  if (nr_failures)
+  {
+    std::cout << nr_failures << " mismatches\n";
+    return 1;
+  }
+  std::cout << "all kernels match the scalar loops\n";
+  return 0;
+}
@@ -0,0 +1,3 @@
+#!/bin/bash
+make streamtube_check
+mv streamtube_check ../../bin/streamtube_check
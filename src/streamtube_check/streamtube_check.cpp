@@ -0,0 +1,173 @@
+//
+//  streamtube_check.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Check StreamTubeDynamics with continuous reactors: skipping the reactor once
+//  its state is absorbing must leave masses, positions and times bit for bit
+//  those of calling it in every reactive patch, for the analytical bimolecular
+//  and decay reactors, including masses small enough that only exact zeros absorb,
+//  and for the Rosenbrock mass-action reactor, which is reset by set and time
+//  at each reactive patch while keeping its step size across patches;
+//  with A + B -> C, its mobile A and immobile B must also follow the analytical
+//  A + B -> 0 streamtube along the same patches, and A + C must be conserved
+//  Prints each result and returns 1 if any check fails
+
+#include <cmath>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "general/Ranges.h"
+#include "Stochastic/Random.h"
+#include "Stochastic/Reaction.h"
+#include "Stochastic/Stoichiometry.h"
+#include "Stochastic/Streamtube/Models.h"
+#include "Stochastic/Streamtube/Patch.h"
+#include "Stochastic/Streamtube/Streamtube.h"
+
+//  Reactor with absorbing() hidden, so that StreamTubeDynamics calls it in every reactive patch
+template <typename Reactor>
+struct Reactor_unabsorbed : Reactor
+{
+  Reactor_unabsorbed(Reactor const& reactor)
+  : Reactor{ reactor }
+  {}
+
+  bool absorbing() const = delete;
+};
+
+template <typename Reactor>
+using Dynamics = streamtube::StreamTubeDynamics<
+  streamtube::PatchGenerator_alternating<streamtube::Length_exponential, streamtube::Length_exponential,
+    useful::StoreConst<std::vector<double>, std::vector<double> const&>, double>,
+  streamtube::Advection_uniform, Reactor, double>;
+
+//  Masses, positions and times at each of times, from patch lengths seeded by seed
+template <typename Reactor>
+std::vector<double> trajectory(Reactor reactor, std::vector<double> const& mobile,
+                               std::vector<double> const& immobile, double advection,
+                               std::vector<double> const& times, std::uint64_t seed)
+{
+  streamtube::Length_exponential length_reactive{ 1. };
+  streamtube::Length_exponential length_conservative{ 0.5 };
+  length_reactive.seed(stochastic::seed_realization(seed, 0, 1));
+  length_conservative.seed(stochastic::seed_realization(seed, 0, 2));
+  Dynamics<Reactor> dynamics{ { length_reactive, length_conservative, { immobile } },
+    { advection }, reactor, mobile };
+  std::vector<double> values;
+  for (double time : times)
+  {
+    dynamics.evolve_time(time);
+    for (std::size_t type = 0; type < mobile.size(); ++type)
+      values.push_back(dynamics.mass(type));
+    for (std::size_t type = 0; type < immobile.size(); ++type)
+      values.push_back(dynamics.mass_immobile(type));
+    values.push_back(dynamics.position());
+    values.push_back(dynamics.time());
+  }
+  return values;
+}
+
+int main(int argc, const char * argv[])
+{
+  using Bimolecular = stochastic::Reaction_concentration_bimolecular_analytical;
+  using Decay = stochastic::Reaction_concentration_decay_analytical;
+  std::size_t nr_failures = 0;
+  auto check = [&](bool good, std::string const& name, double value)
+  {
+    std::cout << (good ? "ok       : " : "mismatch : ") << name << " = " << value << "\n";
+    nr_failures += !good;
+  };
+  std::vector<double> times = range::logspace(0.1, 1000., 40);
+
+  //  Same trajectory with and without absorption over several streamtubes,
+  //  reporting the final mobile mass of the first
+  auto compare = [&](auto reactor, std::vector<double> const& mobile,
+                     std::vector<double> const& immobile, std::string const& name)
+  {
+    using Reactor = decltype(reactor);
+    bool same = 1;
+    double mass_final = 0.;
+    for (std::uint64_t seed = 1; seed <= 20; ++seed)
+    {
+      auto absorbed = trajectory(reactor, mobile, immobile, 1., times, seed);
+      auto full = trajectory(Reactor_unabsorbed<Reactor>{ reactor }, mobile, immobile, 1., times, seed);
+      same = same && absorbed == full;
+      if (seed == 1)
+        mass_final = absorbed[absorbed.size() - 2 - mobile.size() - immobile.size()];
+    }
+    check(same, name + ", identical with absorption, final mobile mass", mass_final);
+  };
+
+  //  Small mobile mass, which keeps decaying and must not be frozen
+  compare(Bimolecular{ 1. }, { 1.e-10 }, { 1. }, "A + B -> 0, a(0) = 1e-10");
+  //  Fast reaction, whose mobile mass underflows to zero and is absorbed
+  compare(Bimolecular{ 1.e4 }, { 0.5 }, { 1. }, "A + B -> 0, fast");
+  //  Equal masses, reacting as 1 / (1 + k t) and never absorbed
+  compare(Bimolecular{ 1. }, { 1. }, { 1. }, "A + B -> 0, equal masses");
+  compare(Decay{ 1. }, { 1.e-10 }, {}, "A -> 0, a(0) = 1e-10");
+  compare(Decay{ 1.e3 }, { 1. }, {}, "A -> 0, fast");
+
+  //  Rosenbrock A + B -> C, with mobile A and C and immobile B,
+  //  where C does not react and is carried along, so the reactor has three species
+  using Rosenbrock = stochastic::Reaction_concentration_MassAction_Rosenbrock;
+  using stochastic::Stoichiometry;
+  auto rosenbrock = [](double rate)
+  { return Rosenbrock{ { Stoichiometry{ rate, { { 0, 1 }, { 2, 1 } }, { { 1, 1 } } } }, 3, 1.e-8, 1.e-14 }; };
+  compare(rosenbrock(1.), { 1., 0. }, { 1. }, "Rosenbrock A + B -> C");
+  compare(rosenbrock(1.), { 0.5, 0. }, { 0. }, "Rosenbrock A + B -> C, b(0) = 0");
+
+  //  Against the analytical A + B -> 0 along the same patches: positions and times
+  //  are identical, and A + C = a(0) to rounding; relative errors of the masses,
+  //  down to 1e-6 of the initial mass, where the absolute tolerance takes over,
+  //  stay within 1e-4, allowing for errors of 1e-8 per step over hundreds of patches
+  auto compare_analytical = [&](double rate, double mass_mobile, double mass_immobile, std::string const& name)
+  {
+    double error_mobile = 0.;
+    double error_immobile = 0.;
+    double error_conserved = 0.;
+    bool same_walk = 1;
+    for (std::uint64_t seed = 1; seed <= 20; ++seed)
+    {
+      auto numerical = trajectory(rosenbrock(rate), { mass_mobile, 0. }, { mass_immobile }, 1., times, seed);
+      auto analytical = trajectory(Bimolecular{ rate }, { mass_mobile }, { mass_immobile }, 1., times, seed);
+      for (std::size_t index = 0; index < times.size(); ++index)
+      {
+        double const* values = &numerical[5 * index];
+        double const* reference = &analytical[4 * index];
+        error_mobile = std::max(error_mobile,
+          std::abs(values[0] - reference[0]) / (reference[0] + 1.e-6 * mass_mobile));
+        error_immobile = std::max(error_immobile,
+          std::abs(values[2] - reference[1]) / (reference[1] + 1.e-6 * mass_immobile));
+        error_conserved = std::max(error_conserved,
+          std::abs(values[0] + values[1] - mass_mobile) / mass_mobile);
+        same_walk = same_walk && values[3] == reference[2] && values[4] == reference[3];
+      }
+    }
+    check(same_walk, name + ", same positions and times as analytical", 0.);
+    check(error_mobile <= 1.e-4, name + ", relative error of A against analytical", error_mobile);
+    check(error_immobile <= 1.e-4, name + ", relative error of B against analytical", error_immobile);
+    check(error_conserved <= 1.e-10, name + ", relative change of A + C", error_conserved);
+  };
+  compare_analytical(1., 1., 1., "Rosenbrock A + B -> C, equal masses");
+  compare_analytical(2., 0.5, 1., "Rosenbrock A + B -> C, immobile excess");
+  compare_analytical(0.5, 1., 0.2, "Rosenbrock A + B -> C, mobile excess");
+
+  //  The fast mobile mass does reach zero, so the absorbing path is exercised
+  {
+    auto values = trajectory(Bimolecular{ 1.e4 }, { 0.5 }, { 1. }, 1., times, 1);
+    check(values[values.size() - 4] == 0., "A + B -> 0, fast, absorbed mobile mass",
+          values[values.size() - 4]);
+  }
+
+  if (nr_failures)
+  {
+    std::cout << nr_failures << " checks failed\n";
+    return 1;
+  }
+  std::cout << "all checks passed\n";
+  return 0;
+}
@@ -6,18 +6,465 @@
 //
 
 #include <cmath>
+#include <cstdint>
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
-#include <typeinfo>
+#include <stdexcept>
+#include <type_traits>
 #include <valarray>
-#include "general/useful.h"
+#include "general/Columnar.h"
+#include "general/Parallel.h"
+#include "general/Statistics.h"
 #include "general/Ranges.h"
+#include "general/Sweep.h"
 #include "general/useful.h"
-#include "Stochastic/Reaction.h"
+#include "Stochastic/Streamtube/Cache.h"
 #include "Stochastic/Streamtube/Models.h"
 #include "Stochastic/Streamtube/Measurer.h"
+#include "Stochastic/Streamtube/Renewal.h"
+#include "Stochastic/Streamtube/Streamtube_batch.h"
+
+//  Settings shared by all parameter sets of a run
+struct Settings
+{
+  std::string model;
+  std::string output_dir;
+  stochastic::Sampling sampling;
+  std::size_t nr_threads;
+  std::size_t format;
+  double tolerance;         // Target relative standard error, 0 to run all streamtubes
+  double budget;            // Wall-clock time budget in seconds, 0 for none
+  std::uint64_t seed;       // Base seed for common random numbers, 0 for nondeterministic seeding
+  std::size_t shard;        // Shard to run, of nr_shards
+  std::size_t nr_shards;    // Number of shards the streamtubes are split into, 1 to run all
+  bool laplace;             // Write the first-order renewal mean instead of running streamtubes
+  std::size_t laplace_nodes;  // Velocity quadrature nodes for the renewal mean
+  std::string cache;        // Directory of cached streamtubes, empty for none
+  bool verbose;
+  std::string filename_suffix;  // Appended to output filenames, to tell sweep points apart
+  sweep::Threads const* sweep_threads = nullptr;  // Shared with the other points of a sweep, if any
+
+  //  Threads to run the next wave on, growing in a sweep as other points finish
+  std::size_t nr_threads_available() const
+  { return sweep_threads ? sweep_threads->available() : nr_threads; }
+};
+
+//  Simulation for one parameter set
+struct Simulation
+{
+  static constexpr std::size_t nr_parameters = 16;
+
+  double length_reactive;
+  double alpha;
+  double beta;
+  double mean_advection;
+  double var_advection;
+  double reaction_rate;
+  double measure_min;
+  double measure_max;
+  std::size_t nr_measures;
+  double c01;
+  double c02;
+  bool flux_weighted;
+  std::size_t dist;
+  std::size_t nr_fixed_velocity;
+  std::size_t nr_velocities;
+  std::size_t run_nr;
+
+  //  Parameters in command line order
+  Simulation(std::vector<std::string> const& values)
+  {
+    if (values.size() < nr_parameters)
+      throw useful::bad_parameters();
+    std::size_t arg = 0;
+    length_reactive = atof(values[arg++].c_str());
+    alpha = atof(values[arg++].c_str());
+    beta = atof(values[arg++].c_str());
+    mean_advection = atof(values[arg++].c_str());
+    var_advection = atof(values[arg++].c_str());
+    reaction_rate = atof(values[arg++].c_str());
+    measure_min = atof(values[arg++].c_str());
+    measure_max = atof(values[arg++].c_str());
+    nr_measures = strtoul(values[arg++].c_str(), NULL, 0);
+    c01 = atof(values[arg++].c_str());
+    c02 = atof(values[arg++].c_str());
+    flux_weighted = atoi(values[arg++].c_str());
+    dist = strtoul(values[arg++].c_str(), NULL, 0);
+    nr_fixed_velocity = strtoul(values[arg++].c_str(), NULL, 0);
+    nr_velocities = strtoul(values[arg++].c_str(), NULL, 0);
+    run_nr = strtoul(values[arg++].c_str(), NULL, 0);
+    if (nr_measures == 0)
+      throw useful::bad_parameters();
+  }
+
+  //  Output times or distances
+  template <typename Model>
+  std::valarray<double> measure_points() const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    using Mean_tag = typename Model::Mean_tag;
+    //  Nondimensionalization of output times or distances
+    double mu = length_reactive/mean_advection;
+    double characteristic_val = 0.;
+    if (std::is_same<Mean_tag, streamtube::Finite_tag>::value)
+      characteristic_val = (1. + alpha)/(reaction_rate * c02);
+    if (std::is_same<Mean_tag, streamtube::Infinite_tag>::value)
+      characteristic_val = (alpha * mu)/std::pow(mu * reaction_rate * c02, 1./beta);
+    if (std::is_same<Evolution_tag, streamtube::Space_tag>::value)
+      characteristic_val *= mean_advection;
+
+    std::valarray< double > measure_points;
+    if (std::is_same<Mean_tag, streamtube::Finite_tag>::value)
+      measure_points = range::linspace< std::valarray< double > >(measure_min, measure_max, nr_measures);
+    if (std::is_same<Mean_tag, streamtube::Infinite_tag>::value)
+      measure_points = range::logspace< std::valarray< double > >(measure_min, measure_max, nr_measures);
+    measure_points *= characteristic_val;
+    return measure_points;
+  }
+
+  //  Estimated relative cost, proportional to the number of patches crossed
+  template <typename Model>
+  double cost() const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    std::valarray<double> points = measure_points<Model>();
+    double distance = points.size() ? points.max() : 0.;
+    if (std::is_same<Evolution_tag, streamtube::Time_tag>::value)
+      distance *= mean_advection;
+    double nr_patches = distance / ((1. + alpha) * length_reactive);
+    return double(nr_velocities * nr_fixed_velocity) * (nr_patches + points.size());
+  }
+
+  //  Parameters as table attributes
+  template <typename Model>
+  void attributes(columnar::Table& table, Settings const& settings) const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    table.attribute("model", Model::filename_model);
+    table.attribute("evolution", streamtube::Evolution_filename<Evolution_tag>{}.filename);
+    table.attribute("length_reactive", length_reactive);
+    table.attribute("alpha", alpha);
+    table.attribute("beta", beta);
+    table.attribute("mean_advection", mean_advection);
+    table.attribute("var_advection", var_advection);
+    table.attribute("reaction_rate", reaction_rate);
+    table.attribute("c01", c01);
+    table.attribute("c02", c02);
+    table.attribute("measure_min", measure_min);
+    table.attribute("measure_max", measure_max);
+    table.attribute("nr_measures", nr_measures);
+    table.attribute("flux_weighted", std::size_t(flux_weighted));
+    table.attribute("nr_fixed_velocity", nr_fixed_velocity);
+    table.attribute("nr_velocities", nr_velocities);
+    table.attribute("run_nr", run_nr);
+    table.attribute("seed", std::to_string(settings.seed));
+  }
+
+  //  Everything the streamtube samples depend on but the number of streamtubes
+  template <typename Model>
+  streamtube::CacheKey cache_key(Settings const& settings) const
+  {
+    streamtube::CacheKey key;
+    key.add("driver", "streamtube_concentration")
+       .add("model", Model::filename_model)
+       .add("sampling", std::size_t(settings.sampling))
+       .add("seed", settings.seed)
+       .add("length_reactive", length_reactive)
+       .add("alpha", alpha)
+       .add("beta", beta)
+       .add("mean_advection", mean_advection)
+       .add("var_advection", var_advection)
+       .add("reaction_rate", reaction_rate)
+       .add("measure_min", measure_min)
+       .add("measure_max", measure_max)
+       .add("nr_measures", nr_measures)
+       .add("c01", c01)
+       .add("c02", c02)
+       .add("flux_weighted", flux_weighted)
+       .add("dist", dist)
+       .add("nr_fixed_velocity", nr_fixed_velocity)
+       .add("run_nr", run_nr);
+    return key;
+  }
+
+  //  Mean mobile mass in the first-order limit by renewal theory,
+  //  written in place of the Monte Carlo output (see Stochastic/Streamtube/Renewal.h)
+  template <typename Model>
+  void run_laplace(Settings const& settings, std::string const& filename_params) const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    if constexpr (!streamtube::has_renewal<Model>::value)
+      throw std::invalid_argument{ "No Laplace-domain solution for streamtube model "
+        + std::string{ Model::filename_model } };
+    else
+    {
+      std::valarray<double> measure_points = this->measure_points<Model>();
+      streamtube::MeanMass_renewal<typename Model::Length_reactive, typename Model::Length_conservative>
+        renewal{ Model::make_LengthReactive(length_reactive),
+          Model::make_LengthConservative(alpha * length_reactive, beta),
+          reaction_rate, c02 };
+      std::valarray<double> mass = renewal.template mean<Evolution_tag>(measure_points,
+        streamtube::advection_rule(Model::make_AdvectionGenerator(mean_advection, var_advection),
+          settings.laplace_nodes),
+        [this](double advection)
+        { return streamtube::Species_initial<double>{ { c01 }, mean_advection }(
+            advection, flux_weighted)[0]; });
+
+      std::string filename_mass{ settings.output_dir + "/"
+        + streamtube::Measurer<Evolution_tag>::filename_base + "_laplace_"
+        + streamtube::Measurer<Evolution_tag>::filename_base + "_" + Model::filename_model + "_"
+        + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
+        + filename_params };
+      bool time = std::is_same<Evolution_tag, streamtube::Time_tag>::value;
+      if (settings.format == 1)
+      {
+        columnar::Table table;
+        attributes<Model>(table, settings);
+        table.attribute("laplace_nodes", settings.laplace_nodes);
+        table.column(time ? "time" : "distance", measure_points);
+        table.column(time ? "mass_1" : "mass", mass);
+        table.write(filename_mass + ".col");
+        return;
+      }
+      std::ofstream output_mass{ filename_mass + ".dat" };
+      if (!output_mass.is_open())
+        throw useful::open_write_error(filename_mass + ".dat");
+      output_mass << std::scientific << std::setprecision(8);
+      for (std::size_t measure = 0; measure < measure_points.size(); ++measure)
+        output_mass << measure_points[measure] << "\t" << mass[measure] << "\n";
+      output_mass.close();
+    }
+  }
+
+  template <typename Model>
+  void run(Settings const& settings) const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    using Length_reactive = typename Model::Length_reactive;
+    using Length_conservative = typename Model::Length_conservative;
+    using AdvectionGenerator = typename Model::AdvectionGenerator;
+    double tortuosity = 1.;
+    std::valarray<double> measure_points = this->measure_points<Model>();
+    std::size_t nr_measures = measure_points.size();
+
+    //  Setup dynamics
+    using MobileSpecies = streamtube::Species_initial<double>;
+    using StreamTubeBatch = streamtube::StreamTubeBatch_concentration_bimolecular
+      <Length_reactive, Length_conservative>;
+    using Evolver = streamtube::Evolver<StreamTubeBatch, Evolution_tag>;
+    AdvectionGenerator advection_generator = Model::make_AdvectionGenerator(
+      mean_advection, var_advection, nr_velocities, settings.sampling);
+
+    //  With a base seed, every random stream is keyed to run_nr and the realization
+    //  index (velocity, run) only, so that different parameter values reuse
+    //  the same random numbers (common random numbers)
+    std::uint64_t seed_run = stochastic::seed_realization(settings.seed, run_nr);
+    if (settings.seed)
+      stochastic::seed_generator(advection_generator, stochastic::seed_realization(seed_run, 0, 0));
+
+    //  Velocities, drawn up front so streamtubes can run in any order
+    std::vector<double> advections(nr_velocities);
+    for (auto& advection : advections)
+      advection = advection_generator();
+
+    //  Output files
+    std::stringstream stream;
+    stream << std::scientific << std::setprecision(2);
+    stream << length_reactive << "_"
+           << alpha << "_"
+           << beta << "_"
+           << mean_advection << "_"
+           << var_advection << "_"
+           << reaction_rate << "_"
+           << c01 << "_"
+           << c02 << "_"
+           << measure_min << "_"
+           << measure_max << "_"
+           << nr_measures << "_"
+           << flux_weighted << "_"
+           << nr_fixed_velocity << "_"
+           << nr_velocities << "_"
+           << run_nr;
+    std::string filename_params = stream.str() + settings.filename_suffix;
+    std::string shard_suffix = "_shard_" + std::to_string(settings.shard)
+      + "_of_" + std::to_string(settings.nr_shards);
+    if (settings.laplace)
+    {
+      run_laplace<Model>(settings, filename_params);
+      return;
+    }
+
+    //  Dynamics
+    //  Tasks are (velocity, run) pairs, grouped in contiguous batches
+    //  evolved together, and batches run in parallel in waves of one per thread
+    //  Each batch runs through all measure points in one task, keeping a snapshot
+    //  at each, and snapshots are collected in task order once the wave is done,
+    //  so that output does not depend on the number of threads
+    //  In shard mode, only the streamtubes of this shard are run,
+    //  and their samples are recorded to be saved for streamtube_merge
+    streamtube::Measurer<Evolution_tag> measurer{
+      measure_points, nr_fixed_velocity, nr_velocities, 1., dist };
+    std::string name_dist{ measurer.filename_base + "_dist_"
+      + measurer.filename_base + "_" + Model::filename_model + "_"
+      + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
+      + filename_params };
+    std::string filename_dist{ settings.output_dir + "/" + name_dist };
+    if (settings.nr_shards > 1)
+      measurer.record();
+    if (dist == 2)
+      measurer.stream_dist(filename_dist
+        + (settings.nr_shards > 1 ? shard_suffix : "") + ".bin");
+    //  With a cache, the cached streamtubes are loaded and only the others run,
+    //  recorded to be added to the cache (see Stochastic/Streamtube/Cache.h)
+    std::unique_ptr<streamtube::StreamtubeCache> cache;
+    std::size_t nr_cached = 0;
+    if (!settings.cache.empty())
+    {
+      if (dist == 2)
+        throw std::invalid_argument{ "The streamtube cache requires dist = 0 or 1" };
+      cache = std::make_unique<streamtube::StreamtubeCache>(settings.cache, cache_key<Model>(settings));
+      nr_cached = cache->load(measurer, advections, 0, nr_velocities);
+      measurer.record();
+    }
+    //  When stopping early, waves are smaller and hold whole streamtubes,
+    //  and the stopping rule is checked after each
+    statistics::Stopping stopping{ settings.tolerance, settings.budget };
+    std::size_t task_first = nr_velocities * settings.shard / settings.nr_shards * nr_fixed_velocity
+      + nr_cached * nr_fixed_velocity;
+    std::size_t task_last = nr_velocities * (settings.shard + 1) / settings.nr_shards * nr_fixed_velocity;
+    if (nr_cached && stopping.enabled() && stopping(measurer.statistics_mass()))
+      task_first = task_last;
+    std::size_t nr_tasks = task_last - task_first;
+    std::size_t batch_size = std::min(std::size_t(stopping.enabled() ? 128 : 1024),
+      (nr_tasks + settings.nr_threads - 1) / settings.nr_threads);
+    for (std::size_t wave_start = task_first, wave_end; wave_start < task_last; wave_start = wave_end)
+    {
+      std::size_t nr_threads = settings.nr_threads_available();
+      std::size_t wave_size = nr_threads * batch_size;
+      if (stopping.enabled())
+        wave_size = (wave_size + nr_fixed_velocity - 1) / nr_fixed_velocity * nr_fixed_velocity;
+      wave_end = std::min(wave_start + wave_size, task_last);
+      std::vector<StreamTubeBatch> batches;
+      std::vector<std::vector<std::size_t>> streamtubes;
+      for (std::size_t batch_start = wave_start; batch_start < wave_end; batch_start += batch_size)
+      {
+        std::size_t batch_end = std::min(batch_start + batch_size, wave_end);
+        std::vector<double> advections_batch;
+        std::vector<double> masses_mobile;
+        std::vector<Length_reactive> lengths_reactive;
+        std::vector<Length_conservative> lengths_conservative;
+        streamtubes.emplace_back();
+        for (std::size_t task = batch_start; task < batch_end; ++task)
+        {
+          std::size_t streamtube = task / nr_fixed_velocity;
+          streamtubes.back().push_back(streamtube);
+          advections_batch.push_back(advections[streamtube]);
+          masses_mobile.push_back(MobileSpecies{ { c01 }, mean_advection }(
+            advections[streamtube], flux_weighted)[0]);
+          if (settings.seed)
+          {
+            lengths_reactive.push_back(Model::make_LengthReactive(length_reactive));
+            lengths_conservative.push_back(
+              Model::make_LengthConservative(alpha * length_reactive, beta));
+            stochastic::seed_generator(lengths_reactive.back(),
+              stochastic::seed_realization(seed_run, task, 1));
+            stochastic::seed_generator(lengths_conservative.back(),
+              stochastic::seed_realization(seed_run, task, 2));
+          }
+        }
+        if (settings.seed)
+          batches.push_back(StreamTubeBatch{
+            lengths_reactive, lengths_conservative,
+            reaction_rate, c02, advections_batch, masses_mobile });
+        else
+          batches.push_back(StreamTubeBatch{
+            Model::make_LengthReactive(length_reactive),
+            Model::make_LengthConservative(alpha * length_reactive, beta),
+            reaction_rate, c02, advections_batch, masses_mobile });
+      }
+      if (settings.verbose)
+        for (std::size_t task = wave_start; task < wave_end; ++task)
+          if (task % nr_fixed_velocity == 0)
+            printf("velocity = %zu %.2e\n", task / nr_fixed_velocity,
+                   advections[task / nr_fixed_velocity]);
+      std::vector<std::vector<typename StreamTubeBatch::Snapshot>> snapshots(batches.size());
+      parallel::for_each_index(0, batches.size(), nr_threads,
+        [&](std::size_t batch)
+        {
+          snapshots[batch].reserve(nr_measures);
+          for (std::size_t measure = 0; measure < nr_measures; ++measure)
+          {
+            Evolver::evolve(batches[batch], measure_points[measure], tortuosity);
+            snapshots[batch].push_back(batches[batch].snapshot());
+          }
+        });
+      for (std::size_t measure = 0; measure < nr_measures; ++measure)
+        for (std::size_t batch = 0; batch < batches.size(); ++batch)
+          measurer.collect(snapshots[batch][measure], measure, streamtubes[batch]);
+      if (stopping.enabled() && stopping(measurer.statistics_mass()))
+        break;
+    }
+    if (settings.verbose && stopping.enabled())
+      printf("streamtubes = %zu of %zu, elapsed time = %.2f s\n",
+             measurer.nr_complete(), nr_velocities, stopping.elapsed_time());
+    if (cache)
+      cache->save(measurer, advections);
+    if (settings.verbose && cache)
+      printf("streamtubes cached = %zu, run = %zu\n", nr_cached, measurer.nr_complete() - nr_cached);
+
+    //  Output
+    std::string name_mass{ measurer.filename_base + "_concentration_"
+      + measurer.filename_base + "_" + Model::filename_model + "_"
+      + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
+      + filename_params };
+    std::string filename_mass{ settings.output_dir + "/" + name_mass };
+    if (settings.format == 1 || settings.nr_shards > 1)
+    {
+      columnar::Table table;
+      attributes<Model>(table, settings);
+      table.attribute("nr_streamtubes_complete", measurer.nr_complete());
+      if (settings.nr_shards > 1)
+      {
+        table.attribute("shard_index", settings.shard);
+        table.attribute("shard_nr_shards", settings.nr_shards);
+        table.attribute("shard_format", settings.format);
+        table.attribute("shard_filename_mass", name_mass);
+        table.attribute("shard_filename_dist", dist == 2 ? "" : name_dist);
+        table.attribute("shard_filename_dist_bin",
+          dist == 2 ? name_dist + shard_suffix + ".bin" : "");
+        measurer.save(table);
+        table.write(filename_mass + shard_suffix + ".col");
+        return;
+      }
+      measurer.normalize();
+      measurer.columns(table);
+      table.write(filename_mass + ".col");
+      return;
+    }
+
+    measurer.normalize();
+
+    std::ofstream output_mass{ filename_mass + ".dat" };
+    if (!output_mass.is_open())
+      throw useful::open_write_error(filename_mass + ".dat");
+    output_mass << std::scientific << std::setprecision(8);
+    if (dist == 2)
+      measurer(output_mass);
+    else
+    {
+      std::ofstream output_dist{ filename_dist + ".dat" };
+      if (!output_dist.is_open())
+        throw useful::open_write_error(filename_dist + ".dat");
+      output_dist << std::scientific << std::setprecision(8);
+      measurer(output_mass, output_dist);
+      output_dist.close();
+    }
+    output_mass.close();
+  }
+};
 
 int main(int argc, const char * argv[])
 {
@@ -40,141 +487,130 @@ int main(int argc, const char * argv[])
               << "                1 - Flux-weighted injection\n"
               << "dist : 0 - Measure average mass only\n"
               << "       1 - Measure average mass and mass distribution across particles\n"
+              << "       2 - As 1, streaming the distribution to a binary file\n"
               << "nr_fixed_velocity : Number of streamtubes for each velocity value\n"
               << "nr_velocities : Number of separate velocity samples\n"
               << "run_nr : Tag to record same-parameter realizations to different files\n"
-              << "output_dir : Directory to output to [../output]";
+              << "output_dir : Directory to output to [../output]\n"
+              << "Sweep mode: streamtube_concentration [output_dir] sweep=<file> [options]\n"
+              << "  runs all parameter sets in file (see general/Sweep.h),\n"
+              << "  longest first, each on one thread, with the last to finish\n"
+              << "  using the threads of the others; output filenames end in\n"
+              << "  _point_<index>, the index of the parameter set in file\n"
+              << "Options (name=value, after all parameters):\n"
+              << "sampling : Velocity sampling [0]\n"
+              << "           0 - Independent\n"
+              << "           1 - Stratified\n"
+              << "           2 - Latin hypercube\n"
+              << "           3 - Scrambled Sobol\n"
+              << "           Standard errors (_se) are i.i.d. estimates, which overstate\n"
+              << "           the error of stratified, Latin hypercube and Sobol sampling\n"
+              << "model : Streamtube model [uniform_exp_exp], one of\n"
+              << "        uniform_exp_exp, uniform_exp_power, uniform_uniform_uniform,\n"
+              << "        gamma_exp_exp, gamma_exp_power\n"
+              << "threads : Number of threads, 0 for all available [0]\n"
+              << "sweep : File of parameter sets to run in sweep mode\n"
+              << "tolerance : Stop adding streamtubes once the mobile mass at every\n"
+              << "            measure has this relative standard error, 0 for off [0]\n"
+              << "budget : Stop adding streamtubes after this wall-clock time in seconds,\n"
+              << "         0 for off [0]\n"
+              << "         tolerance and budget require sampling = 0 or 2\n"
+              << "seed : Base seed, 0 for nondeterministic seeding [0]; otherwise\n"
+              << "       random numbers depend only on seed, run_nr and the realization,\n"
+              << "       so runs with different parameters use common random numbers\n"
+              << "nr_shards : Split the streamtubes into this many shards [1]\n"
+              << "shard : Shard to run, from 0 to nr_shards - 1 [0]; each shard\n"
+              << "        writes a _shard_<shard>_of_<nr_shards>.col file, and\n"
+              << "        streamtube_merge combines them into the output of a single run,\n"
+              << "        identical to it; requires seed, tolerance = 0 and budget = 0\n"
+              << "laplace : 1 - Write the mean mobile mass in the first-order limit\n"
+              << "              (immobile species in excess) by numerical Laplace inversion\n"
+              << "              instead of running streamtubes, to a _laplace_ file [0];\n"
+              << "              for models with exponential or stable patch lengths\n"
+              << "laplace_nodes : Velocity quadrature nodes for laplace = 1 [64]\n"
+              << "cache : Directory of cached streamtubes, none if empty [];\n"
+              << "        requires seed, nr_shards = 1 and dist = 0 or 1; reruns load\n"
+              << "        the streamtubes cached by the same build for the same parameters\n"
+              << "        and seed, whatever nr_velocities, and only run the others\n"
+              << "format : Output format [0]\n"
+              << "         0 - Text\n"
+              << "         1 - Columnar binary (.col), with distributions for dist = 1";
     return 0;
   }
-  
-  if (argc != 17 && argc != 18)
+
+  //  Parameters, output directory, and options
+  std::size_t arg = 1;
+  std::vector<std::string> values;
+  while (arg < std::size_t(argc) && !useful::is_option(argv[arg]))
+    values.push_back(argv[arg++]);
+  useful::Options options = useful::parse_options(argc, argv, arg);
+  std::string filename_sweep = useful::option<std::string>(options, "sweep", "");
+  std::size_t nr_positional = filename_sweep.empty() ? Simulation::nr_parameters : 0;
+  if (values.size() < nr_positional)
     throw useful::bad_parameters();
 
-	using namespace streamtube::model_uniform_exp_exp;
+  Settings settings{
+    useful::option<std::string>(options, "model", "uniform_exp_exp"),
+    values.size() > nr_positional ? values[nr_positional] : "../output",
+    stochastic::make_Sampling(useful::option<std::size_t>(options, "sampling", 0)),
+    parallel::nr_threads(useful::option<std::size_t>(options, "threads", 0)),
+    useful::option<std::size_t>(options, "format", 0),
+    useful::option<double>(options, "tolerance", 0.),
+    useful::option<double>(options, "budget", 0.),
+    useful::option<std::uint64_t>(options, "seed", 0),
+    useful::option<std::size_t>(options, "shard", 0),
+    useful::option<std::size_t>(options, "nr_shards", 1),
+    useful::option<bool>(options, "laplace", 0),
+    useful::option<std::size_t>(options, "laplace_nodes", 64),
+    useful::option<std::string>(options, "cache", ""),
+    1,
+    "" };
+  if (settings.nr_shards == 0 || settings.shard >= settings.nr_shards || settings.laplace_nodes == 0)
+    throw useful::bad_parameters();
+  if (!settings.cache.empty() && (settings.seed == 0 || settings.nr_shards > 1))
+    throw std::invalid_argument{ "The streamtube cache requires seed and nr_shards = 1" };
+  //  Without a seed each shard draws its own velocities, and when stopping early
+  //  each shard stops on its own, so merged shards would not make up a single run
+  if (settings.nr_shards > 1
+      && (settings.seed == 0 || settings.tolerance > 0. || settings.budget > 0.))
+    throw std::invalid_argument{ "Shards require seed, tolerance = 0 and budget = 0" };
+  //  Stratified sampling visits velocity quantiles in increasing order, so stopping
+  //  early would keep only the low quantiles, and partial rounds of Sobol points
+  //  are balanced only at powers of two
+  if ((settings.tolerance > 0. || settings.budget > 0.)
+      && settings.sampling != stochastic::Sampling::iid
+      && settings.sampling != stochastic::Sampling::latin_hypercube)
+    throw std::invalid_argument{ "Stopping early requires independent or Latin hypercube sampling" };
 
-  //  Parameters
-  std::size_t arg = 1;
-  double length_reactive = atof(argv[arg++]);
-  double alpha = atof(argv[arg++]);
-  double beta = atof(argv[arg++]);
-  double mean_advection = atof(argv[arg++]);
-  double var_advection = atof(argv[arg++]);
-  double reaction_rate = atof(argv[arg++]);
-  double measure_min = atof(argv[arg++]);
-  double measure_max = atof(argv[arg++]);
-  std::size_t nr_measures = strtoul(argv[arg++], NULL, 0);
-  double c01 = atof(argv[arg++]);
-  double c02 = atof(argv[arg++]);
-  bool flux_weighted = atoi(argv[arg++]);
-  bool dist = atoi(argv[arg++]);
-  std::size_t nr_fixed_velocity = strtoul(argv[arg++], NULL, 0);
-  std::size_t nr_velocities = strtoul(argv[arg++], NULL, 0);
-  std::size_t run_nr = strtoul(argv[arg++], NULL, 0);
-  std::string output_dir = argc > arg ? argv[arg++] : "../output";
-  
-  double tortuosity = 1.;
-
-  //  Nondimensionalization of output times or distances
-  double mu = length_reactive/mean_advection;
-  double characteristic_val = 0.;
-  if (typeid(Mean_tag) == typeid(streamtube::Finite_tag))
-    characteristic_val = (1. + alpha)/(reaction_rate * c02);
-  if (typeid(Mean_tag) == typeid(streamtube::Infinite_tag))
-    characteristic_val = (alpha * mu)/std::pow(mu * reaction_rate * c02, 1./beta);
-  if (typeid(Evolution_tag) == typeid(streamtube::Space_tag))
-    characteristic_val *= mean_advection;
+  if (filename_sweep.empty())
+  {
+    streamtube::with_model(settings.model, [&](auto model)
+    { Simulation{ values }.run<decltype(model)>(settings); });
+    return 0;
+  }
 
-  //  Output times or distances
-  std::valarray< double > measure_points;
-  if (typeid(Mean_tag) == typeid(streamtube::Finite_tag))
-    measure_points = range::linspace< std::valarray< double > >(measure_min, measure_max, nr_measures);
-  if (typeid(Mean_tag) == typeid(streamtube::Infinite_tag))
-    measure_points = range::logspace< std::valarray< double > >(measure_min, measure_max, nr_measures);
-  measure_points *= characteristic_val;
-  nr_measures = measure_points.size();
-
-  //  Setup dynamics
-  using Mass = double;
-  using ImmobileSpecies = useful::StoreConst<std::vector<Mass>, std::vector<Mass> const&>;
-  using MobileSpecies = streamtube::Species_initial<Mass>;
-  using PatchGenerator = streamtube::PatchGenerator_alternating
-    <Length_reactive, Length_conservative, ImmobileSpecies, Mass>;
-  using Reactor = stochastic::Reaction_concentration_bimolecular_analytical;
-  using StreamTubeDynamics = streamtube::StreamTubeDynamics
-    <PatchGenerator, Advection, Reactor, Mass>;
-  using Evolver = streamtube::Evolver<StreamTubeDynamics, Evolution_tag>;
-  AdvectionGenerator advection_generator = make_AdvectionGenerator(mean_advection, var_advection);
-
-  //  Dynamics
-  streamtube::Measurer<Evolution_tag> measurer{
-    measure_points, nr_fixed_velocity, nr_velocities, 1., dist };
-  for (std::size_t streamtube = 0; streamtube < nr_velocities; ++streamtube)
+  //  Sweep: parameter sets run concurrently, each on one thread,
+  //  and those still running once none is left to start share the threads of the others
+  std::vector<Simulation> simulations;
+  std::vector<double> costs;
+  for (auto const& point : sweep::load(filename_sweep, Simulation::nr_parameters))
   {
-    Advection advection{ advection_generator() };
-    printf("velocity = %zu %.2e\n", streamtube, advection());
-    for (std::size_t run = 0; run < nr_fixed_velocity; ++run)
-    {
-      printf("\trun = %zu\n", run);
-      StreamTubeDynamics streamtube_dynamics{
-        { make_LengthReactive(length_reactive),
-          make_LengthConservative(alpha * length_reactive, beta),
-          { { c02 } } },
-        advection,
-        { reaction_rate },
-        MobileSpecies{ { c01 }, mean_advection }(advection(), flux_weighted) };
-      for (std::size_t measure = 0; measure < measure_points.size(); ++measure)
-      {
-        Evolver::evolve(streamtube_dynamics, measure_points[measure], tortuosity);
-        measurer.collect(streamtube_dynamics, measure, streamtube);
-      }
-    }
+    simulations.emplace_back(point);
+    streamtube::with_model(settings.model, [&](auto model)
+    { costs.push_back(simulations.back().cost<decltype(model)>()); });
   }
+  Settings settings_point = settings;
+  settings_point.nr_threads = 1;
+  settings_point.verbose = 0;
+  std::size_t nr_failed = sweep::run(costs, settings.nr_threads,
+    [&](std::size_t point, sweep::Threads const& threads)
+    {
+      Settings settings_indexed = settings_point;
+      settings_indexed.filename_suffix = sweep::filename_suffix(point);
+      settings_indexed.sweep_threads = &threads;
+      streamtube::with_model(settings.model, [&](auto model)
+      { simulations[point].run<decltype(model)>(settings_indexed); });
+    });
 
-  //  Output
-  std::stringstream stream;
-  stream << std::scientific << std::setprecision(2);
-  stream << length_reactive << "_"
-         << alpha << "_"
-         << beta << "_"
-         << mean_advection << "_"
-         << var_advection << "_"
-         << reaction_rate << "_"
-         << c01 << "_"
-         << c02 << "_"
-         << measure_min << "_"
-         << measure_max << "_"
-         << nr_measures << "_"
-         << flux_weighted << "_"
-         << nr_fixed_velocity << "_"
-         << nr_velocities << "_"
-         << run_nr;
-  std::string filename_params = stream.str();
-  
-  std::string filename_mass{ output_dir + "/" +
-    measurer.filename_base + "_concentration_"
-    + measurer.filename_base + "_" + filename_model + "_"
-    + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
-    + filename_params + ".dat" };
-  std::ofstream output_mass{ filename_mass };
-  if (!output_mass.is_open())
-    throw useful::open_write_error(filename_mass);
-  output_mass << std::scientific << std::setprecision(8);
-  
-  std::string filename_dist{ output_dir + "/" +
-    measurer.filename_base + "_dist_"
-    + measurer.filename_base + "_" + filename_model + "_"
-    + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
-    + filename_params + ".dat" };
-  std::ofstream output_dist{ filename_dist };
-  if (!output_dist.is_open())
-    throw useful::open_write_error(filename_mass);
-  output_dist << std::scientific << std::setprecision(8);
-    
-  measurer.normalize();
-  measurer(output_mass, output_dist);
-  output_mass.close();
-  output_dist.close();
-  
-  return 0;
+  return nr_failed ? 1 : 0;
 }
-
@@ -8,17 +8,403 @@
 #include <fstream>
 #include <iostream>
 #include <iomanip>
+#include <memory>
 #include <sstream>
+#include <stdexcept>
 #include <string>
-#include <typeinfo>
+#include <type_traits>
+#include "general/Columnar.h"
+#include "general/Parallel.h"
+#include "general/Statistics.h"
 #include "general/Ranges.h"
+#include "general/Sweep.h"
 #include "general/useful.h"
 #include "Stochastic/Gillespie/Gillespie_Stoichiometric.h"
 #include "Stochastic/Reaction.h"
 #include "Stochastic/Stoichiometry.h"
+#include "Stochastic/Streamtube/Cache.h"
 #include "Stochastic/Streamtube/Models.h"
 #include "Stochastic/Streamtube/Measurer.h"
 
+//  Settings shared by all parameter sets of a run
+struct Settings
+{
+  std::string model;
+  std::string output_dir;
+  stochastic::Sampling sampling;
+  std::size_t nr_threads;
+  std::size_t format;
+  double tolerance;         // Target relative standard error, 0 to run all streamtubes
+  double budget;            // Wall-clock time budget in seconds, 0 for none
+  std::uint64_t seed;       // Base seed for common random numbers, 0 for nondeterministic seeding
+  std::size_t shard;        // Shard to run, of nr_shards
+  std::size_t nr_shards;    // Number of shards the streamtubes are split into, 1 to run all
+  std::string cache;        // Directory of cached streamtubes, empty for none
+  bool verbose;
+  std::string filename_suffix;  // Appended to output filenames, to tell sweep points apart
+  sweep::Threads const* sweep_threads = nullptr;  // Shared with the other points of a sweep, if any
+
+  //  Threads to run the next wave on, growing in a sweep as other points finish
+  std::size_t nr_threads_available() const
+  { return sweep_threads ? sweep_threads->available() : nr_threads; }
+};
+
+//  Simulation for one parameter set
+struct Simulation
+{
+  static constexpr std::size_t nr_parameters = 16;
+
+  double characteristic_length_reactive;
+  double exp_length_reactive;
+  double characteristic_length_conservative;
+  double exp_length_conservative;
+  double mean_advection;
+  double var_advection;
+  double reaction_rate;
+  double measure_min;
+  double measure_max;
+  std::size_t nr_measures;
+  bool flux_weighted;
+  std::size_t particles_mobile_each;
+  std::size_t particles_immobile_each;
+  std::size_t nr_fixed_velocity;
+  std::size_t nr_velocities;
+  std::size_t run_nr;
+
+  //  Parameters in command line order
+  Simulation(std::vector<std::string> const& values)
+  {
+    if (values.size() < nr_parameters)
+      throw useful::bad_parameters();
+    std::size_t arg = 0;
+    characteristic_length_reactive = atof(values[arg++].c_str());
+    exp_length_reactive = atof(values[arg++].c_str());
+    characteristic_length_conservative = atof(values[arg++].c_str());
+    exp_length_conservative = atof(values[arg++].c_str());
+    mean_advection = atof(values[arg++].c_str());
+    var_advection = atof(values[arg++].c_str());
+    reaction_rate = atof(values[arg++].c_str());
+    measure_min = atof(values[arg++].c_str());
+    measure_max = atof(values[arg++].c_str());
+    nr_measures = strtoul(values[arg++].c_str(), NULL, 0);
+    flux_weighted = atoi(values[arg++].c_str());
+    particles_mobile_each = strtoul(values[arg++].c_str(), NULL, 0);
+    particles_immobile_each = strtoul(values[arg++].c_str(), NULL, 0);
+    nr_fixed_velocity = strtoul(values[arg++].c_str(), NULL, 0);
+    nr_velocities = strtoul(values[arg++].c_str(), NULL, 0);
+    run_nr = strtoul(values[arg++].c_str(), NULL, 0);
+    if (nr_measures == 0)
+      throw useful::bad_parameters();
+  }
+
+  //  Average initial number of particles over the mobile and immobile species
+  double particles_characteristic() const
+  { return (particles_mobile_each + particles_immobile_each) / 2.; }
+
+  //  Output times or distances
+  template <typename Model>
+  std::valarray<double> measure_points() const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    using Mean_tag = typename Model::Mean_tag;
+    double particles_characteristic = this->particles_characteristic();
+    //  Normalization of measure times or distances
+    double alpha =
+      characteristic_length_conservative/characteristic_length_reactive;
+    double mu = characteristic_length_reactive / mean_advection;
+    double characteristic_val = 0.;
+    if (std::is_same<Mean_tag, streamtube::Finite_tag>::value)
+      characteristic_val = (1.+alpha)/reaction_rate*particles_characteristic
+        /particles_immobile_each;
+    if (std::is_same<Mean_tag, streamtube::Infinite_tag>::value)
+      characteristic_val = alpha * mu;
+    if (std::is_same<Evolution_tag, streamtube::Space_tag>::value)
+      characteristic_val *= mean_advection;
+
+    //  Measure times or distances
+    std::valarray<double> measure_points;
+    if (std::is_same<Mean_tag, streamtube::Finite_tag>::value)
+      measure_points =
+        range::linspace<std::valarray<double>>(measure_min, measure_max, nr_measures);
+    if (std::is_same<Mean_tag, streamtube::Infinite_tag>::value)
+      measure_points =
+        range::logspace<std::valarray<double>>(measure_min, measure_max, nr_measures);
+    measure_points *= characteristic_val;
+    return measure_points;
+  }
+
+  //  Estimated relative cost, proportional to the number of patches crossed
+  //  times the number of particles that may react in each
+  template <typename Model>
+  double cost() const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    std::valarray<double> points = measure_points<Model>();
+    double distance = points.size() ? points.max() : 0.;
+    if (std::is_same<Evolution_tag, streamtube::Time_tag>::value)
+      distance *= mean_advection;
+    double nr_patches = distance
+      / (characteristic_length_reactive + characteristic_length_conservative);
+    return double(nr_velocities * nr_fixed_velocity)
+      * (nr_patches * particles_characteristic() + points.size());
+  }
+
+  //  Everything the streamtube samples depend on but the number of streamtubes
+  template <typename Model>
+  streamtube::CacheKey cache_key(Settings const& settings) const
+  {
+    streamtube::CacheKey key;
+    key.add("driver", "streamtube_gillespie")
+       .add("model", Model::filename_model)
+       .add("sampling", std::size_t(settings.sampling))
+       .add("seed", settings.seed)
+       .add("characteristic_length_reactive", characteristic_length_reactive)
+       .add("exp_length_reactive", exp_length_reactive)
+       .add("characteristic_length_conservative", characteristic_length_conservative)
+       .add("exp_length_conservative", exp_length_conservative)
+       .add("mean_advection", mean_advection)
+       .add("var_advection", var_advection)
+       .add("reaction_rate", reaction_rate)
+       .add("measure_min", measure_min)
+       .add("measure_max", measure_max)
+       .add("nr_measures", nr_measures)
+       .add("flux_weighted", flux_weighted)
+       .add("particles_mobile_each", particles_mobile_each)
+       .add("particles_immobile_each", particles_immobile_each)
+       .add("nr_fixed_velocity", nr_fixed_velocity)
+       .add("run_nr", run_nr);
+    return key;
+  }
+
+  template <typename Model>
+  void run(Settings const& settings) const
+  {
+    using Evolution_tag = typename Model::Evolution_tag;
+    using Advection = typename Model::Advection;
+    using Length_reactive = typename Model::Length_reactive;
+    using Length_conservative = typename Model::Length_conservative;
+    using AdvectionGenerator = typename Model::AdvectionGenerator;
+    double tortuosity = 1.;
+
+    std::vector< std::size_t > average_initial_mobile_particles{ particles_mobile_each };
+    std::vector< std::size_t > average_initial_immobile_particles{ particles_immobile_each };
+    std::size_t types = average_initial_mobile_particles.size()
+      + average_initial_immobile_particles.size();
+    double particles_characteristic = this->particles_characteristic();
+  
+    using Stoichiometry = stochastic::Stoichiometry;
+    // A+B\to\varnothing
+    Stoichiometry stoichiometry{
+      reaction_rate/particles_characteristic,
+      { { 0, 1 }, { 1, 1 } }, {} };
+
+    std::valarray<double> measure_points = this->measure_points<Model>();
+
+    // Setup dynamics
+    using Mass = std::size_t;
+    using ImmobileSpecies =
+      useful::StoreConst<std::vector<Mass>, std::vector<Mass> const&>;
+    using MobileSpecies = streamtube::Species_initial<Mass>;
+    using PatchGenerator = streamtube::PatchGenerator_alternating
+      <Length_reactive, Length_conservative, ImmobileSpecies, Mass>;
+    using Reactor = decltype(gillespie::make_Gillespie_MassAction<streamtube::Engine>(
+      std::vector<std::size_t>(types), 0., stoichiometry));
+    using StreamTubeDynamics =
+      streamtube::StreamTubeDynamics<PatchGenerator, Advection, Reactor, Mass>;
+    using Evolver = streamtube::Evolver<StreamTubeDynamics, Evolution_tag>;
+    AdvectionGenerator advection_generator =
+      Model::make_AdvectionGenerator(mean_advection, var_advection,
+                              nr_velocities, settings.sampling);
+
+    //  With a base seed, every random stream is keyed to run_nr and the realization
+    //  index (velocity, run) only, so that different parameter values reuse
+    //  the same random numbers (common random numbers)
+    std::uint64_t seed_run = stochastic::seed_realization(settings.seed, run_nr);
+    if (settings.seed)
+      stochastic::seed_generator(advection_generator, stochastic::seed_realization(seed_run, 0, 0));
+
+    //  Velocities, drawn up front so streamtubes can run in any order
+    std::vector<double> advections(nr_velocities);
+    for (auto& advection : advections)
+      advection = advection_generator();
+
+    //  Dynamics
+    streamtube::Measurer<Evolution_tag> measurer{
+      measure_points, nr_fixed_velocity, nr_velocities,
+      particles_characteristic };
+    //  In shard mode, only the streamtubes of this shard are run,
+    //  and their samples are recorded to be saved for streamtube_merge
+    if (settings.nr_shards > 1)
+      measurer.record();
+    //  With a cache, the cached streamtubes are loaded and only the others run,
+    //  recorded to be added to the cache (see Stochastic/Streamtube/Cache.h)
+    std::unique_ptr<streamtube::StreamtubeCache> cache;
+    std::size_t nr_cached = 0;
+    if (!settings.cache.empty())
+    {
+      cache = std::make_unique<streamtube::StreamtubeCache>(settings.cache, cache_key<Model>(settings));
+      nr_cached = cache->load(measurer, advections, 0, nr_velocities);
+      measurer.record();
+    }
+    //  Run each ensemble
+    //  Tasks are (velocity, run) pairs, run in parallel in waves of wave_size
+    //  Each task records its state at all measure points,
+    //  which is then collected in task order, so that output does not
+    //  depend on the number of threads
+    using Snapshot = streamtube::StreamTubeSnapshot<Mass>;
+    //  When stopping early, waves hold whole streamtubes,
+    //  and the stopping rule is checked after each
+    statistics::Stopping stopping{ settings.tolerance, settings.budget };
+    std::size_t task_first = nr_velocities * settings.shard / settings.nr_shards * nr_fixed_velocity
+      + nr_cached * nr_fixed_velocity;
+    std::size_t task_last = nr_velocities * (settings.shard + 1) / settings.nr_shards * nr_fixed_velocity;
+    if (nr_cached && stopping.enabled() && stopping(measurer.statistics_mass()))
+      task_first = task_last;
+    std::size_t nr_tasks = task_last - task_first;
+    std::size_t wave_size = std::min(nr_tasks, std::size_t(1024));
+    if (stopping.enabled())
+      wave_size = std::max(wave_size / nr_fixed_velocity, std::size_t(1)) * nr_fixed_velocity;
+    std::vector<std::vector<Snapshot>> snapshots(
+      wave_size, std::vector<Snapshot>(measure_points.size()));
+    for (std::size_t wave_start = task_first; wave_start < task_last; wave_start += wave_size)
+    {
+      std::size_t wave_end = std::min(wave_start + wave_size, task_last);
+      parallel::for_each_index(wave_start, wave_end, settings.nr_threads_available(),
+        [&](std::size_t task)
+        {
+          Advection advection{ advections[task / nr_fixed_velocity] };
+          Length_reactive length_reactive = Model::make_LengthReactive(
+            characteristic_length_reactive, exp_length_reactive);
+          Length_conservative length_conservative = Model::make_LengthConservative(
+            characteristic_length_conservative, exp_length_conservative);
+          Reactor reactor = gillespie::make_Gillespie_MassAction<streamtube::Engine>(
+            std::vector<std::size_t>(types), 0., stoichiometry);
+          if (settings.seed)
+          {
+            stochastic::seed_generator(length_reactive,
+              stochastic::seed_realization(seed_run, task, 1));
+            stochastic::seed_generator(length_conservative,
+              stochastic::seed_realization(seed_run, task, 2));
+            reactor.seed(stochastic::seed_realization(seed_run, task, 3));
+          }
+          StreamTubeDynamics streamtube_dynamics{
+            { length_reactive, length_conservative,
+              { average_initial_immobile_particles } },
+            advection,
+            reactor,
+            MobileSpecies{ average_initial_mobile_particles,
+              mean_advection }(advection(), flux_weighted) };
+          for (std::size_t measure = 0; measure < measure_points.size(); ++measure)
+          {
+            Evolver::evolve(streamtube_dynamics,
+                            measure_points[measure], tortuosity);
+            snapshots[task - wave_start][measure] = Snapshot{ streamtube_dynamics };
+          }
+        });
+      //  Multiple ensembles for each velocity
+      for (std::size_t task = wave_start; task < wave_end; ++task)
+      {
+        std::size_t streamtube = task / nr_fixed_velocity;
+        std::size_t run_index = task % nr_fixed_velocity;
+        if (settings.verbose)
+        {
+          if (run_index == 0)
+            std::cout << "velocity = " << streamtube << "\n";
+          std::cout << "\trun = " << run_index << "\n";
+        }
+        for (std::size_t measure = 0; measure < measure_points.size(); ++measure)
+          measurer.collect(snapshots[task - wave_start][measure], measure, streamtube);
+      }
+      if (stopping.enabled() && stopping(measurer.statistics_mass()))
+        break;
+    }
+    if (settings.verbose && stopping.enabled())
+      std::cout << "streamtubes = " << measurer.nr_complete() << " of " << nr_velocities
+                << ", elapsed time = " << stopping.elapsed_time() << " s\n";
+    if (cache)
+      cache->save(measurer, advections);
+    if (settings.verbose && cache)
+      std::cout << "streamtubes cached = " << nr_cached
+                << ", run = " << measurer.nr_complete() - nr_cached << "\n";
+
+    //  Output
+    std::stringstream stream;
+    stream << std::scientific << std::setprecision(2);
+    stream << characteristic_length_reactive << "_"
+           << exp_length_reactive << "_"
+           << characteristic_length_conservative << "_"
+           << exp_length_conservative << "_"
+           << mean_advection << "_"
+           << var_advection << "_"
+           << reaction_rate << "_"
+           << measure_min << "_"
+           << measure_max << "_"
+           << nr_measures << "_"
+           << flux_weighted << "_"
+           << particles_mobile_each << "_"
+           << particles_immobile_each << "_"
+           << nr_fixed_velocity << "_"
+           << nr_velocities << "_"
+           << run_nr;
+    std::string filename_params = stream.str() + settings.filename_suffix;
+  
+    std::string name_mass{ measurer.filename_base + "_" + Model::filename_model + "_"
+      + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
+      + filename_params };
+    std::string filename_mass{ settings.output_dir + "/" + name_mass };
+    if (settings.format == 1 || settings.nr_shards > 1)
+    {
+      columnar::Table table;
+      table.attribute("model", Model::filename_model);
+      table.attribute("evolution", streamtube::Evolution_filename<Evolution_tag>{}.filename);
+      table.attribute("characteristic_length_reactive", characteristic_length_reactive);
+      table.attribute("exp_length_reactive", exp_length_reactive);
+      table.attribute("characteristic_length_conservative", characteristic_length_conservative);
+      table.attribute("exp_length_conservative", exp_length_conservative);
+      table.attribute("mean_advection", mean_advection);
+      table.attribute("var_advection", var_advection);
+      table.attribute("reaction_rate", reaction_rate);
+      table.attribute("measure_min", measure_min);
+      table.attribute("measure_max", measure_max);
+      table.attribute("nr_measures", nr_measures);
+      table.attribute("flux_weighted", std::size_t(flux_weighted));
+      table.attribute("particles_mobile_each", particles_mobile_each);
+      table.attribute("particles_immobile_each", particles_immobile_each);
+      table.attribute("nr_fixed_velocity", nr_fixed_velocity);
+      table.attribute("nr_velocities", nr_velocities);
+      table.attribute("run_nr", run_nr);
+      table.attribute("seed", std::to_string(settings.seed));
+      table.attribute("nr_streamtubes_complete", measurer.nr_complete());
+      if (settings.nr_shards > 1)
+      {
+        table.attribute("shard_index", settings.shard);
+        table.attribute("shard_nr_shards", settings.nr_shards);
+        table.attribute("shard_format", settings.format);
+        table.attribute("shard_filename_mass", name_mass);
+        table.attribute("shard_filename_dist", "");
+        table.attribute("shard_filename_dist_bin", "");
+        measurer.save(table);
+        table.write(filename_mass + "_shard_" + std::to_string(settings.shard)
+                    + "_of_" + std::to_string(settings.nr_shards) + ".col");
+        return;
+      }
+      measurer.normalize();
+      measurer.columns(table);
+      table.write(filename_mass + ".col");
+      return;
+    }
+
+    measurer.normalize();
+
+    std::ofstream output{ filename_mass + ".dat" };
+    if (!output.is_open())
+      throw useful::open_write_error(filename_mass + ".dat");
+    output << std::scientific << std::setprecision(8);
+    measurer(output);
+    output.close();
+  }
+};
+
 int main(int argc, const char* argv[])
 {
   if (argc == 0)
@@ -42,156 +428,119 @@ int main(int argc, const char* argv[])
               << "nr_fixed_velocity : Number of streamtubes for each velocity value\n"
               << "nr_velocities : Number of separate velocity samples\n"
               << "run_nr : Tag to record same-parameter realizations to different files\n"
-              << "output_dir : Directory to output to [../output]";
+              << "output_dir : Directory to output to [../output]\n"
+              << "Sweep mode: streamtube_gillespie [output_dir] sweep=<file> [options]\n"
+              << "  runs all parameter sets in file (see general/Sweep.h),\n"
+              << "  longest first, each on one thread, with the last to finish\n"
+              << "  using the threads of the others; output filenames end in\n"
+              << "  _point_<index>, the index of the parameter set in file\n"
+              << "Options (name=value, after all parameters):\n"
+              << "sampling : Velocity sampling [0]\n"
+              << "           0 - Independent\n"
+              << "           1 - Stratified\n"
+              << "           2 - Latin hypercube\n"
+              << "           3 - Scrambled Sobol\n"
+              << "           Standard errors (_se) are i.i.d. estimates, which overstate\n"
+              << "           the error of stratified, Latin hypercube and Sobol sampling\n"
+              << "model : Streamtube model [uniform_exp_exp], one of\n"
+              << "        uniform_exp_exp, uniform_exp_power, uniform_uniform_uniform,\n"
+              << "        gamma_exp_exp, gamma_exp_power\n"
+              << "threads : Number of threads, 0 for all available [0]\n"
+              << "sweep : File of parameter sets to run in sweep mode\n"
+              << "tolerance : Stop adding streamtubes once the mobile mass at every\n"
+              << "            measure has this relative standard error, 0 for off [0]\n"
+              << "budget : Stop adding streamtubes after this wall-clock time in seconds,\n"
+              << "         0 for off [0]\n"
+              << "         tolerance and budget require sampling = 0 or 2\n"
+              << "seed : Base seed, 0 for nondeterministic seeding [0]; otherwise\n"
+              << "       random numbers depend only on seed, run_nr and the realization,\n"
+              << "       so runs with different parameters use common random numbers\n"
+              << "nr_shards : Split the streamtubes into this many shards [1]\n"
+              << "shard : Shard to run, from 0 to nr_shards - 1 [0]; each shard\n"
+              << "        writes a _shard_<shard>_of_<nr_shards>.col file, and\n"
+              << "        streamtube_merge combines them into the output of a single run,\n"
+              << "        identical to it; requires seed, tolerance = 0 and budget = 0\n"
+              << "cache : Directory of cached streamtubes, none if empty [];\n"
+              << "        requires seed and nr_shards = 1; reruns load the streamtubes\n"
+              << "        cached by the same build for the same parameters and seed,\n"
+              << "        whatever nr_velocities, and only run the others\n"
+              << "format : Output format [0]\n"
+              << "         0 - Text\n"
+              << "         1 - Columnar binary (.col)";
     return 0;
   }
-  
-  if (argc != 17 && argc != 18)
+
+  //  Parameters, output directory, and options
+  std::size_t arg = 1;
+  std::vector<std::string> values;
+  while (arg < std::size_t(argc) && !useful::is_option(argv[arg]))
+    values.push_back(argv[arg++]);
+  useful::Options options = useful::parse_options(argc, argv, arg);
+  std::string filename_sweep = useful::option<std::string>(options, "sweep", "");
+  std::size_t nr_positional = filename_sweep.empty() ? Simulation::nr_parameters : 0;
+  if (values.size() < nr_positional)
     throw useful::bad_parameters();
 
-	using namespace streamtube::model_uniform_exp_exp;
-
-  //  Parameters
-	std::size_t arg = 1;
-	double characteristic_length_reactive = atof(argv[arg++]);
-	double exp_length_reactive = atof(argv[arg++]);
-	double characteristic_length_conservative = atof(argv[arg++]);
-	double exp_length_conservative = atof(argv[arg++]);  //
-	double mean_advection = atof(argv[arg++]);
-	double var_advection = atof(argv[arg++]);
-	double reaction_rate = atof(argv[arg++]);
-	double measure_min = atof(argv[arg++]);
-	double measure_max = atof(argv[arg++]);
-	std::size_t nr_measures = strtoul(argv[arg++], NULL, 0);
-	bool flux_weighted = atoi(argv[arg++]);
-	std::size_t particles_mobile_each = strtoul(argv[arg++], NULL, 0);
-	std::size_t particles_immobile_each = strtoul(argv[arg++], NULL, 0);
-	std::size_t nr_fixed_velocity = strtoul(argv[arg++], NULL, 0);
-	std::size_t nr_velocities = strtoul(argv[arg++], NULL, 0);
-	std::size_t run_nr = strtoul(argv[arg++], NULL, 0);
-  std::string output_dir = argc > arg ? argv[arg++] : "../output";
-  
-  double tortuosity = 1.;
-
-	std::vector< std::size_t > average_initial_mobile_particles{ particles_mobile_each };
-	std::vector< std::size_t > average_initial_immobile_particles{ particles_immobile_each };
-	std::size_t mobile_types = average_initial_mobile_particles.size();
-	std::size_t immobile_types = average_initial_immobile_particles.size();
-	std::size_t types = mobile_types + immobile_types;
-	double particles_characteristic = (mobile_types*particles_mobile_each
-                                     + immobile_types*particles_immobile_each)
-                                    /double(types);
-  
-  using Stoichiometry = stochastic::Stoichiometry;
-  // A+B\to\varnothing
-  Stoichiometry stoichiometry{
-    reaction_rate/particles_characteristic,
-    { { 0, 1 }, { 1, 1 } }, {} };
-
-  //  Normalization of measure times or distances
-	double alpha =
-    characteristic_length_conservative/characteristic_length_reactive;
-	double mu = characteristic_length_reactive / mean_advection;
-	double characteristic_val = 0.;
-	if (typeid(Mean_tag) == typeid(streamtube::Finite_tag))
-		characteristic_val = (1.+alpha)/reaction_rate*particles_characteristic
-      /particles_immobile_each;
-	if (typeid(Mean_tag) == typeid(streamtube::Infinite_tag))
-		characteristic_val = alpha * mu;
-	if (typeid(Evolution_tag) == typeid(streamtube::Space_tag))
-		characteristic_val *= mean_advection;
-
-  //  Measure times or distances
-	std::valarray<double> measure_points;
-	if (typeid(Mean_tag) == typeid(streamtube::Finite_tag))
-		measure_points =
-      range::linspace<std::valarray<double>>(measure_min, measure_max, nr_measures);
-	if (typeid(Mean_tag) == typeid(streamtube::Infinite_tag))
-		measure_points =
-      range::logspace<std::valarray<double>>(measure_min, measure_max, nr_measures);
-	measure_points *= characteristic_val;
-
-  // Setup dynamics
-	using Mass = std::size_t;
-	using ImmobileSpecies =
-    useful::StoreConst<std::vector<Mass>, std::vector<Mass> const&>;
-	using MobileSpecies = streamtube::Species_initial<Mass>;
-	using PatchGenerator = streamtube::PatchGenerator_alternating
-    <Length_reactive, Length_conservative, ImmobileSpecies, Mass>;
-	using Reactor = decltype(gillespie::make_Gillespie_MassAction(
-    std::vector<std::size_t>(types), 0., stoichiometry));
-	using StreamTubeDynamics =
-    streamtube::StreamTubeDynamics<PatchGenerator, Advection, Reactor, Mass>;
-	using Evolver = streamtube::Evolver<StreamTubeDynamics, Evolution_tag>;
-	AdvectionGenerator advection_generator =
-    make_AdvectionGenerator(mean_advection, var_advection);
-
-  //  Dynamics
-	streamtube::Measurer<Evolution_tag> measurer{
-    measure_points, nr_fixed_velocity, nr_velocities,
-    particles_characteristic };
-  //  Run each ensemble
-	for (std::size_t streamtube = 0; streamtube < nr_velocities; ++streamtube)
-	{
-		std::cout << "velocity = " << streamtube << "\n";
-		Advection advection{ advection_generator() };
-    //  Multiple ensembles for each velocity
-		for (std::size_t run = 0; run < nr_fixed_velocity; ++run)
-		{
-      std::cout << "\trun = " << run << "\n";
-			StreamTubeDynamics streamtube_dynamics{
-				{ make_LengthReactive(characteristic_length_reactive,
-                              exp_length_reactive),
-					make_LengthConservative(characteristic_length_conservative,
-                                  exp_length_conservative),
-					{ average_initial_immobile_particles } },
-				advection,
-				gillespie::make_Gillespie_MassAction(std::vector<std::size_t>(types),
-                                             0., stoichiometry),
-				MobileSpecies{ average_initial_mobile_particles,
-          mean_advection }(advection(), flux_weighted) };
-			for (std::size_t measure = 0; measure < measure_points.size(); ++measure)
-			{
-				Evolver::evolve(streamtube_dynamics,
-                        measure_points[measure], tortuosity);
-				measurer.collect(streamtube_dynamics,
-                         measure, run + streamtube * nr_fixed_velocity);
-			}
-		}
-	}
-
-  //  Output
-  std::stringstream stream;
-  stream << std::scientific << std::setprecision(2);
-	stream << characteristic_length_reactive << "_"
-         << exp_length_reactive << "_"
-         << characteristic_length_conservative << "_"
-         << exp_length_conservative << "_"
-         << mean_advection << "_"
-         << var_advection << "_"
-         << reaction_rate << "_"
-         << measure_min << "_"
-         << measure_max << "_"
-         << nr_measures << "_"
-         << flux_weighted << "_"
-         << particles_mobile_each << "_"
-         << particles_immobile_each << "_"
-         << nr_fixed_velocity << "_"
-         << nr_velocities << "_"
-         << run_nr;
-  std::string filename_params = stream.str();
-  
-  std::string filename_mass{ output_dir + "/" +
-    measurer.filename_base + "_" + filename_model + "_"
-    + streamtube::Evolution_filename<Evolution_tag>{}.filename + "_"
-    + filename_params + ".dat"};
-  std::ofstream output{ filename_mass };
-  if (!output.is_open())
-    throw useful::open_write_error(filename_mass);
-  output << std::scientific << std::setprecision(8);
-  measurer.normalize();
-	measurer(output);
-  output.close();
-
-	return 0;
+  Settings settings{
+    useful::option<std::string>(options, "model", "uniform_exp_exp"),
+    values.size() > nr_positional ? values[nr_positional] : "../output",
+    stochastic::make_Sampling(useful::option<std::size_t>(options, "sampling", 0)),
+    parallel::nr_threads(useful::option<std::size_t>(options, "threads", 0)),
+    useful::option<std::size_t>(options, "format", 0),
+    useful::option<double>(options, "tolerance", 0.),
+    useful::option<double>(options, "budget", 0.),
+    useful::option<std::uint64_t>(options, "seed", 0),
+    useful::option<std::size_t>(options, "shard", 0),
+    useful::option<std::size_t>(options, "nr_shards", 1),
+    useful::option<std::string>(options, "cache", ""),
+    1,
+    "" };
+  if (settings.nr_shards == 0 || settings.shard >= settings.nr_shards)
+    throw useful::bad_parameters();
+  if (!settings.cache.empty() && (settings.seed == 0 || settings.nr_shards > 1))
+    throw std::invalid_argument{ "The streamtube cache requires seed and nr_shards = 1" };
+  //  Without a seed each shard draws its own velocities, and when stopping early
+  //  each shard stops on its own, so merged shards would not make up a single run
+  if (settings.nr_shards > 1
+      && (settings.seed == 0 || settings.tolerance > 0. || settings.budget > 0.))
+    throw std::invalid_argument{ "Shards require seed, tolerance = 0 and budget = 0" };
+  //  Stratified sampling visits velocity quantiles in increasing order, so stopping
+  //  early would keep only the low quantiles, and partial rounds of Sobol points
+  //  are balanced only at powers of two
+  if ((settings.tolerance > 0. || settings.budget > 0.)
+      && settings.sampling != stochastic::Sampling::iid
+      && settings.sampling != stochastic::Sampling::latin_hypercube)
+    throw std::invalid_argument{ "Stopping early requires independent or Latin hypercube sampling" };
+
+  if (filename_sweep.empty())
+  {
+    streamtube::with_model(settings.model, [&](auto model)
+    { Simulation{ values }.run<decltype(model)>(settings); });
+    return 0;
+  }
+
+  //  Sweep: parameter sets run concurrently, each on one thread,
+  //  and those still running once none is left to start share the threads of the others
+  std::vector<Simulation> simulations;
+  std::vector<double> costs;
+  for (auto const& point : sweep::load(filename_sweep, Simulation::nr_parameters))
+  {
+    simulations.emplace_back(point);
+    streamtube::with_model(settings.model, [&](auto model)
+    { costs.push_back(simulations.back().cost<decltype(model)>()); });
+  }
+  Settings settings_point = settings;
+  settings_point.nr_threads = 1;
+  settings_point.verbose = 0;
+  std::size_t nr_failed = sweep::run(costs, settings.nr_threads,
+    [&](std::size_t point, sweep::Threads const& threads)
+    {
+      Settings settings_indexed = settings_point;
+      settings_indexed.filename_suffix = sweep::filename_suffix(point);
+      settings_indexed.sweep_threads = &threads;
+      streamtube::with_model(settings.model, [&](auto model)
+      { simulations[point].run<decltype(model)>(settings_indexed); });
+    });
+
+  return nr_failed ? 1 : 0;
 }
@@ -0,0 +1,3 @@
+#!/bin/bash
+make streamtube_merge
+mv streamtube_merge ../../bin/streamtube_merge
@@ -0,0 +1,168 @@
+//
+//  streamtube_merge.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  Combine the shards of a streamtube_concentration or streamtube_gillespie run
+//  into the output the single run would have written
+//  Shards are combined in shard order and streamtubes in streamtube order,
+//  which is the order a single run collects them in
+//  Shards must share a nonzero base seed, so that together they draw the velocities
+//  of the single run exactly once; the drivers refuse to shard without one, or with
+//  tolerance or budget, under which each shard would stop on its own
+
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+#include "general/Columnar.h"
+#include "general/useful.h"
+#include "Stochastic/Streamtube/Models.h"
+#include "Stochastic/Streamtube/Measurer.h"
+
+//  Load all shards into a measurer and write the output
+template <typename Evolution_tag>
+void merge(std::vector<std::unique_ptr<columnar::Reader>> const& shards,
+           std::vector<std::string> const& filenames, std::string const& output_dir)
+{
+  columnar::Reader const& first = *shards[0];
+  streamtube::Measurer<Evolution_tag> measurer{ first };
+
+  //  Streamtubes of all shards, in streamtube order
+  std::vector<std::pair<std::size_t, std::size_t>> streamtubes;
+  for (std::size_t shard = 0; shard < shards.size(); ++shard)
+    for (std::size_t streamtube : streamtube::shard_streamtubes(*shards[shard]))
+      streamtubes.emplace_back(streamtube, shard);
+  std::sort(streamtubes.begin(), streamtubes.end());
+  for (std::size_t ii = 1; ii < streamtubes.size(); ++ii)
+    if (streamtubes[ii].first == streamtubes[ii - 1].first)
+      throw useful::bad_file_contents(filenames[streamtubes[ii].second]);
+  for (auto const& streamtube : streamtubes)
+    measurer.load(*shards[streamtube.second], streamtube.first);
+  measurer.normalize();
+
+  std::string filename_mass = output_dir + "/"
+    + first.attribute<std::string>("shard_filename_mass");
+  std::string name_dist = first.attribute<std::string>("shard_filename_dist");
+  std::string name_dist_bin = first.attribute<std::string>("shard_filename_dist_bin");
+
+  //  Binary distributions, written by each shard next to its table
+  if (!name_dist_bin.empty())
+  {
+    std::vector<std::string> inputs;
+    for (std::size_t shard = 0; shard < shards.size(); ++shard)
+      inputs.push_back((std::filesystem::path(filenames[shard]).parent_path()
+        / shards[shard]->attribute<std::string>("shard_filename_dist_bin")).string());
+    std::string suffix = "_shard_0_of_" + std::to_string(shards.size()) + ".bin";
+    if (name_dist_bin.size() < suffix.size()
+        || name_dist_bin.compare(name_dist_bin.size() - suffix.size(), suffix.size(), suffix) != 0)
+      throw useful::bad_file_contents(filenames[0]);
+    streamtube::concatenate_dist(inputs, output_dir + "/"
+      + name_dist_bin.substr(0, name_dist_bin.size() - suffix.size()) + ".bin");
+  }
+
+  if (first.attribute<std::int64_t>("shard_format") == 1)
+  {
+    columnar::Table table;
+    for (auto const& attribute : first.all_attributes())
+    {
+      if (attribute.first.compare(0, 6, "shard_") == 0)
+        continue;
+      if (attribute.first == "nr_streamtubes_complete")
+        table.attribute(attribute.first, measurer.nr_complete());
+      else
+        table.attribute(attribute.first, attribute.second);
+    }
+    measurer.columns(table);
+    table.write(filename_mass + ".col");
+    return;
+  }
+
+  std::ofstream output_mass{ filename_mass + ".dat" };
+  if (!output_mass.is_open())
+    throw useful::open_write_error(filename_mass + ".dat");
+  output_mass << std::scientific << std::setprecision(8);
+  if (name_dist.empty())
+    measurer(output_mass);
+  else
+  {
+    std::string filename_dist = output_dir + "/" + name_dist + ".dat";
+    std::ofstream output_dist{ filename_dist };
+    if (!output_dist.is_open())
+      throw useful::open_write_error(filename_dist);
+    output_dist << std::scientific << std::setprecision(8);
+    measurer(output_mass, output_dist);
+    output_dist.close();
+  }
+  output_mass.close();
+}
+
+int main(int argc, const char * argv[])
+{
+  if (argc < 3)
+  {
+    std::cout << "streamtube_merge\n";
+    std::cout << "Usage: streamtube_merge output_dir shard_file...\n"
+              << "output_dir : Directory to write the merged output to\n"
+              << "shard_file : Shard tables (.col) written with the nr_shards option,\n"
+              << "             one for each shard of the same run, in any order\n";
+    return argc == 1 ? 0 : 1;
+  }
+
+  std::string output_dir = argv[1];
+  std::vector<std::string> filenames(argv + 2, argv + argc);
+  std::vector<std::unique_ptr<columnar::Reader>> shards;
+  for (auto const& filename : filenames)
+  {
+    shards.push_back(std::make_unique<columnar::Reader>(filename));
+    if (!shards.back()->has_attribute("shard_index"))
+      throw useful::bad_file_contents(filename);
+  }
+
+  //  Shards in shard order, all of the same run and each exactly once
+  std::vector<std::size_t> order(shards.size());
+  for (std::size_t ii = 0; ii < order.size(); ++ii)
+    order[ii] = ii;
+  std::sort(order.begin(), order.end(), [&shards](std::size_t left, std::size_t right)
+  {
+    return shards[left]->attribute<std::int64_t>("shard_index")
+      < shards[right]->attribute<std::int64_t>("shard_index");
+  });
+  std::vector<std::unique_ptr<columnar::Reader>> shards_ordered;
+  std::vector<std::string> filenames_ordered;
+  for (std::size_t ii : order)
+  {
+    shards_ordered.push_back(std::move(shards[ii]));
+    filenames_ordered.push_back(filenames[ii]);
+  }
+  columnar::Reader const& first = *shards_ordered[0];
+  for (std::size_t shard = 0; shard < shards_ordered.size(); ++shard)
+  {
+    columnar::Reader const& current = *shards_ordered[shard];
+    if (std::size_t(current.attribute<std::int64_t>("shard_index")) != shard
+        || std::size_t(current.attribute<std::int64_t>("shard_nr_shards")) != shards_ordered.size()
+        || current.attribute<std::string>("shard_filename_mass")
+          != first.attribute<std::string>("shard_filename_mass")
+        || current.attribute<std::string>("shard_evolution")
+          != first.attribute<std::string>("shard_evolution")
+        || current.attribute<std::string>("seed") != first.attribute<std::string>("seed")
+        || current.attribute<std::string>("seed") == "0")
+      throw std::invalid_argument{ "streamtube_merge: Shards of different runs or missing shards, at "
+        + filenames_ordered[shard] };
+  }
+
+  if (first.attribute<std::string>("shard_evolution") == "time")
+    merge<streamtube::Time_tag>(shards_ordered, filenames_ordered, output_dir);
+  else
+    merge<streamtube::Space_tag>(shards_ordered, filenames_ordered, output_dir);
+
+  return 0;
+}
@@ -0,0 +1,3 @@
+#!/bin/bash
+make weighted_ensemble
+mv weighted_ensemble ../../bin/weighted_ensemble
@@ -0,0 +1,187 @@
+//
+//  weighted_ensemble.cpp
+//
+//  Created by Tomas Aquino on 10/18/26.
+//  Copyright © 2026 Tomas Aquino. All rights reserved.
+//
+
+//  The delayed A + B -> 0 example of batch_delay, with a weighted ensemble
+//  of replicas binned by the remaining number of A particles instead of
+//  independent ensembles, so that late times, where few trajectories keep
+//  many particles, are resolved with the same effort as early ones
+
+#include <cmath>
+#include <cstdint>
+#include <fstream>
+#include <iostream>
+#include <iomanip>
+#include "general/Columnar.h"
+#include "general/Constants.h"
+#include "general/Parallel.h"
+#include "general/Ranges.h"
+#include "general/Statistics.h"
+#include "general/useful.h"
+#include "Stochastic/Random.h"
+#include "Stochastic/Stoichiometry.h"
+#include "Stochastic/Gillespie/Gillespie_Stoichiometric.h"
+#include "Stochastic/Gillespie/WeightedEnsemble.h"
+
+int main(int argc, const char * argv[])
+{
+  //  Options (name=value):
+  //  particles = initial number of particles of each species [100000]
+  //  replicas = replicas per occupied bin [10]
+  //  nr_bins = number of bins of the remaining A particles, log-spaced, plus one for none [20]
+  //  resample = number of resamplings per interval between measures, log-spaced [1]
+  //  nr_runs = independent weighted-ensemble runs, for standard errors [10]
+  //  threads = number of threads, 0 for all available [0]
+  //  seed = base seed, 0 for nondeterministic seeding [0]
+  //  format = 0 for text, 1 for columnar binary (.col)
+  useful::Options options = useful::parse_options(argc, argv, 1);
+  std::size_t particles = useful::option<std::size_t>(options, "particles", 100000);
+  std::size_t replicas = useful::option<std::size_t>(options, "replicas", 10);
+  std::size_t nr_bins = useful::option<std::size_t>(options, "nr_bins", 20);
+  std::size_t nr_resample = useful::option<std::size_t>(options, "resample", 1);
+  std::size_t nr_runs = useful::option<std::size_t>(options, "nr_runs", 10);
+  std::size_t nr_threads = parallel::nr_threads(useful::option<std::size_t>(options, "threads", 0));
+  std::uint64_t seed = useful::option<std::uint64_t>(options, "seed", 0);
+  std::size_t format = useful::option<std::size_t>(options, "format", 0);
+  if (particles == 0 || nr_bins < 2 || nr_resample == 0 || nr_runs == 0)
+    throw useful::bad_parameters();
+
+  //  Initial particle numbers of each species type
+  std::vector<std::size_t> particles_initial{ particles, particles };
+
+  //  Reaction stoichiometries
+  double reaction_rate = 1./std::pow(particles_initial[0], particles_initial.size()-1);
+  stochastic::Stoichiometry stoichiometry_1{ reaction_rate, { { 0, 1 }, { 1, 1 } }, {} };
+
+  //  Delay properties
+  double delay_exponent = 0.75;
+  double delay_characteristic_time = 0.1;
+  double delay_rate = 10.*std::pow(delay_characteristic_time, -delay_exponent);
+  double delay_characteristic_time_scaled = std::pow(
+    std::cos(constants::pi*delay_exponent/2.)*delay_characteristic_time, 1./delay_exponent);
+  using Engine = stochastic::xoshiro256pp;
+  using NumberProcess = stochastic::NumberProcess_Poisson<Engine>;
+  using Delay = stochastic::DelayTime_CompoundSkewedLevyStable<NumberProcess, Engine>;
+
+  //  Measure times
+  double time_min = 1e-2;
+  double time_max = 1e5;
+  std::size_t nr_measures = 30;
+  std::vector<double> measure_times = range::logspace<std::vector<double>>
+    (time_min, time_max, nr_measures);
+
+  //  Replicas are binned by remaining A particles, with a bin for none
+  auto gillespie = gillespie::make_Gillespie_MassAction_Delay<Engine>(
+    particles_initial,
+    Delay{ NumberProcess{ delay_rate }, delay_exponent, delay_characteristic_time_scaled },
+    stoichiometry_1);
+  using Simulator = decltype(gillespie);
+  auto progress = [](Simulator const& simulator)
+  { return double(simulator.particles(0)); };
+  std::vector<double> bin_edges = range::logspace<std::vector<double>>(
+    1., double(particles), nr_bins - 1);
+  gillespie::WeightedEnsemble<Simulator, decltype(progress)> ensemble{
+    gillespie, progress, bin_edges, replicas };
+
+  //  Each run gives one estimate at each measure
+  std::vector<statistics::Welford> statistics_concentration(nr_measures);
+  std::vector<statistics::Welford> statistics_survival(nr_measures);
+  std::vector<statistics::Welford> statistics_replicas(nr_measures);
+  for (std::size_t run = 0; run < nr_runs; ++run)
+  {
+    std::cout << "run = " << run << "\n";
+    if (seed)
+      ensemble.seed(stochastic::seed_realization(seed, run));
+    ensemble.reset(gillespie);
+    double time_previous = 0.;
+    for (std::size_t measure = 0; measure < nr_measures; ++measure)
+    {
+      for (std::size_t step = 1; step <= nr_resample; ++step)
+      {
+        double fraction = double(step) / double(nr_resample);
+        double time = time_previous > 0.
+          ? time_previous * std::pow(measure_times[measure] / time_previous, fraction)
+          : measure_times[measure] * fraction;
+        if (step == nr_resample)
+          time = measure_times[measure];
+        ensemble.advance(time, nr_threads);
+        if (step == nr_resample)
+        {
+          statistics_concentration[measure].add(ensemble.average(
+            [](Simulator const& simulator) { return simulator.particles(0); }));
+          statistics_survival[measure].add(ensemble.average(
+            [](Simulator const& simulator) { return simulator.particles(0) > 0; }));
+          statistics_replicas[measure].add(double(ensemble.size()));
+        }
+        ensemble.resample();
+      }
+      time_previous = measure_times[measure];
+    }
+  }
+  std::vector<double> concentration(nr_measures);
+  std::vector<double> error(nr_measures);
+  std::vector<double> survival(nr_measures);
+  std::vector<double> error_survival(nr_measures);
+  std::vector<double> nr_replicas(nr_measures);
+  for (std::size_t measure = 0; measure < nr_measures; ++measure)
+  {
+    concentration[measure] = statistics_concentration[measure].mean();
+    error[measure] = statistics_concentration[measure].standard_error();
+    survival[measure] = statistics_survival[measure].mean();
+    error_survival[measure] = statistics_survival[measure].standard_error();
+    nr_replicas[measure] = statistics_replicas[measure].mean();
+  }
+
+  //  Output
+  std::string output_dir = "../output";
+  std::string filename{ "Data_Gillespie_Delay_WeightedEnsemble_CompoundStable" };
+  if (format == 1)
+  {
+    columnar::Table table;
+    table.attribute("model", "Gillespie_Delay_WeightedEnsemble_CompoundStable");
+    table.attribute("particles_initial", particles_initial[0]);
+    table.attribute("delay_exponent", delay_exponent);
+    table.attribute("delay_characteristic_time", delay_characteristic_time);
+    table.attribute("replicas_per_bin", replicas);
+    table.attribute("nr_bins", nr_bins);
+    table.attribute("resample", nr_resample);
+    table.attribute("nr_runs", nr_runs);
+    table.column("time", measure_times);
+    table.column("particles", concentration);
+    table.column("particles_se", error);
+    table.column("survival", survival);
+    table.column("survival_se", error_survival);
+    table.column("replicas", nr_replicas);
+    table.write(output_dir + "/" + filename + ".col");
+    return 0;
+  }
+  filename += ".dat";
+  std::ofstream output{ output_dir + "/" + filename };
+  if (!output.is_open())
+    throw useful::open_write_error(filename);
+  output << std::scientific << std::setprecision(8);
+  output << 0. << "\t";
+  useful::print(output, measure_times);
+  output << "\n";
+  output << double(particles_initial[0]) << "\t";
+  useful::print(output, concentration);
+  output << "\n";
+  output << 0. << "\t";
+  useful::print(output, error);
+  output << "\n";
+  output << 1. << "\t";
+  useful::print(output, survival);
+  output << "\n";
+  output << 0. << "\t";
+  useful::print(output, error_survival);
+  output << "\n";
+  output << double(replicas) << "\t";
+  useful::print(output, nr_replicas);
+  output << "\n";
+  output.close();
+
+  return 0;
+}